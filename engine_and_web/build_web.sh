@@ -7,9 +7,16 @@ source_files=$(find src/ -name "*.c")
 
 echo "Compiling source files, this might take a while..."
 
+# Ship the baked assets too, if `make bake` was run beforehand
+pack_file=""
+if [ -f res.pack ]; then
+    pack_file="--preload-file res.pack"
+fi
+
 # Build the target javascript and webassembly files
 # Emscripten will handle the res/ folder appropriately
-emcc ${source_files} --preload-file res -o web_build/index.js \
+# -msimd128 turns on the vectorized math in src/engine/streams.c
+emcc ${source_files} --preload-file res ${pack_file} -o web_build/index.js -msimd128 \
     -s USE_SDL=2 -s USE_SDL_IMAGE=2 -s SDL2_IMAGE_FORMATS='["png"]' \
     -s USE_SDL_MIXER=2 -s SDL2_MIXER_FORMATS='["wav"]' -s USE_SDL_TTF=2
 
@@ -0,0 +1,118 @@
+#include "arena.h"
+#include "common.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Two per thread, so nested functions can always find one they're not writing their result to
+static _Thread_local ng_arena_t scratch_arenas[2];
+
+void ng_arena_create(ng_arena_t *arena, const char *name, size_t capacity)
+{
+    arena->name = name;
+    arena->data = malloc(capacity);
+    if (!arena->data)
+        ng_die("failed to allocate %zu bytes for the %s arena", capacity, name);
+
+    arena->capacity = capacity;
+    arena->used = 0;
+    arena->high_water = 0;
+}
+
+void* ng_arena_alloc(ng_arena_t *arena, size_t size)
+{
+    // Aligning the address rather than the offset, malloc only promises 8 bytes on some platforms
+    uintptr_t address = (uintptr_t) (arena->data + arena->used);
+    size_t padding = (NG_ARENA_ALIGNMENT - address % NG_ARENA_ALIGNMENT) % NG_ARENA_ALIGNMENT;
+
+    if (size > arena->capacity - arena->used || padding > arena->capacity - arena->used - size)
+        ng_die("the %s arena is out of memory (%zu of %zu bytes in use, %zu more requested)",
+               arena->name, arena->used, arena->capacity, size);
+
+    void *memory = arena->data + arena->used + padding;
+    arena->used += padding + size;
+    arena->high_water = MAX(arena->high_water, arena->used);
+
+    return memory;
+}
+
+void* ng_arena_alloc_zeroed(ng_arena_t *arena, size_t size)
+{
+    return memset(ng_arena_alloc(arena, size), 0, size);
+}
+
+char* ng_arena_printf(ng_arena_t *arena, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+
+    if (length < 0)
+        ng_die("failed to format a string into the %s arena", arena->name);
+
+    char *text = ng_arena_alloc(arena, length + 1);
+
+    va_start(args, format);
+    vsnprintf(text, length + 1, format, args);
+    va_end(args);
+
+    return text;
+}
+
+size_t ng_arena_get_mark(ng_arena_t *arena)
+{
+    return arena->used;
+}
+
+void ng_arena_rewind(ng_arena_t *arena, size_t mark)
+{
+    if (mark > arena->used)
+        ng_die("rewinding the %s arena forward (%zu to %zu)", arena->name, arena->used, mark);
+
+    arena->used = mark;
+}
+
+void ng_arena_reset(ng_arena_t *arena)
+{
+    arena->used = 0;
+}
+
+void ng_arena_report(ng_arena_t *arena)
+{
+    printf("[arena] %-16s peak %8.1f KB of %8.1f KB (%.1f%%)\n", arena->name,
+           arena->high_water / 1024.0, arena->capacity / 1024.0,
+           arena->capacity > 0 ? arena->high_water * 100.0 / arena->capacity : 0.0);
+}
+
+void ng_arena_destroy(ng_arena_t *arena)
+{
+    free(arena->data);
+    arena->data = NULL;
+    arena->capacity = arena->used = 0;
+}
+
+ng_scratch_t ng_scratch_begin(ng_arena_t *conflict)
+{
+    ng_arena_t *arena = conflict == &scratch_arenas[0] ? &scratch_arenas[1] : &scratch_arenas[0];
+    if (!arena->data)
+        ng_arena_create(arena, "scratch", NG_SCRATCH_SIZE);
+
+    return (ng_scratch_t) {arena, arena->used};
+}
+
+void ng_scratch_end(ng_scratch_t scratch)
+{
+    ng_arena_rewind(scratch.arena, scratch.mark);
+}
+
+void ng_scratch_release(void)
+{
+    for (int i = 0; i < 2; i++)
+    {
+        if (scratch_arenas[i].data)
+            ng_arena_destroy(&scratch_arenas[i]);
+    }
+}
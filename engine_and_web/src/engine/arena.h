@@ -0,0 +1,72 @@
+#ifndef _NG_ARENA_H
+#define _NG_ARENA_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Every allocation starts on a multiple of this, enough for any SIMD type
+#define NG_ARENA_ALIGNMENT 16
+// Per thread, there are two of them
+#define NG_SCRATCH_SIZE (1024 * 1024)
+
+// Shortcut for arrays, the memory is not cleared
+#define NG_ARENA_ARRAY(arena, type, count) ((type*) ng_arena_alloc(arena, (count) * sizeof(type)))
+
+/*
+ * A linear allocator over a single block that's reserved up front. Allocating
+ * just bumps an offset and nothing gets freed on its own: the whole arena is
+ * reset at once (every frame, on every scene change...), or rewound to a mark
+ * taken earlier. Running out of space is a bug, not something to recover
+ * from, so the program dies with the arena's name instead of growing. The
+ * high water mark tells how big it really has to be
+ *
+ * NOTE: Arenas aren't thread safe, every thread has its own scratch arenas
+ */
+typedef struct
+{
+    const char *name;
+
+    char *data;
+    size_t capacity;
+    size_t used;
+
+    // The most that was ever in use at once, resetting doesn't clear it
+    size_t high_water;
+} ng_arena_t;
+
+// Memory taken out of a scratch arena, gets handed back by ng_scratch_end
+typedef struct
+{
+    ng_arena_t *arena;
+    size_t mark;
+} ng_scratch_t;
+
+// NOTE: The name is not copied, pass a string literal
+void ng_arena_create(ng_arena_t *arena, const char *name, size_t capacity);
+
+void* ng_arena_alloc(ng_arena_t *arena, size_t size);
+void* ng_arena_alloc_zeroed(ng_arena_t *arena, size_t size);
+// Formats straight into the arena, the string lives as long as the rest of it
+char* ng_arena_printf(ng_arena_t *arena, const char *format, ...);
+
+// Everything allocated after taking the mark goes away when rewinding to it
+size_t ng_arena_get_mark(ng_arena_t *arena);
+void ng_arena_rewind(ng_arena_t *arena, size_t mark);
+void ng_arena_reset(ng_arena_t *arena);
+
+// Prints out the high water mark against the capacity
+void ng_arena_report(ng_arena_t *arena);
+void ng_arena_destroy(ng_arena_t *arena);
+
+// Temporary memory for the calling thread, released in reverse order with
+// ng_scratch_end. A function that allocates its result in an arena it was
+// handed should pass it as the conflict: scratch memory then comes from the
+// other scratch arena, so rewinding it can't take the result along with it
+// NOTE: Can be NULL, the arenas are created the first time they are needed
+ng_scratch_t ng_scratch_begin(ng_arena_t *conflict);
+void ng_scratch_end(ng_scratch_t scratch);
+
+// Frees the scratch arenas of the calling thread, threads call it before exiting
+void ng_scratch_release(void);
+
+#endif
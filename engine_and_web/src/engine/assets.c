@@ -0,0 +1,427 @@
+#include "assets.h"
+#include "common.h"
+#include <SDL2/SDL_image.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define INITIAL_CAPACITY 64
+
+static const char *type_names[] = { "texture", "font", "sound", "music" };
+
+// FNV-1a, mixing in the rest of the key at the end
+static uint32_t hash_key(const char *path, ng_asset_type_t type, int font_size)
+{
+    uint32_t hash = 2166136261u;
+    for (const char *c = path; *c; c++)
+    {
+        hash ^= (unsigned char) *c;
+        hash *= 16777619u;
+    }
+
+    hash ^= type;
+    hash *= 16777619u;
+    hash ^= font_size;
+    hash *= 16777619u;
+
+    return hash;
+}
+
+// Returns either the slot holding the key or the empty slot where it should go
+static ng_asset_t* find_slot(ng_assets_t *assets, const char *path, ng_asset_type_t type, int font_size)
+{
+    uint32_t mask = assets->capacity - 1;
+    uint32_t index = hash_key(path, type, font_size) & mask;
+
+    for (;;)
+    {
+        ng_asset_t *entry = &assets->entries[index];
+        if (!entry->path)
+            return entry;
+
+        if (entry->type == type && entry->font_size == font_size && strcmp(entry->path, path) == 0)
+            return entry;
+
+        index = (index + 1) & mask;
+    }
+}
+
+static void allocate_table(ng_assets_t *assets, int capacity)
+{
+    assets->entries = calloc(capacity, sizeof(ng_asset_t));
+    if (!assets->entries)
+        ng_die("failed to allocate an asset table of %d entries", capacity);
+
+    assets->capacity = capacity;
+    assets->count = 0;
+}
+
+static void grow_table(ng_assets_t *assets)
+{
+    ng_asset_t *old_entries = assets->entries;
+    int old_capacity = assets->capacity;
+
+    allocate_table(assets, old_capacity * 2);
+
+    // Entries are never removed, so there are no tombstones to worry about
+    for (int i = 0; i < old_capacity; i++)
+    {
+        if (!old_entries[i].path)
+            continue;
+
+        *find_slot(assets, old_entries[i].path, old_entries[i].type, old_entries[i].font_size) = old_entries[i];
+        assets->count++;
+    }
+
+    free(old_entries);
+}
+
+// Looks the key up, inserting it (unloaded) if it's not already there
+static ng_asset_t* lookup(ng_assets_t *assets, const char *path, ng_asset_type_t type, int font_size)
+{
+    ng_asset_t *entry = find_slot(assets, path, type, font_size);
+    if (entry->path)
+        return entry;
+
+    // Keeping the load factor below 3/4
+    if ((assets->count + 1) * 4 > assets->capacity * 3)
+    {
+        grow_table(assets);
+        entry = find_slot(assets, path, type, font_size);
+    }
+
+    entry->path = strdup(path);
+    entry->type = type;
+    entry->font_size = font_size;
+    entry->data = NULL;
+    entry->ref_count = 0;
+    entry->pending = -1;
+    entry->bytes = 0;
+    entry->last_used = 0;
+    assets->count++;
+
+    return entry;
+}
+
+static size_t get_file_size(const char *path)
+{
+    struct stat info;
+    return stat(path, &info) == 0 ? info.st_size : 0;
+}
+
+// Textures baked into the pack are already decoded
+static ng_pack_entry_t* find_in_pack(ng_assets_t *assets, ng_asset_t *entry)
+{
+    if (!assets->pack)
+        return NULL;
+
+    if (entry->type == NG_ASSET_SOUND && !assets->pack->can_use_sounds)
+        return NULL;
+
+    if (entry->type != NG_ASSET_TEXTURE && entry->type != NG_ASSET_SOUND)
+        return NULL;
+
+    return ng_pack_find(assets->pack, entry->path);
+}
+
+static void load(ng_assets_t *assets, ng_asset_t *entry)
+{
+    ng_pack_entry_t *baked = find_in_pack(assets, entry);
+
+    switch (entry->type)
+    {
+    case NG_ASSET_TEXTURE:
+    {
+        SDL_Texture *texture = baked
+            ? ng_pack_create_texture(assets->pack, assets->renderer, baked)
+            : IMG_LoadTexture(assets->renderer, entry->path);
+        if (!texture)
+            ng_die("failed to load texture %s", entry->path);
+
+        int width, height;
+        SDL_QueryTexture(texture, NULL, NULL, &width, &height);
+
+        entry->data = texture;
+        entry->bytes = (size_t) width * height * 4;
+        break;
+    }
+    case NG_ASSET_FONT:
+        entry->data = TTF_OpenFont(entry->path, entry->font_size);
+        if (!entry->data)
+            ng_die("failed to load font %s", entry->path);
+
+        entry->bytes = get_file_size(entry->path);
+        break;
+    case NG_ASSET_SOUND:
+    #ifndef NO_AUDIO
+    {
+        Mix_Chunk *sound = baked
+            ? ng_pack_create_sound(assets->pack, baked)
+            : Mix_LoadWAV(entry->path);
+        if (!sound)
+            ng_die("failed to load sound %s", entry->path);
+
+        entry->data = sound;
+        entry->bytes = sound->alen;
+    }
+    #endif
+        break;
+    case NG_ASSET_MUSIC:
+    #ifndef NO_AUDIO
+        entry->data = Mix_LoadMUS(entry->path);
+        if (!entry->data)
+            ng_die("failed to load music %s", entry->path);
+
+        entry->bytes = get_file_size(entry->path);
+    #endif
+        break;
+    }
+}
+
+static void unload(ng_asset_t *entry)
+{
+    if (!entry->data)
+        return;
+
+    switch (entry->type)
+    {
+    case NG_ASSET_TEXTURE:
+        SDL_DestroyTexture(entry->data);
+        break;
+    case NG_ASSET_FONT:
+        TTF_CloseFont(entry->data);
+        break;
+    case NG_ASSET_SOUND:
+        Mix_FreeChunk(entry->data);
+        break;
+    case NG_ASSET_MUSIC:
+        Mix_FreeMusic(entry->data);
+        break;
+    }
+
+    entry->data = NULL;
+    entry->bytes = 0;
+}
+
+static void* acquire(ng_assets_t *assets, const char *path, ng_asset_type_t type, int font_size)
+{
+    ng_asset_t *entry = lookup(assets, path, type, font_size);
+
+    // The prefetch callback fills in the entry once the upload is done
+    if (!entry->data && entry->pending >= 0)
+        ng_loader_wait(assets->loader, entry->pending);
+
+    if (!entry->data)
+        load(assets, entry);
+
+    entry->ref_count++;
+    entry->last_used = ++assets->clock;
+    return entry->data;
+}
+
+static void on_texture_prefetched(const char *path, SDL_Texture *texture, void *userdata)
+{
+    ng_assets_t *assets = userdata;
+    if (!texture)
+        ng_die("failed to load texture %s", path);
+
+    ng_asset_t *entry = lookup(assets, path, NG_ASSET_TEXTURE, 0);
+
+    int width, height;
+    SDL_QueryTexture(texture, NULL, NULL, &width, &height);
+
+    entry->data = texture;
+    entry->bytes = (size_t) width * height * 4;
+    entry->pending = -1;
+}
+
+void ng_assets_create(ng_assets_t *assets, SDL_Renderer *renderer)
+{
+    assets->renderer = renderer;
+    assets->loader = NULL;
+    assets->pack = NULL;
+    assets->clock = 0;
+    allocate_table(assets, INITIAL_CAPACITY);
+}
+
+void ng_assets_scan(ng_assets_t *assets, const char *directory)
+{
+    DIR *dir = opendir(directory);
+    if (!dir)
+        ng_die("failed to open asset directory %s", directory);
+
+    struct dirent *item;
+    while ((item = readdir(dir)))
+    {
+        if (item->d_name[0] == '.')
+            continue;
+
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", directory, item->d_name);
+
+        struct stat info;
+        if (stat(path, &info) != 0)
+            continue;
+
+        if (S_ISDIR(info.st_mode))
+        {
+            ng_assets_scan(assets, path);
+            continue;
+        }
+
+        const char *extension = strrchr(item->d_name, '.');
+        if (!extension)
+            continue;
+
+        // Fonts can't be registered up front, their size is part of the key
+        if (strcmp(extension, ".png") == 0)
+            lookup(assets, path, NG_ASSET_TEXTURE, 0);
+        else if (strcmp(extension, ".wav") == 0)
+            lookup(assets, path, NG_ASSET_SOUND, 0);
+    }
+
+    closedir(dir);
+}
+
+void ng_assets_mount_pack(ng_assets_t *assets, ng_pack_t *pack)
+{
+    assets->pack = pack;
+}
+
+void ng_assets_prefetch_texture(ng_assets_t *assets, ng_loader_t *loader, const char *path)
+{
+    ng_asset_t *entry = lookup(assets, path, NG_ASSET_TEXTURE, 0);
+    // About to be needed, so it's the last thing that should get trimmed
+    entry->last_used = ++assets->clock;
+    if (entry->data || entry->pending >= 0)
+        return;
+
+    // Nothing to decode, it would only be wasting the workers' time
+    if (find_in_pack(assets, entry))
+        return;
+
+    assets->loader = loader;
+    entry->pending = ng_loader_request(loader, path, on_texture_prefetched, assets);
+}
+
+SDL_Texture* ng_assets_get_texture(ng_assets_t *assets, const char *path)
+{
+    return acquire(assets, path, NG_ASSET_TEXTURE, 0);
+}
+
+TTF_Font* ng_assets_get_font(ng_assets_t *assets, const char *path, int size)
+{
+    return acquire(assets, path, NG_ASSET_FONT, size);
+}
+
+Mix_Chunk* ng_assets_get_sound(ng_assets_t *assets, const char *path)
+{
+    return acquire(assets, path, NG_ASSET_SOUND, 0);
+}
+
+Mix_Music* ng_assets_get_music(ng_assets_t *assets, const char *path)
+{
+    return acquire(assets, path, NG_ASSET_MUSIC, 0);
+}
+
+void ng_assets_release(ng_assets_t *assets, const void *data)
+{
+    if (!data)
+        return;
+
+    for (int i = 0; i < assets->capacity; i++)
+    {
+        ng_asset_t *entry = &assets->entries[i];
+        if (entry->path && entry->data == data)
+        {
+            if (entry->ref_count > 0)
+                entry->ref_count--;
+
+            entry->last_used = ++assets->clock;
+            return;
+        }
+    }
+}
+
+int ng_assets_collect(ng_assets_t *assets)
+{
+    int freed = 0;
+    for (int i = 0; i < assets->capacity; i++)
+    {
+        ng_asset_t *entry = &assets->entries[i];
+        if (entry->path && entry->data && entry->ref_count == 0)
+        {
+            unload(entry);
+            freed++;
+        }
+    }
+
+    return freed;
+}
+
+int ng_assets_trim(ng_assets_t *assets, size_t texture_budget)
+{
+    size_t resident = 0;
+    for (int i = 0; i < assets->capacity; i++)
+    {
+        ng_asset_t *entry = &assets->entries[i];
+        if (entry->path && entry->data && entry->type == NG_ASSET_TEXTURE)
+            resident += entry->bytes;
+    }
+
+    // There's only a handful of textures, looking for the oldest one every time is fine
+    int freed = 0;
+    while (resident > texture_budget)
+    {
+        ng_asset_t *oldest = NULL;
+        for (int i = 0; i < assets->capacity; i++)
+        {
+            ng_asset_t *entry = &assets->entries[i];
+            if (!entry->path || !entry->data || entry->type != NG_ASSET_TEXTURE || entry->ref_count > 0)
+                continue;
+
+            if (!oldest || entry->last_used < oldest->last_used)
+                oldest = entry;
+        }
+
+        if (!oldest)
+            break;
+
+        resident -= oldest->bytes;
+        unload(oldest);
+        freed++;
+    }
+
+    return freed;
+}
+
+size_t ng_assets_report(ng_assets_t *assets)
+{
+    size_t total = 0;
+    for (int i = 0; i < assets->capacity; i++)
+    {
+        ng_asset_t *entry = &assets->entries[i];
+        if (!entry->path || !entry->data)
+            continue;
+
+        printf("[assets] %-8s refs: %-3d %8zu KB  %s\n", type_names[entry->type],
+               entry->ref_count, entry->bytes / 1024, entry->path);
+        total += entry->bytes;
+    }
+
+    printf("[assets] %zu KB resident\n", total / 1024);
+    return total;
+}
+
+void ng_assets_destroy(ng_assets_t *assets)
+{
+    for (int i = 0; i < assets->capacity; i++)
+    {
+        unload(&assets->entries[i]);
+        free(assets->entries[i].path);
+    }
+
+    free(assets->entries);
+}
@@ -0,0 +1,106 @@
+#ifndef _NG_ASSETS_H
+#define _NG_ASSETS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <SDL2/SDL_mixer.h>
+#include "loader.h"
+#include "pack.h"
+
+typedef enum
+{
+    NG_ASSET_TEXTURE,
+    NG_ASSET_FONT,
+    NG_ASSET_SOUND,
+    NG_ASSET_MUSIC
+} ng_asset_type_t;
+
+typedef struct
+{
+    // An asset is identified by its path, its type and (for fonts) its size
+    // Empty slots of the table have a NULL path
+    char *path;
+    ng_asset_type_t type;
+    int font_size;
+
+    // NULL while the asset is known but not loaded
+    void *data;
+    int ref_count;
+
+    // The loader request of a prefetched texture, -1 if there's none
+    ng_load_handle_t pending;
+
+    // Rough estimate of the memory the asset occupies
+    size_t bytes;
+
+    // When the asset was last requested or released, see ng_assets_trim
+    uint32_t last_used;
+} ng_asset_t;
+
+/*
+ * Every asset gets loaded at most once, no matter how many times it's
+ * requested. Requests increase the reference count of the asset and
+ * releases decrease it; unreferenced assets stay in memory until collected
+ * or trimmed, so switching back and forth between two scenes doesn't reload
+ * anything
+ */
+typedef struct
+{
+    SDL_Renderer *renderer;
+
+    // Open addressing with linear probing, the capacity is a power of two
+    ng_asset_t *entries;
+    int capacity;
+    int count;
+
+    // Used for prefetching, can be left to NULL
+    ng_loader_t *loader;
+
+    // Assets found inside the pack skip decoding altogether
+    ng_pack_t *pack;
+
+    // Goes up on every request and release, it only has to order them
+    uint32_t clock;
+} ng_assets_t;
+
+void ng_assets_create(ng_assets_t *assets, SDL_Renderer *renderer);
+
+// Registers (without loading) every texture and sound found in the
+// directory and its subdirectories, based on their file extensions
+void ng_assets_scan(ng_assets_t *assets, const char *directory);
+
+// Textures and sounds get created straight from the pack when it has them
+// NOTE: The pack has to outlive the asset manager
+void ng_assets_mount_pack(ng_assets_t *assets, ng_pack_t *pack);
+
+// Starts decoding the texture in the background, without referencing it
+// Requesting it before the upload completes just waits for it to finish
+void ng_assets_prefetch_texture(ng_assets_t *assets, ng_loader_t *loader, const char *path);
+
+// These load the asset only the first time they are called
+SDL_Texture* ng_assets_get_texture(ng_assets_t *assets, const char *path);
+TTF_Font* ng_assets_get_font(ng_assets_t *assets, const char *path, int size);
+Mix_Chunk* ng_assets_get_sound(ng_assets_t *assets, const char *path);
+Mix_Music* ng_assets_get_music(ng_assets_t *assets, const char *path);
+
+// NOTE: This has to search the whole table, it's meant to be called
+// on scene transitions and not every frame
+void ng_assets_release(ng_assets_t *assets, const void *data);
+
+// Frees every loaded asset that is not referenced anymore
+// Returns the number of assets that got freed
+int ng_assets_collect(ng_assets_t *assets);
+
+// Frees unreferenced textures, least recently used first, until the
+// loaded ones fit in the budget (or only referenced ones are left)
+// Returns the number of textures that got freed
+int ng_assets_trim(ng_assets_t *assets, size_t texture_budget);
+
+// Prints the resident set and returns its total size in bytes
+size_t ng_assets_report(ng_assets_t *assets);
+
+void ng_assets_destroy(ng_assets_t *assets);
+
+#endif
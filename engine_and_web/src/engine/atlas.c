@@ -0,0 +1,267 @@
+#include "atlas.h"
+#include "common.h"
+#include "arena.h"
+#include <SDL2/SDL_image.h>
+#include <stdlib.h>
+
+// Empty pixels between neighbouring images, so that
+// filtering never samples the edges of another image
+#define PADDING 1
+
+// A horizontal segment of the skyline, everything below it is occupied
+typedef struct
+{
+    int x, y, width;
+} skyline_node_t;
+
+typedef struct
+{
+    SDL_Surface *surface;
+    skyline_node_t *nodes;
+    int node_count;
+} atlas_page_t;
+
+// Returns the height at which a w x h rectangle would rest if its left
+// side was placed on the given node, or -1 if it doesn't fit at all
+static int skyline_fit(atlas_page_t *page, int size, int index, int w, int h)
+{
+    skyline_node_t *node = &page->nodes[index];
+    if (node->x + w > size)
+        return -1;
+
+    int y = node->y, width_left = w;
+    for (int i = index; width_left > 0; i++)
+    {
+        y = MAX(y, page->nodes[i].y);
+        if (y + h > size)
+            return -1;
+
+        width_left -= page->nodes[i].width;
+    }
+
+    return y;
+}
+
+// Bottom-left heuristic: pick the lowest spot, then the leftmost one
+static bool skyline_insert(atlas_page_t *page, int size, int w, int h, SDL_Rect *result)
+{
+    int best_index = -1, best_y = size;
+    for (int i = 0; i < page->node_count; i++)
+    {
+        int y = skyline_fit(page, size, i, w, h);
+        if (y >= 0 && y < best_y)
+        {
+            best_y = y;
+            best_index = i;
+        }
+    }
+
+    if (best_index < 0)
+        return false;
+
+    result->x = page->nodes[best_index].x;
+    result->y = best_y;
+    result->w = w;
+    result->h = h;
+
+    // Insert the new segment on top of the rectangle
+    memmove(&page->nodes[best_index + 1], &page->nodes[best_index],
+            (page->node_count - best_index) * sizeof(skyline_node_t));
+    page->nodes[best_index] = (skyline_node_t) { result->x, best_y + h, w };
+    page->node_count++;
+
+    // Then shrink or remove the segments that are now hidden below it
+    int right = result->x + w;
+    for (int i = best_index + 1; i < page->node_count; )
+    {
+        skyline_node_t *node = &page->nodes[i];
+        if (node->x >= right)
+            break;
+
+        int shrink = right - node->x;
+        node->x += shrink;
+        node->width -= shrink;
+
+        if (node->width > 0)
+            break;
+
+        memmove(node, node + 1, (page->node_count - i - 1) * sizeof(skyline_node_t));
+        page->node_count--;
+    }
+
+    // Finally merge neighbours with the same height
+    for (int i = 0; i + 1 < page->node_count; )
+    {
+        if (page->nodes[i].y == page->nodes[i + 1].y)
+        {
+            page->nodes[i].width += page->nodes[i + 1].width;
+            memmove(&page->nodes[i + 1], &page->nodes[i + 2],
+                    (page->node_count - i - 2) * sizeof(skyline_node_t));
+            page->node_count--;
+        }
+        else
+            i++;
+    }
+
+    return true;
+}
+
+static void page_create(atlas_page_t *page, int size, ng_arena_t *arena)
+{
+    page->surface = SDL_CreateRGBSurfaceWithFormat(0, size, size, 32, SDL_PIXELFORMAT_RGBA32);
+    // There can never be more segments than columns
+    page->nodes = NG_ARENA_ARRAY(arena, skyline_node_t, size + 1);
+
+    if (!page->surface)
+        ng_die("failed to allocate a %dx%d atlas page", size, size);
+
+    // Transparent pixels everywhere, including the padding
+    SDL_FillRect(page->surface, NULL, 0);
+
+    page->nodes[0] = (skyline_node_t) { 0, 0, size };
+    page->node_count = 1;
+}
+
+// Only uploads the rows that were actually used
+static SDL_Texture* page_upload(atlas_page_t *page, SDL_Renderer *renderer)
+{
+    int used_height = 0;
+    for (int i = 0; i < page->node_count; i++)
+        used_height = MAX(used_height, page->nodes[i].y);
+
+    SDL_Surface *surface = page->surface;
+    SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC,
+                                             surface->w, MAX(used_height, 1));
+    if (!texture)
+        ng_die("failed to create atlas texture: %s", SDL_GetError());
+
+    SDL_UpdateTexture(texture, NULL, surface->pixels, surface->pitch);
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+    return texture;
+}
+
+// qsort() has no user data argument, so the comparison has to peek here
+static SDL_Surface **sort_surfaces;
+
+// Taller images first, which is what skyline packing likes best
+static int compare_by_height(const void *a, const void *b)
+{
+    SDL_Surface *first = sort_surfaces[*(const int*)a];
+    SDL_Surface *second = sort_surfaces[*(const int*)b];
+
+    if (first->h != second->h)
+        return second->h - first->h;
+
+    return second->w - first->w;
+}
+
+void ng_atlas_create(ng_atlas_t *atlas, SDL_Renderer *renderer, ng_pack_t *pack,
+                     const char **files, int file_count, int page_size)
+{
+    // Everything but the sprites and the pages is only needed while packing
+    ng_scratch_t scratch = ng_scratch_begin(NULL);
+    SDL_Surface **surfaces = NG_ARENA_ARRAY(scratch.arena, SDL_Surface*, file_count);
+    int *order = NG_ARENA_ARRAY(scratch.arena, int, file_count);
+    // Worst case scenario, every image gets a page of its own
+    atlas_page_t *pages = NG_ARENA_ARRAY(scratch.arena, atlas_page_t, file_count);
+    int *page_of = NG_ARENA_ARRAY(scratch.arena, int, file_count);
+    SDL_Rect *regions = NG_ARENA_ARRAY(scratch.arena, SDL_Rect, file_count);
+
+    atlas->sprites = malloc(file_count * sizeof(ng_sprite_t));
+    atlas->sprite_count = file_count;
+    atlas->page_size = page_size;
+    atlas->page_count = 0;
+
+    if (!atlas->sprites)
+        ng_die("failed to allocate memory for a texture atlas");
+
+    for (int i = 0; i < file_count; i++)
+    {
+        ng_pack_entry_t *baked = pack ? ng_pack_find(pack, files[i]) : NULL;
+        surfaces[i] = baked ? ng_pack_create_surface(pack, baked) : IMG_Load(files[i]);
+        if (!surfaces[i])
+            ng_die("failed to load image %s for the texture atlas", files[i]);
+
+        if (surfaces[i]->w + PADDING > page_size || surfaces[i]->h + PADDING > page_size)
+            ng_die("image %s does not fit inside a %dx%d atlas page", files[i], page_size, page_size);
+
+        order[i] = i;
+    }
+
+    sort_surfaces = surfaces;
+    qsort(order, file_count, sizeof(int), compare_by_height);
+
+    // Each image goes into the first page with enough space left
+    for (int o = 0; o < file_count; o++)
+    {
+        int i = order[o];
+        SDL_Surface *surface = surfaces[i];
+
+        int p;
+        for (p = 0; p < atlas->page_count; p++)
+        {
+            if (skyline_insert(&pages[p], page_size, surface->w + PADDING,
+                               surface->h + PADDING, &regions[i]))
+                break;
+        }
+
+        if (p == atlas->page_count)
+        {
+            page_create(&pages[p], page_size, scratch.arena);
+            atlas->page_count++;
+            skyline_insert(&pages[p], page_size, surface->w + PADDING,
+                           surface->h + PADDING, &regions[i]);
+        }
+
+        // The padding is not part of the image
+        regions[i].w = surface->w;
+        regions[i].h = surface->h;
+        page_of[i] = p;
+
+        // Copy the pixels as they are, alpha channel included
+        // (the blit is allowed to modify its destination rect, hence the copy)
+        SDL_Rect destination = regions[i];
+        SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_NONE);
+        SDL_BlitSurface(surface, NULL, pages[p].surface, &destination);
+        SDL_FreeSurface(surface);
+    }
+
+    atlas->pages = malloc(atlas->page_count * sizeof(SDL_Texture*));
+    if (!atlas->pages)
+        ng_die("failed to allocate memory for a texture atlas");
+
+    for (int p = 0; p < atlas->page_count; p++)
+    {
+        atlas->pages[p] = page_upload(&pages[p], renderer);
+
+        SDL_FreeSurface(pages[p].surface);
+    }
+
+    for (int i = 0; i < file_count; i++)
+        ng_sprite_create_from_region(&atlas->sprites[i], atlas->pages[page_of[i]], &regions[i]);
+
+    ng_scratch_end(scratch);
+}
+
+void ng_atlas_get_sprite(ng_atlas_t *atlas, ng_sprite_t *sprite, int index)
+{
+    ng_sprite_t *entry = &atlas->sprites[index];
+    ng_sprite_create_from_region(sprite, entry->texture, &entry->src);
+}
+
+void ng_atlas_get_animated(ng_atlas_t *atlas, ng_animated_sprite_t *anim, int index,
+                           unsigned int total_frames)
+{
+    ng_sprite_t *entry = &atlas->sprites[index];
+    ng_animated_create_from_region(anim, entry->texture, &entry->src, total_frames);
+}
+
+void ng_atlas_destroy(ng_atlas_t *atlas)
+{
+    for (int p = 0; p < atlas->page_count; p++)
+        SDL_DestroyTexture(atlas->pages[p]);
+
+    free(atlas->pages);
+    free(atlas->sprites);
+}
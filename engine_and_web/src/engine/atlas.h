@@ -0,0 +1,37 @@
+#ifndef _NG_ATLAS_H
+#define _NG_ATLAS_H
+
+#include <SDL2/SDL.h>
+#include "sprite.h"
+#include "pack.h"
+
+/*
+ * Packs a bunch of image files into one (or a few, if they don't fit) large
+ * textures, so that sprites using them can be batched together. Each image
+ * ends up as a region inside a page, described by a ready-to-use sprite
+ */
+typedef struct
+{
+    // Every page is a separate texture of at most page_size x page_size
+    SDL_Texture **pages;
+    int page_count;
+    int page_size;
+
+    // One sprite per packed file, in the same order as the file list
+    ng_sprite_t *sprites;
+    int sprite_count;
+} ng_atlas_t;
+
+// Images baked into the pack are copied from there instead of being decoded
+// NOTE: The pack can be NULL
+void ng_atlas_create(ng_atlas_t *atlas, SDL_Renderer *renderer, ng_pack_t *pack,
+                     const char **files, int file_count, int page_size);
+
+// Both return a fresh copy that can be modified freely (position, scale etc)
+void ng_atlas_get_sprite(ng_atlas_t *atlas, ng_sprite_t *sprite, int index);
+void ng_atlas_get_animated(ng_atlas_t *atlas, ng_animated_sprite_t *anim, int index,
+                           unsigned int total_frames);
+
+void ng_atlas_destroy(ng_atlas_t *atlas);
+
+#endif
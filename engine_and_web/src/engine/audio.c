@@ -1,6 +1,135 @@
 #include "audio.h"
 #include "common.h"
 
+// There's only one audio device, so there's only one queue
+static ng_audio_t queue;
+
+#ifndef NO_AUDIO
+static void run_command(ng_audio_command_t *command)
+{
+    switch (command->type)
+    {
+    case NG_AUDIO_PLAY_SOUND:
+    {
+        // Converted to the device's format when it was loaded
+        Mix_Chunk *sound = command->data;
+        ng_mixer_play(&queue.mixer, (const int16_t*) sound->abuf, sound->alen / 4,
+                      command->gain, command->pan, command->priority, command->value);
+        break;
+    }
+    case NG_AUDIO_STOP_SOUNDS:
+        ng_mixer_stop_all(&queue.mixer);
+        break;
+    case NG_AUDIO_SOUND_VOLUME:
+        ng_mixer_set_volume(&queue.mixer, command->value);
+        break;
+    case NG_AUDIO_PLAY_MUSIC:
+        Mix_PlayMusic(command->data, command->value);
+        break;
+    case NG_AUDIO_PAUSE_MUSIC:
+        Mix_PauseMusic();
+        break;
+    case NG_AUDIO_RESUME_MUSIC:
+        Mix_ResumeMusic();
+        break;
+    case NG_AUDIO_STOP_MUSIC:
+        Mix_HaltMusic();
+        break;
+    case NG_AUDIO_MUSIC_VOLUME:
+        Mix_VolumeMusic(command->value);
+        break;
+    }
+}
+
+// Runs on the audio thread, after SDL_mixer has filled the buffer with the music
+static void drain_commands(void *userdata, Uint8 *stream, int length)
+{
+    int head = SDL_AtomicGet(&queue.head);
+    int tail = SDL_AtomicGet(&queue.tail);
+
+    while (head != tail)
+    {
+        run_command(&queue.commands[head & (NG_AUDIO_COMMANDS - 1)]);
+        head++;
+    }
+
+    // Handing the slots back to the game only after they've been read
+    SDL_AtomicSet(&queue.head, head);
+
+    ng_mixer_mix(&queue.mixer, (int16_t*) stream, length / 4);
+}
+#endif
+
+static void push_sound_command(ng_audio_command_type_t type, void *data, int value,
+                               float gain, float pan, int priority)
+{
+#ifndef NO_AUDIO
+    if (!queue.is_open)
+        return;
+
+    int tail = SDL_AtomicGet(&queue.tail);
+    if (tail - SDL_AtomicGet(&queue.head) >= NG_AUDIO_COMMANDS)
+    {
+        SDL_AtomicIncRef(&queue.dropped_count);
+        return;
+    }
+
+    ng_audio_command_t *command = &queue.commands[tail & (NG_AUDIO_COMMANDS - 1)];
+    command->type = type;
+    command->data = data;
+    command->value = value;
+    command->gain = gain;
+    command->pan = pan;
+    command->priority = priority;
+
+    // The audio thread can't see the command before it's fully written
+    SDL_AtomicSet(&queue.tail, tail + 1);
+#endif
+}
+
+static void push_command(ng_audio_command_type_t type, void *data, int value)
+{
+    push_sound_command(type, data, value, 1, 0, 0);
+}
+
+void ng_audio_open(int samples)
+{
+#ifndef NO_AUDIO
+    if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, samples) < 0)
+        ng_die("failed to open audio device and initialize SDL_Mixer");
+
+    // The mixer only deals with 16 bit stereo
+    int frequency, channels;
+    Uint16 format;
+    Mix_QuerySpec(&frequency, &format, &channels);
+    if (format != AUDIO_S16SYS || channels != 2)
+        ng_die("the audio device has to be 16 bit stereo");
+
+    // Sounds don't need SDL_mixer's channels anymore
+    Mix_AllocateChannels(0);
+    ng_mixer_create(&queue.mixer, NG_AUDIO_VOICE_BUDGET);
+
+    SDL_AtomicSet(&queue.head, 0);
+    SDL_AtomicSet(&queue.tail, 0);
+    SDL_AtomicSet(&queue.dropped_count, 0);
+    queue.is_open = true;
+
+    Mix_SetPostMix(drain_commands, NULL);
+#endif
+}
+
+void ng_audio_close(void)
+{
+#ifndef NO_AUDIO
+    if (!queue.is_open)
+        return;
+
+    Mix_SetPostMix(NULL, NULL);
+    Mix_CloseAudio();
+    queue.is_open = false;
+#endif
+}
+
 Mix_Chunk* ng_audio_load(const char *file)
 {
 #ifndef NO_AUDIO
@@ -16,7 +145,50 @@ Mix_Chunk* ng_audio_load(const char *file)
 
 void ng_audio_play(Mix_Chunk *audio)
 {
-#ifndef NO_AUDIO
-    Mix_PlayChannel(-1, audio, 0);
-#endif
+    ng_audio_play_voice(audio, 1, 0, 0);
+}
+
+void ng_audio_play_voice(Mix_Chunk *audio, float gain, float pan, int priority)
+{
+    push_sound_command(NG_AUDIO_PLAY_SOUND, audio, 0, gain, pan, priority);
+}
+
+void ng_audio_stop_sounds(void)
+{
+    push_command(NG_AUDIO_STOP_SOUNDS, NULL, 0);
+}
+
+void ng_audio_set_sound_volume(int volume)
+{
+    push_command(NG_AUDIO_SOUND_VOLUME, NULL, volume);
+}
+
+void ng_audio_play_music(Mix_Music *music, int loops)
+{
+    push_command(NG_AUDIO_PLAY_MUSIC, music, loops);
+}
+
+void ng_audio_pause_music(void)
+{
+    push_command(NG_AUDIO_PAUSE_MUSIC, NULL, 0);
+}
+
+void ng_audio_resume_music(void)
+{
+    push_command(NG_AUDIO_RESUME_MUSIC, NULL, 0);
+}
+
+void ng_audio_stop_music(void)
+{
+    push_command(NG_AUDIO_STOP_MUSIC, NULL, 0);
+}
+
+void ng_audio_set_music_volume(int volume)
+{
+    push_command(NG_AUDIO_MUSIC_VOLUME, NULL, volume);
+}
+
+int ng_audio_get_dropped_count(void)
+{
+    return SDL_AtomicGet(&queue.dropped_count);
 }
@@ -1,9 +1,96 @@
 #ifndef _NG_AUDIO_H
 #define _NG_AUDIO_H
 
+#include <SDL2/SDL.h>
 #include <SDL2/SDL_mixer.h>
+#include <stdbool.h>
+#include "mixer.h"
+
+// Samples per channel the device asks for at once, 512 is about 12ms at 44100 Hz
+// Build with `make AUDIO_BUFFER=256` (or 1024, 2048...) to change it
+#ifndef NG_AUDIO_BUFFER
+#define NG_AUDIO_BUFFER 512
+#endif
+
+// Has to be a power of two
+#define NG_AUDIO_COMMANDS 256
+// Sounds past this many (in priority order) play silently, see mixer.h
+#define NG_AUDIO_VOICE_BUDGET 64
+
+typedef enum
+{
+    NG_AUDIO_PLAY_SOUND,
+    NG_AUDIO_STOP_SOUNDS,
+    NG_AUDIO_SOUND_VOLUME,
+    NG_AUDIO_PLAY_MUSIC,
+    NG_AUDIO_PAUSE_MUSIC,
+    NG_AUDIO_RESUME_MUSIC,
+    NG_AUDIO_STOP_MUSIC,
+    NG_AUDIO_MUSIC_VOLUME
+} ng_audio_command_type_t;
+
+typedef struct
+{
+    ng_audio_command_type_t type;
+
+    // Mix_Chunk or Mix_Music, depending on the type
+    void *data;
+    // Loops for playing, 0 to 128 for volumes
+    int value;
+
+    // Only for sounds
+    float gain, pan;
+    int priority;
+} ng_audio_command_t;
+
+/*
+ * The game never calls SDL_mixer directly, it pushes commands into a ring
+ * that the audio thread drains right after mixing every buffer (through
+ * Mix_SetPostMix, so SDL_mixer's lock is already held). There's a single
+ * producer and a single consumer, so each side only moves its own index and
+ * publishing a command is a couple of atomic stores: triggering a sound
+ * never blocks the game while the device is mixing
+ *
+ * SDL_mixer only plays the music, sounds go through the engine's own mixer
+ * on top of it. They start in the buffer that's being finished when they're
+ * drained, music commands take effect on the next one. When the ring is full
+ * (the device isn't running) commands are dropped
+ */
+typedef struct
+{
+    ng_audio_command_t commands[NG_AUDIO_COMMANDS];
+
+    // Only the game thread writes `tail`, only the audio thread writes `head`
+    SDL_atomic_t head, tail;
+    SDL_atomic_t dropped_count;
+
+    bool is_open;
+    // Audio thread only
+    ng_mixer_t mixer;
+} ng_audio_t;
+
+// Opens the device (44100 Hz, 16 bit stereo, the format `make bake` converts
+// sounds to) with buffers of `samples` samples
+void ng_audio_open(int samples);
+void ng_audio_close(void);
 
 Mix_Chunk* ng_audio_load(const char *file);
+
+// These only queue a command, they are safe to call at any point of a frame
 void ng_audio_play(Mix_Chunk *audio);
+// Gain from 0 to 1, pan from -1 (left) to 1 (right). When there are too many
+// sounds playing, the ones with the lowest priority get cut off first
+void ng_audio_play_voice(Mix_Chunk *audio, float gain, float pan, int priority);
+void ng_audio_stop_sounds(void);
+void ng_audio_set_sound_volume(int volume);
+
+void ng_audio_play_music(Mix_Music *music, int loops);
+void ng_audio_pause_music(void);
+void ng_audio_resume_music(void);
+void ng_audio_stop_music(void);
+void ng_audio_set_music_volume(int volume);
+
+// Commands that didn't fit in the ring since the device was opened
+int ng_audio_get_dropped_count(void);
 
 #endif
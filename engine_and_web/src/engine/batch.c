@@ -0,0 +1,294 @@
+#include "batch.h"
+#include "common.h"
+#include "profiler.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_QUADS 64
+// Visible quads are drawn in chunks of this many at most when only parts of the target change
+#define VISIBLE_QUADS 256
+
+// Plain white keeps the texture colors untouched
+static SDL_Color white = {255, 255, 255, 255};
+
+// Makes sure that the buffer can hold at least `needed` elements,
+// doubling its capacity whenever it runs out of space
+static void* ensure_capacity(void *buffer, int *capacity, int needed, size_t element_size)
+{
+    if (needed <= *capacity)
+        return buffer;
+
+    int new_capacity = *capacity > 0 ? *capacity : INITIAL_QUADS;
+    while (new_capacity < needed)
+        new_capacity *= 2;
+
+    buffer = realloc(buffer, new_capacity * element_size);
+    if (!buffer)
+        ng_die("failed to grow the render batch to %d elements", new_capacity);
+
+    *capacity = new_capacity;
+    return buffer;
+}
+
+void ng_render_batch_create(ng_render_batch_t *batch, SDL_Renderer *renderer)
+{
+    batch->renderer = renderer;
+
+    batch->vertices = NULL;
+    batch->indices = NULL;
+    batch->runs = NULL;
+    batch->vertex_count = batch->vertex_capacity = 0;
+    batch->index_count = batch->index_capacity = 0;
+    batch->run_count = batch->run_capacity = 0;
+
+    batch->cached_texture = NULL;
+
+    batch->is_tracking = false;
+    batch->quads = batch->previous_quads = NULL;
+    batch->quad_count = batch->quad_capacity = 0;
+    batch->previous_quad_count = batch->previous_quad_capacity = 0;
+}
+
+void ng_render_batch_track_changes(ng_render_batch_t *batch, int width, int height, int grid, SDL_Color background)
+{
+    batch->is_tracking = true;
+    batch->background = background;
+
+    // Nothing has been drawn yet, whatever is on the target doesn't count
+    ng_dirty_create(&batch->invalidated, width, height, grid);
+    ng_dirty_create(&batch->dirty, width, height, grid);
+    ng_dirty_add_screen(&batch->invalidated);
+}
+
+void ng_render_batch_invalidate(ng_render_batch_t *batch, const SDL_FRect *area)
+{
+    if (batch->is_tracking)
+        ng_dirty_add(&batch->invalidated, area);
+}
+
+void ng_render_batch_invalidate_all(ng_render_batch_t *batch)
+{
+    if (batch->is_tracking)
+        ng_dirty_add_screen(&batch->invalidated);
+}
+
+void ng_render_batch_add(ng_render_batch_t *batch, ng_sprite_t *sprite)
+{
+    SDL_Texture *texture = sprite->texture;
+    NG_PROFILE_COUNT_SPRITE();
+
+    if (texture != batch->cached_texture)
+    {
+        int width, height;
+        SDL_QueryTexture(texture, NULL, NULL, &width, &height);
+
+        batch->cached_texture = texture;
+        batch->inv_width = 1.0f / width;
+        batch->inv_height = 1.0f / height;
+    }
+
+    // Start a new run only when the texture changes, otherwise
+    // we can keep on appending quads to the current one
+    ng_batch_run_t *run = batch->run_count > 0 ? &batch->runs[batch->run_count - 1] : NULL;
+    if (!run || run->texture != texture)
+    {
+        batch->runs = ensure_capacity(batch->runs, &batch->run_capacity,
+                                      batch->run_count + 1, sizeof(ng_batch_run_t));
+
+        run = &batch->runs[batch->run_count++];
+        run->texture = texture;
+        run->first_index = batch->index_count;
+        run->index_count = 0;
+    }
+
+    batch->vertices = ensure_capacity(batch->vertices, &batch->vertex_capacity,
+                                      batch->vertex_count + 4, sizeof(SDL_Vertex));
+    batch->indices = ensure_capacity(batch->indices, &batch->index_capacity,
+                                     batch->index_count + 6, sizeof(int));
+
+    SDL_FRect *dst = &sprite->transform;
+    SDL_Rect *src = &sprite->src;
+
+    float u0 = src->x * batch->inv_width, u1 = (src->x + src->w) * batch->inv_width;
+    float v0 = src->y * batch->inv_height, v1 = (src->y + src->h) * batch->inv_height;
+
+    // Corners in clockwise order, starting from the top left one
+    int base = batch->vertex_count;
+    SDL_Vertex *v = &batch->vertices[base];
+
+    v[0] = (SDL_Vertex) { { dst->x,          dst->y },          white, { u0, v0 } };
+    v[1] = (SDL_Vertex) { { dst->x + dst->w, dst->y },          white, { u1, v0 } };
+    v[2] = (SDL_Vertex) { { dst->x + dst->w, dst->y + dst->h }, white, { u1, v1 } };
+    v[3] = (SDL_Vertex) { { dst->x,          dst->y + dst->h }, white, { u0, v1 } };
+    batch->vertex_count += 4;
+
+    // Two triangles per quad
+    int *i = &batch->indices[batch->index_count];
+    i[0] = base;     i[1] = base + 1; i[2] = base + 2;
+    i[3] = base + 2; i[4] = base + 3; i[5] = base;
+    batch->index_count += 6;
+
+    run->index_count += 6;
+
+    if (batch->is_tracking)
+    {
+        batch->quads = ensure_capacity(batch->quads, &batch->quad_capacity,
+                                       batch->quad_count + 1, sizeof(ng_batch_quad_t));
+        batch->quads[batch->quad_count++] = (ng_batch_quad_t) { texture, *src, *dst };
+    }
+}
+
+static void draw_runs(ng_render_batch_t *batch)
+{
+    // Each run only references its own slice of the index buffer,
+    // but all of them share the very same vertex buffer
+    for (int r = 0; r < batch->run_count; r++)
+    {
+        ng_batch_run_t *run = &batch->runs[r];
+
+        SDL_RenderGeometry(batch->renderer, run->texture,
+                           batch->vertices, batch->vertex_count,
+                           batch->indices + run->first_index, run->index_count);
+
+        // Runs only end when the texture changes
+        NG_PROFILE_COUNT_DRAW_CALL();
+        if (r > 0)
+            NG_PROFILE_COUNT_TEXTURE_SWITCH();
+    }
+}
+
+static bool is_same_quad(ng_batch_quad_t *a, ng_batch_quad_t *b)
+{
+    return a->texture == b->texture &&
+           a->src.x == b->src.x && a->src.y == b->src.y &&
+           a->src.w == b->src.w && a->src.h == b->src.h &&
+           a->dst.x == b->dst.x && a->dst.y == b->dst.y &&
+           a->dst.w == b->dst.w && a->dst.h == b->dst.h;
+}
+
+static bool overlaps(const SDL_FRect *quad, const SDL_Rect *rect)
+{
+    return quad->x < rect->x + rect->w && quad->x + quad->w > rect->x &&
+           quad->y < rect->y + rect->h && quad->y + quad->h > rect->y;
+}
+
+// Both where a changed quad was and where it is now have to be drawn again
+static void find_changes(ng_render_batch_t *batch)
+{
+    ng_dirty_rects_t *dirty = &batch->dirty;
+    *dirty = batch->invalidated;
+    ng_dirty_clear(&batch->invalidated);
+
+    int count = MAX(batch->quad_count, batch->previous_quad_count);
+    for (int i = 0; i < count; i++)
+    {
+        ng_batch_quad_t *now = i < batch->quad_count ? &batch->quads[i] : NULL;
+        ng_batch_quad_t *before = i < batch->previous_quad_count ? &batch->previous_quads[i] : NULL;
+
+        if (now && before && is_same_quad(now, before))
+            continue;
+
+        if (now)
+            ng_dirty_add(dirty, &now->dst);
+        if (before)
+            ng_dirty_add(dirty, &before->dst);
+    }
+
+    ng_dirty_finish(dirty);
+}
+
+static void draw_visible(ng_render_batch_t *batch, SDL_Texture *texture, int *indices, int count)
+{
+    SDL_RenderGeometry(batch->renderer, texture, batch->vertices, batch->vertex_count, indices, count);
+    NG_PROFILE_COUNT_DRAW_CALL();
+}
+
+// Every dirty rectangle gets cleared, then only the quads touching it are drawn (clipped to it)
+static void draw_changes(ng_render_batch_t *batch)
+{
+    SDL_Renderer *renderer = batch->renderer;
+    SDL_Color *background = &batch->background;
+
+    // Indices of the quads that touch the rectangle being drawn, sent whenever it fills up
+    int visible_indices[VISIBLE_QUADS * 6];
+
+    for (int d = 0; d < batch->dirty.count; d++)
+    {
+        SDL_Rect *rect = &batch->dirty.rects[d];
+
+        SDL_RenderSetClipRect(renderer, rect);
+        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+        SDL_SetRenderDrawColor(renderer, background->r, background->g, background->b, background->a);
+        SDL_RenderFillRect(renderer, rect);
+
+        for (int r = 0; r < batch->run_count; r++)
+        {
+            ng_batch_run_t *run = &batch->runs[r];
+
+            // Quads were queued one at a time, so the n-th one owns indices 6n to 6n + 5
+            int visible_count = 0;
+            for (int i = run->first_index; i < run->first_index + run->index_count; i += 6)
+            {
+                if (!overlaps(&batch->quads[i / 6].dst, rect))
+                    continue;
+
+                memcpy(visible_indices + visible_count, batch->indices + i, 6 * sizeof(int));
+                visible_count += 6;
+
+                // Quads of the same run don't depend on each other's draw call, order is all that matters
+                if (visible_count == VISIBLE_QUADS * 6)
+                {
+                    draw_visible(batch, run->texture, visible_indices, visible_count);
+                    visible_count = 0;
+                }
+            }
+
+            if (visible_count > 0)
+                draw_visible(batch, run->texture, visible_indices, visible_count);
+        }
+    }
+
+    SDL_RenderSetClipRect(renderer, NULL);
+}
+
+// This frame is what the next one gets compared to
+static void swap_quads(ng_render_batch_t *batch)
+{
+    ng_batch_quad_t *quads = batch->previous_quads;
+    int capacity = batch->previous_quad_capacity;
+    batch->previous_quads = batch->quads;
+    batch->previous_quad_capacity = batch->quad_capacity;
+    batch->previous_quad_count = batch->quad_count;
+    batch->quads = quads;
+    batch->quad_capacity = capacity;
+    batch->quad_count = 0;
+}
+
+void ng_render_batch_flush(ng_render_batch_t *batch)
+{
+    if (batch->is_tracking)
+    {
+        find_changes(batch);
+        draw_changes(batch);
+        swap_quads(batch);
+    }
+    else
+        draw_runs(batch);
+
+    batch->vertex_count = 0;
+    batch->index_count = 0;
+    batch->run_count = 0;
+
+    // Textures might get destroyed between frames (labels do that) and a new
+    // one could end up at the same address, so forget about the cached size
+    batch->cached_texture = NULL;
+}
+
+void ng_render_batch_destroy(ng_render_batch_t *batch)
+{
+    free(batch->vertices);
+    free(batch->indices);
+    free(batch->runs);
+    free(batch->quads);
+    free(batch->previous_quads);
+}
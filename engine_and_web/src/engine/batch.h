@@ -0,0 +1,88 @@
+#ifndef _NG_BATCH_H
+#define _NG_BATCH_H
+
+#include <SDL2/SDL.h>
+#include "sprite.h"
+#include "dirty.h"
+
+// A range of indices inside the shared index buffer that
+// can be drawn with a single texture bind
+typedef struct
+{
+    SDL_Texture *texture;
+
+    int first_index;
+    int index_count;
+} ng_batch_run_t;
+
+// What got drawn where, to tell which parts of the screen changed between two frames
+typedef struct
+{
+    SDL_Texture *texture;
+    SDL_Rect src;
+    SDL_FRect dst;
+} ng_batch_quad_t;
+
+/*
+ * Sprites are queued during the frame and flushed all at once with a few
+ * SDL_RenderGeometry calls. Consecutive sprites that share a texture end up
+ * in the same run, so the draw order is exactly the order of submission.
+ * Pack your textures together (see atlas.h) to get longer runs
+ */
+typedef struct
+{
+    SDL_Renderer *renderer;
+
+    // One vertex/index buffer shared by every run of the frame
+    SDL_Vertex *vertices;
+    int vertex_count, vertex_capacity;
+
+    int *indices;
+    int index_count, index_capacity;
+
+    ng_batch_run_t *runs;
+    int run_count, run_capacity;
+
+    // The size of the last queued texture is remembered so that
+    // we don't have to query it again for every single sprite
+    SDL_Texture *cached_texture;
+    float inv_width, inv_height;
+
+    // Dirty rectangle mode, see ng_render_batch_track_changes
+    bool is_tracking;
+    SDL_Color background;
+
+    // The quads of this frame get compared to the ones of the last one
+    ng_batch_quad_t *quads, *previous_quads;
+    int quad_count, quad_capacity;
+    int previous_quad_count, previous_quad_capacity;
+
+    // Areas invalidated since the last flush, then what that flush drew again
+    ng_dirty_rects_t invalidated;
+    ng_dirty_rects_t dirty;
+} ng_render_batch_t;
+
+void ng_render_batch_create(ng_render_batch_t *batch, SDL_Renderer *renderer);
+
+// Queues the sprite, nothing is drawn until the batch gets flushed
+// NOTE: Don't destroy a queued texture before flushing the batch
+void ng_render_batch_add(ng_render_batch_t *batch, ng_sprite_t *sprite);
+void ng_render_batch_flush(ng_render_batch_t *batch);
+
+// From now on, flushing only clears (to the background color) and draws again
+// the parts of the screen that changed since the last flush, leaving the rest
+// of the target as it was. Those parts are kept in `dirty` until the next
+// flush, so the caller can present just them. The first flush draws it all
+// Quads are compared in the order they were queued, one that's added or
+// removed in the middle makes everything after it count as changed
+// Calling it again starts over, e.g. when the target changes size. The
+// rectangles are snapped to `grid` (see ng_dirty_create)
+// NOTE: The target has to keep its pixels between frames (e.g. a window surface)
+void ng_render_batch_track_changes(ng_render_batch_t *batch, int width, int height, int grid, SDL_Color background);
+// For changes the batch can't see, like new pixels in a texture it already drew
+void ng_render_batch_invalidate(ng_render_batch_t *batch, const SDL_FRect *area);
+void ng_render_batch_invalidate_all(ng_render_batch_t *batch);
+
+void ng_render_batch_destroy(ng_render_batch_t *batch);
+
+#endif
@@ -0,0 +1,91 @@
+#include "bench.h"
+#include "common.h"
+#include "streams.h"
+#include "mixer.h"
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <string.h>
+
+void ng_bench_create(ng_bench_t *bench)
+{
+    bench->is_running = false;
+    bench->section_count = 0;
+    bench->current = -1;
+}
+
+void ng_bench_start(ng_bench_t *bench)
+{
+    bench->is_running = true;
+    bench->frames = 0;
+    bench->start_time = bench->last_time = SDL_GetPerformanceCounter();
+}
+
+void ng_bench_set_section(ng_bench_t *bench, const char *name)
+{
+    if (!bench->is_running)
+        return;
+
+    // The same section keeps on being set every frame, only a pointer compare then
+    if (bench->current >= 0 && bench->sections[bench->current].name == name)
+        return;
+
+    for (int i = 0; i < bench->section_count; i++)
+    {
+        if (strcmp(bench->sections[i].name, name) == 0)
+        {
+            bench->current = i;
+            return;
+        }
+    }
+
+    if (bench->section_count == NG_BENCH_MAX_SECTIONS)
+        ng_die("too many benchmark sections, the limit is %d", NG_BENCH_MAX_SECTIONS);
+
+    bench->current = bench->section_count++;
+    bench->sections[bench->current] = (ng_bench_section_t) { name, 0, 0, 0 };
+}
+
+void ng_bench_end_frame(ng_bench_t *bench)
+{
+    if (!bench->is_running)
+        return;
+
+    uint64_t now = SDL_GetPerformanceCounter();
+    uint64_t elapsed = now - bench->last_time;
+    bench->last_time = now;
+    bench->frames++;
+
+    // Frames before the first section only show up in the total
+    if (bench->current < 0)
+        return;
+
+    ng_bench_section_t *section = &bench->sections[bench->current];
+    section->frames++;
+    section->ticks += elapsed;
+    section->worst_ticks = MAX(section->worst_ticks, elapsed);
+}
+
+void ng_bench_report(ng_bench_t *bench)
+{
+    if (!bench->is_running)
+        return;
+
+    double frequency = SDL_GetPerformanceFrequency();
+    double seconds = (bench->last_time - bench->start_time) / frequency;
+
+    printf("[bench] %d frames in %.3fs, %.1f frames/sec (streams %s, mixer %s)\n", bench->frames, seconds,
+           seconds > 0 ? bench->frames / seconds : 0.0, ng_streams_get_instruction_set(),
+           ng_mixer_get_instruction_set());
+
+    for (int i = 0; i < bench->section_count; i++)
+    {
+        ng_bench_section_t *section = &bench->sections[i];
+        double section_seconds = section->ticks / frequency;
+
+        printf("[bench]   %-16s %6d frames %8.3fs %10.1f frames/sec  avg %.3fms  worst %.3fms\n",
+               section->name, section->frames, section_seconds,
+               section_seconds > 0 ? section->frames / section_seconds : 0.0,
+               section->frames > 0 ? section_seconds * 1000 / section->frames : 0.0,
+               section->worst_ticks * 1000 / frequency);
+    }
+}
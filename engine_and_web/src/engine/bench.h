@@ -0,0 +1,46 @@
+#ifndef _NG_BENCH_H
+#define _NG_BENCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define NG_BENCH_MAX_SECTIONS 16
+
+typedef struct
+{
+    const char *name;
+
+    int frames;
+    uint64_t ticks;
+    uint64_t worst_ticks;
+} ng_bench_section_t;
+
+/*
+ * Measures how fast frames go by during a headless run. The game names the
+ * section it is in (usually the current scene) and every frame is counted
+ * towards whichever section was active when it ended
+ */
+typedef struct
+{
+    bool is_running;
+
+    ng_bench_section_t sections[NG_BENCH_MAX_SECTIONS];
+    int section_count;
+    int current;
+
+    int frames;
+    uint64_t start_time;
+    uint64_t last_time;
+} ng_bench_t;
+
+void ng_bench_create(ng_bench_t *bench);
+void ng_bench_start(ng_bench_t *bench);
+
+// NOTE: The name is not copied, pass a string literal
+void ng_bench_set_section(ng_bench_t *bench, const char *name);
+void ng_bench_end_frame(ng_bench_t *bench);
+
+// Prints out frames/sec for the whole run and for every section
+void ng_bench_report(ng_bench_t *bench);
+
+#endif
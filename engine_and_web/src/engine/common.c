@@ -1,8 +1,13 @@
 #include "common.h"
+#include "rng.h"
+#include <SDL2/SDL.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
 
+// Used by the ng_random_* functions, this is what ng_random_seed(0) would set up
+static ng_rng_t random_generator = { 0x5851f42d4c957f2eULL, 1 };
+
 void ng_die(const char *format, ...)
 {
     va_list args;
@@ -17,12 +22,31 @@ void ng_die(const char *format, ...)
     exit(EXIT_FAILURE);
 }
 
+void ng_random_seed(uint64_t seed)
+{
+    ng_rng_create(&random_generator, seed, 0);
+}
+
 int ng_random_int_in_range(int start, int end)
 {
-    return start + rand() % (end - start);
+    return ng_rng_int_in_range(&random_generator, start, end);
 }
 
 bool ng_random_bool(void)
 {
-    return rand() % 2;
+    return ng_rng_bool(&random_generator);
+}
+
+ng_instruction_set_t ng_get_instruction_set(void)
+{
+#if defined(HAS_X86)
+    if (SDL_HasAVX2())
+        return NG_AVX2;
+    if (SDL_HasSSE2())
+        return NG_SSE2;
+#elif defined(__wasm_simd128__)
+    return NG_SIMD128;
+#endif
+
+    return NG_SCALAR;
 }
@@ -2,14 +2,42 @@
 #define _NG_COMMON_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 // Some simple macros
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 #define MAX(a, b) ((a) < (b) ? (b) : (a))
+#define CLAMP(x, low, high) MIN(MAX(x, low), high)
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define HAS_X86
+#endif
+
+// Lets single functions use SSE2/AVX2 without compiling everything else with -mavx2
+#ifdef __GNUC__
+#define TARGET(isa) __attribute__((target(isa)))
+#else
+#define TARGET(isa)
+#endif
+
+typedef enum
+{
+    NG_SCALAR,
+    NG_SSE2,
+    NG_AVX2,
+    NG_SIMD128
+} ng_instruction_set_t;
+
+// The fastest instruction set the streams and the mixer can use on this machine
+ng_instruction_set_t ng_get_instruction_set(void);
 
 // Just prints out the messages and kills the program
 void ng_die(const char *format, ...);
 
+// Shortcuts for the game's own generator (see rng.h), the same seed gives
+// the same numbers on every platform
+// NOTE: Main thread only, anything else should have its own ng_rng_t
+void ng_random_seed(uint64_t seed);
 int ng_random_int_in_range(int start, int end);
 bool ng_random_bool(void);
 
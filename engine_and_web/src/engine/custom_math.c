@@ -8,6 +8,11 @@ float ng_vector_get_magnitude(ng_vec2 *source)
     return sqrt(SQUARE(source->x) + SQUARE(source->y));
 }
 
+float ng_vector_get_squared_magnitude(ng_vec2 *source)
+{
+    return SQUARE(source->x) + SQUARE(source->y);
+}
+
 void ng_vector_multiply_by(ng_vec2 *result, ng_vec2 *source, float scalar)
 {
     result->x = source->x * scalar;
@@ -10,6 +10,8 @@ typedef struct
 } ng_vec2;
 
 float ng_vector_get_magnitude(ng_vec2 *source);
+// Cheaper, compare it against the squared distance instead
+float ng_vector_get_squared_magnitude(ng_vec2 *source);
 void ng_vector_normalize(ng_vec2 *result, ng_vec2 *source);
 void ng_vector_multiply_by(ng_vec2 *result, ng_vec2 *source, float scalar);
 
@@ -0,0 +1,108 @@
+#include "dirty.h"
+#include "common.h"
+#include <math.h>
+
+// Past this share of the screen, the whole thing gets redrawn in one go
+#define FULL_SCREEN_RATIO 0.6
+
+void ng_dirty_create(ng_dirty_rects_t *dirty, int width, int height, int grid)
+{
+    dirty->width = width;
+    dirty->height = height;
+    dirty->grid = grid;
+    dirty->count = 0;
+}
+
+static int get_area(const SDL_Rect *rect)
+{
+    return rect->w * rect->h;
+}
+
+// Pixels drawn for nothing when both are covered by a single rectangle,
+// it's negative when they overlap (those pixels would be drawn twice otherwise)
+static int get_merge_cost(const SDL_Rect *a, const SDL_Rect *b)
+{
+    SDL_Rect both;
+    SDL_UnionRect(a, b, &both);
+
+    return get_area(&both) - get_area(a) - get_area(b);
+}
+
+void ng_dirty_add(ng_dirty_rects_t *dirty, const SDL_FRect *area)
+{
+    // Partially covered pixels (or grid cells) count as dirty too
+    float grid = dirty->grid;
+    int left = MAX((int) (floorf(area->x / grid) * grid), 0);
+    int top = MAX((int) (floorf(area->y / grid) * grid), 0);
+    int right = MIN((int) (ceilf((area->x + area->w) / grid) * grid), dirty->width);
+    int bottom = MIN((int) (ceilf((area->y + area->h) / grid) * grid), dirty->height);
+
+    if (right <= left || bottom <= top)
+        return;
+
+    SDL_Rect rect = {left, top, right - left, bottom - top};
+
+    // A merged rectangle might be worth merging with ones it skipped before, so start over every time
+    for (int i = 0; i < dirty->count; )
+    {
+        if (get_merge_cost(&rect, &dirty->rects[i]) > 0)
+        {
+            i++;
+            continue;
+        }
+
+        SDL_Rect merged;
+        SDL_UnionRect(&rect, &dirty->rects[i], &merged);
+        rect = merged;
+
+        dirty->rects[i] = dirty->rects[--dirty->count];
+        i = 0;
+    }
+
+    if (dirty->count < NG_MAX_DIRTY_RECTS)
+    {
+        dirty->rects[dirty->count++] = rect;
+        return;
+    }
+
+    // Out of rectangles, this one goes into whichever grows the least
+    int best = 0;
+    for (int i = 1; i < dirty->count; i++)
+    {
+        if (get_merge_cost(&rect, &dirty->rects[i]) < get_merge_cost(&rect, &dirty->rects[best]))
+            best = i;
+    }
+
+    SDL_Rect merged;
+    SDL_UnionRect(&rect, &dirty->rects[best], &merged);
+    dirty->rects[best] = merged;
+}
+
+void ng_dirty_add_screen(ng_dirty_rects_t *dirty)
+{
+    dirty->rects[0] = (SDL_Rect) {0, 0, dirty->width, dirty->height};
+    dirty->count = 1;
+}
+
+void ng_dirty_finish(ng_dirty_rects_t *dirty)
+{
+    // Rectangles can still overlap after running out of them, so this overestimates a bit
+    double area = 0;
+    for (int i = 0; i < dirty->count; i++)
+        area += get_area(&dirty->rects[i]);
+
+    if (area >= FULL_SCREEN_RATIO * dirty->width * dirty->height)
+        ng_dirty_add_screen(dirty);
+}
+
+void ng_dirty_clear(ng_dirty_rects_t *dirty)
+{
+    dirty->count = 0;
+}
+
+bool ng_dirty_is_screen(const ng_dirty_rects_t *dirty)
+{
+    const SDL_Rect *rect = &dirty->rects[0];
+    return dirty->count == 1 && rect->x == 0 && rect->y == 0 &&
+           rect->w == dirty->width && rect->h == dirty->height;
+}
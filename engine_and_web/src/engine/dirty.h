@@ -0,0 +1,43 @@
+#ifndef _NG_DIRTY_H
+#define _NG_DIRTY_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+// Past this many, every new area gets merged into the rectangle it grows the least
+#define NG_MAX_DIRTY_RECTS 32
+
+/*
+ * The parts of the screen that have to be drawn again. Areas are rounded out
+ * to whole pixels and clipped to the screen as they come in, then merged into
+ * any rectangle where covering both at once costs no more pixels than drawing
+ * them apart (overlapping or touching ones, mostly). A sprite that moves a
+ * bit ends up as a single rectangle over its old and new position, while
+ * things at opposite corners of the screen stay separate
+ *
+ * Rectangles are also snapped to a grid, so that each one covers whole
+ * pixels of a target that's smaller than the screen (see the pixel scale)
+ */
+typedef struct
+{
+    SDL_Rect rects[NG_MAX_DIRTY_RECTS];
+    int count;
+
+    int width, height;
+    int grid;
+} ng_dirty_rects_t;
+
+// NOTE: Pass 1 as the grid to snap to single pixels
+void ng_dirty_create(ng_dirty_rects_t *dirty, int width, int height, int grid);
+
+void ng_dirty_add(ng_dirty_rects_t *dirty, const SDL_FRect *area);
+void ng_dirty_add_screen(ng_dirty_rects_t *dirty);
+
+// Once most of the screen is dirty, a single rectangle over all of it is cheaper
+void ng_dirty_finish(ng_dirty_rects_t *dirty);
+void ng_dirty_clear(ng_dirty_rects_t *dirty);
+
+// Whether a single rectangle covers all of the screen
+bool ng_dirty_is_screen(const ng_dirty_rects_t *dirty);
+
+#endif
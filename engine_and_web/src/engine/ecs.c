@@ -0,0 +1,320 @@
+#include "ecs.h"
+#include "common.h"
+#include "streams.h"
+#include <stdlib.h>
+#include <string.h>
+
+// The lower bits of a handle are the slot, the rest is the slot's generation
+#define SLOT_BITS 20
+#define SLOT_MASK ((1u << SLOT_BITS) - 1)
+#define MAX_GENERATION (UINT32_MAX >> SLOT_BITS)
+
+#define MAKE_HANDLE(slot, generation) ((ng_entity_t) ((generation) << SLOT_BITS | (slot)))
+
+// Entities moved by a single job of ng_world_integrate_parallel
+#define INTEGRATE_GRAIN 4096
+
+static void* grow(void *column, int capacity, size_t element_size)
+{
+    column = realloc(column, capacity * element_size);
+    if (!column)
+        ng_die("failed to grow the entity storage to %d entities", capacity);
+
+    return column;
+}
+
+static void set_capacity(ng_world_t *world, int capacity)
+{
+    if (capacity > (int) SLOT_MASK + 1)
+        ng_die("too many entities, the limit is %d", SLOT_MASK + 1);
+
+    world->masks = grow(world->masks, capacity, sizeof(uint32_t));
+    world->x = grow(world->x, capacity, sizeof(float));
+    world->y = grow(world->y, capacity, sizeof(float));
+    world->previous_x = grow(world->previous_x, capacity, sizeof(float));
+    world->previous_y = grow(world->previous_y, capacity, sizeof(float));
+    world->vx = grow(world->vx, capacity, sizeof(float));
+    world->vy = grow(world->vy, capacity, sizeof(float));
+    world->w = grow(world->w, capacity, sizeof(float));
+    world->h = grow(world->h, capacity, sizeof(float));
+    world->textures = grow(world->textures, capacity, sizeof(SDL_Texture*));
+    world->src = grow(world->src, capacity, sizeof(SDL_Rect));
+    world->frames = grow(world->frames, capacity, sizeof(int));
+    world->total_frames = grow(world->total_frames, capacity, sizeof(int));
+
+    world->slot_of_index = grow(world->slot_of_index, capacity, sizeof(int));
+
+    world->capacity = capacity;
+}
+
+void ng_world_create(ng_world_t *world, int capacity)
+{
+    memset(world, 0, sizeof(ng_world_t));
+    set_capacity(world, MAX(capacity, 1));
+
+    // Never more slots than entities, it grows along with the columns
+    ng_pool_create(&world->slots, sizeof(ng_entity_slot_t), world->capacity, true);
+}
+
+ng_entity_t ng_world_spawn(ng_world_t *world, uint32_t mask)
+{
+    if (world->count == world->capacity)
+        set_capacity(world, world->capacity * 2);
+
+    int slot = ng_pool_acquire(&world->slots);
+    ng_entity_slot_t *entry = ng_pool_get(&world->slots, slot);
+
+    // Fresh slots are zeroed, but 0 is reserved for NG_NO_ENTITY
+    if (entry->generation == 0)
+        entry->generation = 1;
+
+    int i = world->count++;
+    world->slot_of_index[i] = slot;
+    entry->index = i;
+
+    world->masks[i] = mask;
+    world->x[i] = world->y[i] = 0;
+    world->previous_x[i] = world->previous_y[i] = 0;
+    world->vx[i] = world->vy[i] = 0;
+    world->w[i] = world->h[i] = 0;
+    world->textures[i] = NULL;
+    world->src[i] = (SDL_Rect) {0, 0, 0, 0};
+    world->frames[i] = 0;
+    world->total_frames[i] = 1;
+
+    return MAKE_HANDLE(slot, entry->generation);
+}
+
+int ng_world_index_of(ng_world_t *world, ng_entity_t entity)
+{
+    int slot = entity & SLOT_MASK;
+    if (entity == NG_NO_ENTITY || !ng_pool_is_live(&world->slots, slot))
+        return -1;
+
+    ng_entity_slot_t *entry = ng_pool_get(&world->slots, slot);
+    return entry->generation == entity >> SLOT_BITS ? entry->index : -1;
+}
+
+bool ng_world_is_alive(ng_world_t *world, ng_entity_t entity)
+{
+    return ng_world_index_of(world, entity) >= 0;
+}
+
+ng_entity_t ng_world_entity_at(ng_world_t *world, int index)
+{
+    int slot = world->slot_of_index[index];
+    ng_entity_slot_t *entry = ng_pool_get(&world->slots, slot);
+
+    return MAKE_HANDLE(slot, entry->generation);
+}
+
+static void kill_at(ng_world_t *world, int i)
+{
+    int slot = world->slot_of_index[i];
+    ng_entity_slot_t *entry = ng_pool_get(&world->slots, slot);
+
+    // Old handles to this slot are no longer valid (0 is never used, so NG_NO_ENTITY stays invalid)
+    entry->generation = entry->generation == MAX_GENERATION ? 1 : entry->generation + 1;
+    ng_pool_release(&world->slots, slot);
+
+    // Move the last entity into the hole, that keeps the arrays packed
+    int last = --world->count;
+    if (i != last)
+    {
+        world->masks[i] = world->masks[last];
+        world->x[i] = world->x[last];
+        world->y[i] = world->y[last];
+        world->previous_x[i] = world->previous_x[last];
+        world->previous_y[i] = world->previous_y[last];
+        world->vx[i] = world->vx[last];
+        world->vy[i] = world->vy[last];
+        world->w[i] = world->w[last];
+        world->h[i] = world->h[last];
+        world->textures[i] = world->textures[last];
+        world->src[i] = world->src[last];
+        world->frames[i] = world->frames[last];
+        world->total_frames[i] = world->total_frames[last];
+
+        int moved_slot = world->slot_of_index[last];
+        world->slot_of_index[i] = moved_slot;
+        ((ng_entity_slot_t*) ng_pool_get(&world->slots, moved_slot))->index = i;
+    }
+}
+
+void ng_world_kill(ng_world_t *world, ng_entity_t entity)
+{
+    int i = ng_world_index_of(world, entity);
+    if (i >= 0)
+        kill_at(world, i);
+}
+
+void ng_world_kill_all(ng_world_t *world, uint32_t mask)
+{
+    ng_query_t query;
+    ng_query_begin(&query, world, mask);
+
+    while (ng_query_next(&query))
+        kill_at(world, query.index);
+}
+
+void ng_world_set_sprite(ng_world_t *world, int i, ng_sprite_t *sprite)
+{
+    world->textures[i] = sprite->texture;
+    world->src[i] = sprite->src;
+    world->x[i] = sprite->transform.x;
+    world->y[i] = sprite->transform.y;
+    world->previous_x[i] = sprite->transform.x;
+    world->previous_y[i] = sprite->transform.y;
+    world->w[i] = sprite->transform.w;
+    world->h[i] = sprite->transform.h;
+}
+
+void ng_world_set_frame(ng_world_t *world, int i, int frame)
+{
+    // Same as ng_animated_set_frame, the region just slides over
+    world->src[i].x += (frame - world->frames[i]) * world->src[i].w;
+    world->frames[i] = frame;
+}
+
+void ng_query_begin(ng_query_t *query, ng_world_t *world, uint32_t mask)
+{
+    query->world = world;
+    query->mask = mask;
+    query->index = world->count;
+}
+
+bool ng_query_next(ng_query_t *query)
+{
+    uint32_t *masks = query->world->masks;
+
+    // Entities that got moved into a killed one's place have already been visited
+    query->index = MIN(query->index, query->world->count);
+    while (--query->index >= 0)
+    {
+        if ((masks[query->index] & query->mask) == query->mask)
+            return true;
+    }
+
+    return false;
+}
+
+static void integrate_range(ng_world_t *world, float delta, int first, int end)
+{
+    const uint32_t mask = NG_POSITION | NG_VELOCITY;
+
+    // Moving entities usually sit next to each other, every run of them
+    // goes through the vectorized version in one call
+    int start = first;
+    for (int i = first; i <= end; i++)
+    {
+        if (i < end && (world->masks[i] & mask) == mask)
+            continue;
+
+        if (i > start)
+            ng_streams_multiply_add(world->x + start, world->y + start,
+                                    world->vx + start, world->vy + start, delta, i - start);
+        start = i + 1;
+    }
+}
+
+void ng_world_integrate(ng_world_t *world, float delta)
+{
+    integrate_range(world, delta, 0, world->count);
+}
+
+typedef struct
+{
+    ng_world_t *world;
+    float delta;
+} integrate_job_t;
+
+static void run_integrate_job(void *userdata, int start, int end)
+{
+    integrate_job_t *job = userdata;
+    integrate_range(job->world, job->delta, start, end);
+}
+
+void ng_world_integrate_parallel(ng_world_t *world, ng_jobs_t *jobs, float delta)
+{
+    // Below this, waking up the workers costs more than the work itself
+    if (world->count < 2 * INTEGRATE_GRAIN || jobs->worker_count == 0)
+    {
+        ng_world_integrate(world, delta);
+        return;
+    }
+
+    // Every job writes to its own range of the columns, nothing is shared
+    integrate_job_t job = { world, delta };
+    ng_job_counter_t done;
+    ng_jobs_counter_init(&done);
+    ng_jobs_parallel_for(jobs, run_integrate_job, &job, world->count, INTEGRATE_GRAIN, &done);
+    ng_jobs_wait(jobs, &done);
+}
+
+void ng_world_save_positions(ng_world_t *world)
+{
+    memcpy(world->previous_x, world->x, world->count * sizeof(float));
+    memcpy(world->previous_y, world->y, world->count * sizeof(float));
+}
+
+static void render_at(ng_world_t *world, ng_render_batch_t *batch, int i, float x, float y)
+{
+    ng_sprite_t sprite = {
+        world->textures[i], world->src[i], { x, y, world->w[i], world->h[i] }
+    };
+
+    ng_render_batch_add(batch, &sprite);
+}
+
+void ng_world_render(ng_world_t *world, ng_render_batch_t *batch, uint32_t mask)
+{
+    mask |= NG_POSITION | NG_SPRITE;
+
+    for (int i = 0; i < world->count; i++)
+    {
+        if ((world->masks[i] & mask) == mask)
+            render_at(world, batch, i, world->x[i], world->y[i]);
+    }
+}
+
+void ng_world_render_interpolated(ng_world_t *world, ng_render_batch_t *batch, uint32_t mask, float alpha)
+{
+    mask |= NG_POSITION | NG_SPRITE;
+
+    for (int i = 0; i < world->count; i++)
+    {
+        if ((world->masks[i] & mask) != mask)
+            continue;
+
+        float x = world->previous_x[i] + (world->x[i] - world->previous_x[i]) * alpha;
+        float y = world->previous_y[i] + (world->y[i] - world->previous_y[i]) * alpha;
+        render_at(world, batch, i, x, y);
+    }
+}
+
+void ng_world_render_entity(ng_world_t *world, ng_render_batch_t *batch, ng_entity_t entity)
+{
+    int i = ng_world_index_of(world, entity);
+    if (i >= 0)
+        render_at(world, batch, i, world->x[i], world->y[i]);
+}
+
+void ng_world_destroy(ng_world_t *world)
+{
+    free(world->masks);
+    free(world->x);
+    free(world->y);
+    free(world->previous_x);
+    free(world->previous_y);
+    free(world->vx);
+    free(world->vy);
+    free(world->w);
+    free(world->h);
+    free(world->textures);
+    free(world->src);
+    free(world->frames);
+    free(world->total_frames);
+
+    free(world->slot_of_index);
+    ng_pool_destroy(&world->slots);
+}
@@ -0,0 +1,118 @@
+#ifndef _NG_ECS_H
+#define _NG_ECS_H
+
+#include <SDL2/SDL.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "sprite.h"
+#include "batch.h"
+#include "pool.h"
+#include "jobs.h"
+
+// Handles stay valid until the entity is killed, and never get
+// mistaken for another entity that ends up in the same slot later on
+typedef uint32_t ng_entity_t;
+#define NG_NO_ENTITY 0
+
+// What a handle points to. The generation changes whenever the
+// slot is released, which invalidates the handles given out before
+typedef struct
+{
+    int index;
+    uint32_t generation;
+} ng_entity_slot_t;
+
+// Which components an entity has, the game can define its own
+// tags (components without any data) starting at NG_FIRST_TAG
+enum
+{
+    NG_POSITION = 1 << 0,
+    NG_VELOCITY = 1 << 1,
+    NG_SPRITE = 1 << 2,
+    NG_ANIMATION = 1 << 3,
+    NG_FIRST_TAG = 1 << 8
+};
+
+/*
+ * Entities are stored as a structure of arrays: every component field gets
+ * its own array and entity i lives at index i of all of them. Loops that only
+ * touch positions then go through nothing but tightly packed floats
+ *
+ * Living entities are always kept at the front of the arrays, killing one
+ * moves the last entity into its place (handles follow along)
+ */
+typedef struct
+{
+    int count, capacity;
+
+    uint32_t *masks;
+
+    // NG_POSITION
+    float *x, *y;
+    // Where they were before the last update, see ng_world_save_positions
+    float *previous_x, *previous_y;
+    // NG_VELOCITY, in pixels per second
+    float *vx, *vy;
+    // NG_SPRITE, the size is the size on the screen
+    float *w, *h;
+    SDL_Texture **textures;
+    SDL_Rect *src;
+    // NG_ANIMATION, frames are laid out horizontally (see ng_animated_sprite_t)
+    int *frames, *total_frames;
+
+    // Handles point to slots (ng_entity_slot_t), which point to the actual index of the entity
+    ng_pool_t slots;
+    int *slot_of_index;
+} ng_world_t;
+
+// Goes through all the entities that have (at least) the given components
+// NOTE: Runs backwards, so the current entity can be killed during the loop
+typedef struct
+{
+    ng_world_t *world;
+    uint32_t mask;
+
+    int index;
+} ng_query_t;
+
+void ng_world_create(ng_world_t *world, int capacity);
+
+// Every component starts out zeroed
+ng_entity_t ng_world_spawn(ng_world_t *world, uint32_t mask);
+void ng_world_kill(ng_world_t *world, ng_entity_t entity);
+// Kills every entity that has the given components
+void ng_world_kill_all(ng_world_t *world, uint32_t mask);
+
+bool ng_world_is_alive(ng_world_t *world, ng_entity_t entity);
+// Where the entity's components are right now, -1 for dead entities
+// NOTE: Indices change when other entities are killed, don't keep them around
+int ng_world_index_of(ng_world_t *world, ng_entity_t entity);
+ng_entity_t ng_world_entity_at(ng_world_t *world, int index);
+
+// Copies the texture, region, position and size of an existing sprite
+// NOTE: It's a placement, the entity doesn't move from its previous position
+void ng_world_set_sprite(ng_world_t *world, int index, ng_sprite_t *sprite);
+void ng_world_set_frame(ng_world_t *world, int index, int frame);
+
+void ng_query_begin(ng_query_t *query, ng_world_t *world, uint32_t mask);
+// The index of the current entity is in query->index
+bool ng_query_next(ng_query_t *query);
+
+// Moves every entity with a position and a velocity
+void ng_world_integrate(ng_world_t *world, float delta);
+// Same, split across the job system's threads when there are enough entities
+void ng_world_integrate_parallel(ng_world_t *world, ng_jobs_t *jobs, float delta);
+
+// Call it before every update, rendering can then draw the entities
+// anywhere between where they were and where the update moved them
+void ng_world_save_positions(ng_world_t *world);
+
+// Queues every sprite with the given components, in storage order
+void ng_world_render(ng_world_t *world, ng_render_batch_t *batch, uint32_t mask);
+// Same, at `alpha` (0 to 1) of the way from the saved positions to the current ones
+void ng_world_render_interpolated(ng_world_t *world, ng_render_batch_t *batch, uint32_t mask, float alpha);
+void ng_world_render_entity(ng_world_t *world, ng_render_batch_t *batch, ng_entity_t entity);
+
+void ng_world_destroy(ng_world_t *world);
+
+#endif
@@ -1,19 +1,52 @@
 #include "game.h"
 #include "common.h"
+#include "profiler.h"
+#include "timers.h"
+#include "audio.h"
+#include "streams.h"
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_ttf.h>
 #include <SDL2/SDL_mixer.h>
+#include <math.h>
+#include <string.h>
 #include <time.h>
 
 // You might want to change that!
 #define FPS 60
-#define IDEAL_MS_PER_FRAME (1000.0 / FPS)
 
-void ng_game_create(ng_game_t *game, const char *title, int width, int height)
+// SDL_Delay is only accurate to a couple of milliseconds,
+// the rest of the frame time is spent spinning on the clock
+#define SPIN_MS 2
+
+// Never simulate more than that in a single frame, otherwise a long
+// stall would make us fall further and further behind (spiral of death)
+#define MAX_FRAME_SECONDS 0.25
+
+// Any seed works, as long as it's the same on every headless run
+#define HEADLESS_SEED 1
+
+// Everything a frame allocates for itself has to fit in here
+#define FRAME_ARENA_SIZE (1024 * 1024)
+
+// Whatever no sprite covers
+static SDL_Color background = {10, 10, 10, 255};
+
+static void create(ng_game_t *game, const char *title, int width, int height, bool is_headless)
 {
     // Provide the randomness generator with a unique seed
-    srand(time(NULL));
-    
+    game->seed = is_headless ? HEADLESS_SEED : time(NULL);
+    ng_random_seed(game->seed);
+
+    // Job workers call the stream functions, their version can't be picked lazily
+    ng_streams_init();
+
+    // Has to happen before SDL picks its drivers
+    if (is_headless)
+    {
+        SDL_setenv("SDL_VIDEODRIVER", "dummy", true);
+        SDL_setenv("SDL_AUDIODRIVER", "dummy", true);
+    }
+
     // Initializing SDL components
     if (SDL_Init(SDL_INIT_VIDEO) < 0)
         ng_die("failed to initialize SDL2");
@@ -24,28 +57,300 @@ void ng_game_create(ng_game_t *game, const char *title, int width, int height)
     if (TTF_Init() < 0)
         ng_die("failed to initialize SDL2/SDL_ttf");
 
-    // Initializing SDL_mixer with the standard settings
-#ifndef NO_AUDIO
-    if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0)
-        ng_die("failed to open audio device and initialize SDL_Mixer");
-#endif
+    // Sounds get played through a command queue, see audio.h
+    ng_audio_open(NG_AUDIO_BUFFER);
     
     game->width = width;
     game->height = height;
     
     // Creating the window at the center of the screen with the specified properties
     game->window = SDL_CreateWindow(title, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-                                    width, height, SDL_WINDOW_SHOWN);
+                                    width, height, is_headless ? SDL_WINDOW_HIDDEN : SDL_WINDOW_SHOWN);
 
     if (!game->window)
         ng_die("failed to create the default SDL2 window");
 
-    // -1: Initialize the first available rendering GPU driver
-    game->renderer = SDL_CreateRenderer(game->window, -1, SDL_RENDERER_ACCELERATED);
+    // -1: Initialize the first available rendering GPU driver,
+    // machines without a working one still get to play in software
+    game->renderer = SDL_CreateRenderer(game->window, -1, is_headless ? SDL_RENDERER_SOFTWARE : SDL_RENDERER_ACCELERATED);
+    if (!game->renderer && !is_headless)
+        game->renderer = SDL_CreateRenderer(game->window, -1, SDL_RENDERER_SOFTWARE);
+    if (!game->renderer)
+        ng_die("failed to create the renderer: %s", SDL_GetError());
+
+    ng_render_batch_create(&game->batch, game->renderer);
+    ng_input_create(&game->input);
+    ng_scheduler_create(&game->scheduler);
+    ng_jobs_create(&game->jobs, 0);
+    ng_arena_create(&game->frame_arena, "frame", FRAME_ARENA_SIZE);
+
+    game->ticks_per_second = SDL_GetPerformanceFrequency();
+    game->last_time = SDL_GetPerformanceCounter();
+    ng_game_set_frame_rate(game, is_headless ? 0 : FPS);
+
+    game->is_headless = is_headless;
+    game->is_deterministic = is_headless;
+    game->should_skip_rendering = false;
+    ng_clock_use_virtual(is_headless);
+    ng_bench_create(&game->bench);
+
+    game->target = NULL;
+    game->pixel_scale = 1;
+    game->is_integer_scaled = false;
+    game->presented_count = 0;
+
+    game->handle_update = NULL;
+    game->handle_interpolated_render = NULL;
+    game->handle_quit = NULL;
+    game->accumulator = 0;
 
     game->is_running = true;
 }
 
+void ng_game_create(ng_game_t *game, const char *title, int width, int height)
+{
+    create(game, title, width, height, false);
+}
+
+void ng_game_create_headless(ng_game_t *game, const char *title, int width, int height)
+{
+    create(game, title, width, height, true);
+}
+
+void ng_game_record(ng_game_t *game, const char *path)
+{
+    ng_input_start_recording(&game->input, path, game->seed);
+
+    game->is_deterministic = true;
+    ng_clock_use_virtual(true);
+}
+
+void ng_game_replay(ng_game_t *game, const char *path, bool is_fast)
+{
+    game->seed = ng_input_start_replay(&game->input, path);
+    ng_random_seed(game->seed);
+
+    game->is_deterministic = true;
+    ng_clock_use_virtual(true);
+
+    if (is_fast)
+    {
+        game->should_skip_rendering = true;
+        ng_game_set_frame_rate(game, 0);
+    }
+}
+
+void ng_game_set_frame_rate(ng_game_t *game, int frames_per_second)
+{
+    game->ticks_per_frame = frames_per_second > 0 ? game->ticks_per_second / frames_per_second : 0;
+}
+
+void ng_game_set_quit_handler(ng_game_t *game, quit_handler_t handler)
+{
+    game->handle_quit = handler;
+}
+
+// Starts comparing frames from scratch, the next one is drawn in full
+static void restart_tracking(ng_game_t *game)
+{
+    // The scene keeps the game's coordinates when it's scaled down,
+    // otherwise it's drawn straight to the window, whatever its size
+    int width = game->width, height = game->height;
+    if (!game->target)
+        SDL_GetRendererOutputSize(game->renderer, &width, &height);
+
+    // Only whole pixels of the target can be copied to the window
+    ng_render_batch_track_changes(&game->batch, width, height, game->pixel_scale, background);
+}
+
+bool ng_game_use_dirty_rects(ng_game_t *game)
+{
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(game->renderer, &info) < 0 || !(info.flags & SDL_RENDERER_SOFTWARE))
+        return false;
+
+    restart_tracking(game);
+    return true;
+}
+
+static void create_target(ng_game_t *game, int scale)
+{
+    // Not every renderer can draw into textures, those just stay at full resolution
+    if (!SDL_RenderTargetSupported(game->renderer))
+        return;
+
+    // Rounded up, so the window is always covered completely
+    int width = (game->width + scale - 1) / scale;
+    int height = (game->height + scale - 1) / scale;
+    game->target = SDL_CreateTexture(game->renderer, SDL_PIXELFORMAT_ARGB8888,
+                                     SDL_TEXTUREACCESS_TARGET, width, height);
+    if (!game->target)
+        ng_die("failed to create a %dx%d render target: %s", width, height, SDL_GetError());
+
+    SDL_SetTextureScaleMode(game->target, SDL_ScaleModeNearest);
+    game->pixel_scale = scale;
+}
+
+void ng_game_set_pixel_scale(ng_game_t *game, int scale, bool is_integer_scaled)
+{
+    SDL_DestroyTexture(game->target);
+    game->target = NULL;
+    game->pixel_scale = 1;
+    game->is_integer_scaled = is_integer_scaled;
+
+    if (scale > 1)
+        create_target(game, scale);
+
+    // Whatever was tracked before was drawn at another scale
+    if (game->batch.is_tracking)
+        restart_tracking(game);
+}
+
+// Sleeps through most of the remaining frame time, then
+// spins for the last bit to hit the deadline precisely
+static void wait_for_next_frame(ng_game_t *game, uint64_t frame_start)
+{
+#ifndef __EMSCRIPTEN__
+    if (game->ticks_per_frame == 0)
+        return;
+
+    uint64_t deadline = frame_start + game->ticks_per_frame;
+    uint64_t now = SDL_GetPerformanceCounter();
+    if (now >= deadline)
+        return;
+
+    uint64_t remaining_ms = (deadline - now) * 1000 / game->ticks_per_second;
+    if (remaining_ms > SPIN_MS)
+        SDL_Delay(remaining_ms - SPIN_MS);
+
+    while (SDL_GetPerformanceCounter() < deadline)
+        ;
+#endif
+}
+
+// How many fixed updates the current frame should run
+static int get_update_count(ng_game_t *game, double delta)
+{
+    // Replays run exactly what the recording did, headless runs one step per frame
+    if (ng_input_is_replaying(&game->input))
+        return ng_input_get_replay_updates(&game->input);
+
+    if (game->is_headless)
+        return 1;
+
+    // Consume the elapsed time in fixed steps, the leftover
+    // is carried over to the next frame
+    game->accumulator += MIN(delta, MAX_FRAME_SECONDS);
+
+    int updates = 0;
+    while (game->accumulator >= game->fixed_delta)
+    {
+        game->accumulator -= game->fixed_delta;
+        updates++;
+    }
+
+    return updates;
+}
+
+// Scaling is reset by SDL every time the target changes, so it's set after switching
+static void begin_rendering(ng_game_t *game)
+{
+    if (!game->target)
+        return;
+
+    SDL_SetRenderTarget(game->renderer, game->target);
+    SDL_RenderSetScale(game->renderer, 1.0f / game->pixel_scale, 1.0f / game->pixel_scale);
+}
+
+// Stretches the finished scene over the window, centered. With dirty
+// rectangles, only the parts that were drawn again get copied
+static void finish_rendering(ng_game_t *game)
+{
+    ng_dirty_rects_t *dirty = &game->batch.dirty;
+
+    if (!game->target)
+    {
+        // Drawn straight to the window, so that's all there is to present
+        memcpy(game->presented, dirty->rects, dirty->count * sizeof(SDL_Rect));
+        game->presented_count = game->batch.is_tracking ? dirty->count : 0;
+        return;
+    }
+
+    SDL_SetRenderTarget(game->renderer, NULL);
+
+    int output_width, output_height, width, height;
+    SDL_GetRendererOutputSize(game->renderer, &output_width, &output_height);
+    SDL_QueryTexture(game->target, NULL, NULL, &width, &height);
+
+    float scale = MIN((float) output_width / width, (float) output_height / height);
+    if (game->is_integer_scaled)
+        scale = MAX(floorf(scale), 1.0f);
+
+    SDL_FRect destination;
+    destination.w = width * scale;
+    destination.h = height * scale;
+    destination.x = floorf((output_width - destination.w) / 2);
+    destination.y = floorf((output_height - destination.h) / 2);
+
+    SDL_Rect window = {0, 0, output_width, output_height};
+    game->presented_count = 0;
+
+    if (!game->batch.is_tracking || ng_dirty_is_screen(dirty))
+    {
+        // The bars around the scene, if there are any
+        SDL_SetRenderDrawColor(game->renderer, 0, 0, 0, 255);
+        SDL_RenderClear(game->renderer);
+        SDL_RenderCopyF(game->renderer, game->target, NULL, &destination);
+
+        game->presented[game->presented_count++] = window;
+        return;
+    }
+
+    // Rectangles are snapped to the pixel scale, so each one is made of whole pixels of the target
+    int pixel_scale = game->pixel_scale;
+    for (int i = 0; i < dirty->count; i++)
+    {
+        SDL_Rect *rect = &dirty->rects[i];
+        SDL_Rect src = {rect->x / pixel_scale, rect->y / pixel_scale,
+                        (rect->w + pixel_scale - 1) / pixel_scale, (rect->h + pixel_scale - 1) / pixel_scale};
+
+        SDL_FRect dst = {destination.x + src.x * scale, destination.y + src.y * scale,
+                         src.w * scale, src.h * scale};
+        SDL_RenderCopyF(game->renderer, game->target, &src, &dst);
+
+        // Rounded out to whole pixels of the window
+        int left = floorf(dst.x), top = floorf(dst.y);
+        SDL_Rect covered = {left, top, (int) ceilf(dst.x + dst.w) - left, (int) ceilf(dst.y + dst.h) - top};
+        if (SDL_IntersectRect(&covered, &window, &game->presented[game->presented_count]))
+            game->presented_count++;
+    }
+}
+
+// With dirty rectangles, only the parts that were drawn again go to the window
+static void present(ng_game_t *game)
+{
+    if (!game->batch.is_tracking)
+    {
+        SDL_RenderPresent(game->renderer);
+        return;
+    }
+
+    SDL_RenderFlush(game->renderer);
+    if (game->presented_count > 0)
+        SDL_UpdateWindowSurfaceRects(game->window, game->presented, game->presented_count);
+}
+
+// The renderer picks up the window's new surface on its own when the size changes, but
+// nothing that was on the old one is left. Uncovered parts of the window need drawing too
+static void handle_window_event(ng_game_t *game, SDL_WindowEvent *event)
+{
+    if (!game->batch.is_tracking)
+        return;
+
+    if (event->event == SDL_WINDOWEVENT_SIZE_CHANGED || event->event == SDL_WINDOWEVENT_EXPOSED)
+        restart_tracking(game);
+}
+
 static void main_game_loop(void *args)
 {
     // The argument will always be an ng_game_t* pointer
@@ -54,6 +359,14 @@ static void main_game_loop(void *args)
 
     if (!game->is_running)
     {
+        if (game->bench.is_running)
+        {
+            ng_bench_report(&game->bench);
+            ng_arena_report(&game->frame_arena);
+        }
+
+        if (game->handle_quit)
+            game->handle_quit();
         ng_game_destroy(game);
 
     #ifdef __EMSCRIPTEN__
@@ -64,41 +377,134 @@ static void main_game_loop(void *args)
     }
 
     // Calculate the amount of seconds that passed since the last frame
-    uint32_t cur_time = SDL_GetTicks();
-    float delta = (cur_time - game->last_time) / 1000.0f;
+    uint64_t cur_time = SDL_GetPerformanceCounter();
+    double delta = (double) (cur_time - game->last_time) / game->ticks_per_second;
     game->last_time = cur_time;
 
+    NG_PROFILE_BEGIN_FRAME();
+    NG_PROFILE_BEGIN(NG_PHASE_EVENTS);
+    ng_input_begin_frame(&game->input);
+
     static SDL_Event event;
-    while (SDL_PollEvent(&event))
+    while (ng_input_poll_event(&game->input, &event))
     {
         // SDL_QUIT = the window is about to close, for whatever
         // reason (exit button, alt f4 etc)
         if (event.type == SDL_QUIT)
             game->is_running = false;
+    #ifdef NG_PROFILE
+        else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F3)
+        {
+            ng_profiler_toggle_hud();
+            // Hiding it has to uncover the scene
+            ng_render_batch_invalidate_all(&game->batch);
+        }
+    #endif
         else
+        {
+            if (event.type == SDL_WINDOWEVENT)
+                handle_window_event(game, &event.window);
             game->handle_event(&event);
+        }
+    }
+
+    ng_input_update_keys(&game->input);
+    NG_PROFILE_END(NG_PHASE_EVENTS);
+
+    if (!game->should_skip_rendering)
+    {
+        begin_rendering(game);
+
+        // Otherwise the batch clears only what changed, when it's flushed
+        if (!game->batch.is_tracking)
+        {
+            SDL_SetRenderDrawColor(game->renderer, background.r, background.g, background.b, background.a);
+            SDL_RenderClear(game->renderer);
+        }
     }
 
-    SDL_SetRenderDrawColor(game->renderer, 10, 10, 10, 255);
-    SDL_RenderClear(game->renderer);
+    if (game->handle_update)
+    {
+        NG_PROFILE_BEGIN(NG_PHASE_UPDATE);
+        int updates = get_update_count(game, delta);
+        for (int i = 0; i < updates; i++)
+        {
+            // Tasks that came due during this step run first, the update sees what they did
+            ng_scheduler_advance(&game->scheduler, game->fixed_delta * 1000);
+            game->handle_update(game->fixed_delta);
+            ng_clock_advance(game->fixed_delta * 1000);
+        }
+        ng_input_end_frame(&game->input, updates);
+        NG_PROFILE_END(NG_PHASE_UPDATE);
 
-    game->handle_render(delta);
+        if (!game->should_skip_rendering)
+        {
+            NG_PROFILE_BEGIN(NG_PHASE_RENDER);
+            game->handle_interpolated_render(game->accumulator / game->fixed_delta);
+            NG_PROFILE_END(NG_PHASE_RENDER);
+        }
+    }
+    else
+    {
+        // Headless frames always advance the game by exactly one step
+        if (game->is_headless)
+            delta = 1.0 / FPS;
+        ng_clock_advance(delta * 1000);
+        ng_scheduler_advance(&game->scheduler, delta * 1000);
 
-    // Sends the instructions into our GPU, updates the screen
-    SDL_RenderPresent(game->renderer);
+        // Updating and rendering can't be told apart in this mode
+        NG_PROFILE_BEGIN(NG_PHASE_RENDER);
+        game->handle_render(delta);
+        NG_PROFILE_END(NG_PHASE_RENDER);
+    }
+
+    if (!game->should_skip_rendering)
+    {
+    #ifdef NG_PROFILE
+        // The overlay goes over the finished frame, so the whole window gets presented with it
+        if (ng_profiler_is_hud_visible())
+            ng_render_batch_invalidate_all(&game->batch);
+    #endif
+
+        NG_PROFILE_BEGIN(NG_PHASE_FLUSH);
+        ng_render_batch_flush(&game->batch);
+        finish_rendering(game);
+        NG_PROFILE_END(NG_PHASE_FLUSH);
+
+        // Always at full resolution, so it stays readable. It's not part
+        // of the scene, the next frame must not compare itself against it
+        bool is_tracking = game->batch.is_tracking;
+        game->batch.is_tracking = false;
+        NG_PROFILE_RENDER_HUD(&game->batch);
+        game->batch.is_tracking = is_tracking;
+
+        // Sends the instructions into our GPU, updates the screen
+        NG_PROFILE_BEGIN(NG_PHASE_PRESENT);
+        present(game);
+        NG_PROFILE_END(NG_PHASE_PRESENT);
+    }
 
     // Don't update too fast, introduce an FPS limit!
     // This is an important performance measure, since
     // updating faster is pointless! The frequency is too fast
     // for it to ever be visible on the monitor
-    if (delta < IDEAL_MS_PER_FRAME)
-        SDL_Delay(IDEAL_MS_PER_FRAME - delta);
+    wait_for_next_frame(game, cur_time);
+    ng_bench_end_frame(&game->bench);
+
+    // Nothing the frame allocated outlives it
+    ng_arena_reset(&game->frame_arena);
+
+    // The frame time includes the wait, whatever the phases don't cover is idle time
+    NG_PROFILE_END_FRAME();
 }
 
-void ng_game_start_loop(ng_game_t *game, event_handler_t ev, render_handler_t re)
+static void run_loop(ng_game_t *game)
 {
-    game->handle_event = ev;
-    game->handle_render = re;
+    // Don't count the loading time as part of the first frame
+    game->last_time = SDL_GetPerformanceCounter();
+
+    if (game->is_headless)
+        ng_bench_start(&game->bench);
 
 #ifdef __EMSCRIPTEN__
     // If we're running on the web, we need to wrap around emscripten
@@ -108,11 +514,46 @@ void ng_game_start_loop(ng_game_t *game, event_handler_t ev, render_handler_t re
 #endif
 }
 
+void ng_game_start_loop(ng_game_t *game, event_handler_t ev, render_handler_t re)
+{
+    game->handle_event = ev;
+    game->handle_render = re;
+    game->handle_update = NULL;
+
+    // The number of frames is all a replay knows, not how long they took
+    if (ng_input_is_recording(&game->input) || ng_input_is_replaying(&game->input))
+        ng_die("only the fixed timestep loop can be recorded or replayed");
+
+    run_loop(game);
+}
+
+void ng_game_start_fixed_loop(ng_game_t *game, event_handler_t ev, update_handler_t up,
+                              interpolated_render_handler_t re, int updates_per_second)
+{
+    game->handle_event = ev;
+    game->handle_update = up;
+    game->handle_interpolated_render = re;
+
+    game->fixed_delta = 1.0 / updates_per_second;
+    game->accumulator = 0;
+
+    run_loop(game);
+}
+
 // Clearing up all SDL components
 void ng_game_destroy(ng_game_t *game)
 {
+    NG_PROFILE_DESTROY();
+    ng_input_destroy(&game->input);
+    ng_scheduler_destroy(&game->scheduler);
+    ng_jobs_destroy(&game->jobs);
+    ng_arena_destroy(&game->frame_arena);
+    ng_scratch_release();
+    ng_render_batch_destroy(&game->batch);
+    SDL_DestroyTexture(game->target);
     SDL_DestroyRenderer(game->renderer);
     SDL_DestroyWindow(game->window);
+    ng_audio_close();
 
     SDL_Quit();
     IMG_Quit();
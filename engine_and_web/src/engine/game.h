@@ -9,10 +9,24 @@
 
 #include <SDL2/SDL.h>
 #include <stdbool.h>
+#include "batch.h"
+#include "input.h"
+#include "bench.h"
+#include "scheduler.h"
+#include "jobs.h"
+#include "arena.h"
 
 typedef void (*event_handler_t) (SDL_Event*);
 typedef void (*render_handler_t) (float delta);
 
+// Used by the fixed timestep loop: updates always receive the same delta,
+// while rendering receives how far (0 to 1) we are between two updates
+typedef void (*update_handler_t) (float delta);
+typedef void (*interpolated_render_handler_t) (float alpha);
+
+// Called once the loop is over, right before the game gets destroyed
+typedef void (*quit_handler_t) (void);
+
 // Just a wrapper around the most basic components
 // Can be extended later on and gain more power
 typedef struct
@@ -20,18 +34,112 @@ typedef struct
     SDL_Window *window;
     SDL_Renderer *renderer;
 
+    // Sprites queued here are drawn right after the render handler returns
+    ng_render_batch_t batch;
+
     // Function pointers to constructor the game loop
     event_handler_t handle_event;
     render_handler_t handle_render;
+    update_handler_t handle_update;
+    interpolated_render_handler_t handle_interpolated_render;
+    quit_handler_t handle_quit;
+
+    // Keyboard state should be read from here, it might come from a script
+    ng_input_t input;
+
+    // Advanced along with the game, right before every update
+    ng_scheduler_t scheduler;
+
+    // Worker threads for splitting up updates, the main thread helps while it waits
+    ng_jobs_t jobs;
+
+    // Memory that only has to last until the end of the current frame,
+    // it gets reset right after presenting
+    ng_arena_t frame_arena;
 
     bool is_running;
     int width, height;
-    // Last time the frame was run
-    uint32_t last_time;
+
+    // Low resolution rendering, see ng_game_set_pixel_scale
+    // The target is NULL when the scene is drawn straight to the window
+    SDL_Texture *target;
+    int pixel_scale;
+    bool is_integer_scaled;
+
+    // With dirty rectangles, the parts of the window that got drawn again
+    // this frame, only those are presented (see ng_game_use_dirty_rects)
+    SDL_Rect presented[NG_MAX_DIRTY_RECTS];
+    int presented_count;
+
+    // No visible window and no frame limit, every frame
+    // simulates the same amount of time (see ng_game_create_headless)
+    bool is_headless;
+    ng_bench_t bench;
+
+    // Set for headless runs, recordings and replays. Timers then follow the
+    // updates instead of the wall clock, so nothing depends on the frame rate
+    bool is_deterministic;
+    bool should_skip_rendering;
+    uint32_t seed;
+
+    // Last time the frame was run, in performance counter ticks
+    uint64_t last_time;
+    uint64_t ticks_per_second;
+
+    // How long a frame should last at least, 0 for no limit
+    uint64_t ticks_per_frame;
+
+    // Simulation time that has not been consumed by updates yet
+    double fixed_delta;
+    double accumulator;
 } ng_game_t;
 
 void ng_game_create(ng_game_t *game, const char *title, int width, int height);
+// Uses the dummy video/audio drivers and the software renderer, so it runs on
+// machines without a display. Timers follow the game's clock instead of the
+// wall clock and the random seed is fixed, which makes runs repeatable
+// Frame times get reported on exit
+void ng_game_create_headless(ng_game_t *game, const char *title, int width, int height);
+
+// Call either of these right after creating the game, before anything random happens
+// NOTE: Only the fixed timestep loop can be recorded
+void ng_game_record(ng_game_t *game, const char *path);
+// Fast replays skip rendering altogether and run without a frame limit
+void ng_game_replay(ng_game_t *game, const char *path, bool is_fast);
+
+// NOTE: Pass 0 to disable the frame limiter (the default is 60 FPS)
+void ng_game_set_frame_rate(ng_game_t *game, int frames_per_second);
+
+// Lets the game free whatever it created on top of the engine
+// (threads included), the renderer is still around at that point
+void ng_game_set_quit_handler(ng_game_t *game, quit_handler_t handler);
+
+// Only redraws and presents the parts of the window that changed since the
+// last frame (see ng_render_batch_track_changes), mostly idle scenes then
+// cost next to nothing. It needs the software renderer, which draws straight
+// into the window's surface and so keeps the last frame around (machines
+// without a GPU fall back to it), it returns false and changes nothing on any
+// other. Works along with the pixel scale, only the changed parts get copied
+// to the window then. The whole window is drawn again when it gets resized or
+// exposed, and on every frame that shows the profiler's overlay
+bool ng_game_use_dirty_rects(ng_game_t *game);
+
+// Draws the whole scene into a texture `scale` times smaller than the window,
+// which then gets stretched over the window with nearest filtering. Handlers
+// keep using window coordinates, they're scaled down on the way, but every
+// pixel that gets filled costs scale^2 less. Anything drawn at less than
+// `scale` times its size loses detail, so it suits pixel art that's blown up
+// anyway. Integer scaling only ever stretches by whole numbers and leaves
+// black bars instead, when the window doesn't fit the texture exactly
+// NOTE: Pass 1 to draw at full resolution again (the default)
+void ng_game_set_pixel_scale(ng_game_t *game, int scale, bool is_integer_scaled);
+
+// The update/render handler gets called exactly once per frame
 void ng_game_start_loop(ng_game_t *game, event_handler_t ev, render_handler_t re);
+// Updates run at a steady rate, as many times as needed to catch up with
+// the clock, so the simulation does not depend on the frame rate at all
+void ng_game_start_fixed_loop(ng_game_t *game, event_handler_t ev, update_handler_t up,
+                              interpolated_render_handler_t re, int updates_per_second);
 
 void ng_game_destroy(ng_game_t *game);
 
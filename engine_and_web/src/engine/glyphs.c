@@ -0,0 +1,84 @@
+#include "glyphs.h"
+#include "common.h"
+
+#define ATLAS_WIDTH 512
+
+// Same color the labels have always used, tinting can be done with color mods
+static SDL_Color white = {255, 255, 255, 255};
+
+void ng_glyph_cache_create(ng_glyph_cache_t *cache, SDL_Renderer *renderer, TTF_Font *font)
+{
+    if (!font)
+        ng_die("failed to create glyph cache, an invalid font was provided");
+
+    cache->font = font;
+    cache->line_height = TTF_FontHeight(font);
+    cache->line_skip = TTF_FontLineSkip(font);
+
+    SDL_Surface *surfaces[NG_GLYPH_COUNT];
+
+    // Simple shelf packing, all glyphs have the height of a line anyway
+    int x = 0, y = 0;
+    for (int i = 0; i < NG_GLYPH_COUNT; i++)
+    {
+        ng_glyph_t *glyph = &cache->glyphs[i];
+        Uint16 character = NG_GLYPH_FIRST + i;
+
+        int min_x, advance;
+        if (TTF_GlyphMetrics(font, character, &min_x, NULL, NULL, NULL, &advance) < 0)
+            min_x = advance = 0;
+
+        glyph->offset_x = MIN(min_x, 0);
+        glyph->advance = advance;
+        glyph->src = (SDL_Rect) {0, 0, 0, 0};
+
+        surfaces[i] = character == ' ' ? NULL : TTF_RenderGlyph_Solid(font, character, white);
+        if (!surfaces[i])
+            continue;
+
+        if (x + surfaces[i]->w + 1 > ATLAS_WIDTH)
+        {
+            x = 0;
+            y += cache->line_height + 1;
+        }
+
+        glyph->src = (SDL_Rect) {x, y, surfaces[i]->w, surfaces[i]->h};
+        x += surfaces[i]->w + 1;
+    }
+
+    SDL_Surface *atlas = SDL_CreateRGBSurfaceWithFormat(0, ATLAS_WIDTH, y + cache->line_height + 1,
+                                                        32, SDL_PIXELFORMAT_RGBA32);
+    if (!atlas)
+        ng_die("failed to allocate the glyph atlas");
+
+    // Glyph surfaces are color keyed, so blitting leaves the background transparent
+    SDL_FillRect(atlas, NULL, 0);
+    for (int i = 0; i < NG_GLYPH_COUNT; i++)
+    {
+        if (!surfaces[i])
+            continue;
+
+        SDL_Rect destination = cache->glyphs[i].src;
+        SDL_BlitSurface(surfaces[i], NULL, atlas, &destination);
+        SDL_FreeSurface(surfaces[i]);
+    }
+
+    cache->texture = SDL_CreateTextureFromSurface(renderer, atlas);
+    SDL_FreeSurface(atlas);
+
+    if (!cache->texture)
+        ng_die("failed to upload the glyph atlas: %s", SDL_GetError());
+}
+
+ng_glyph_t* ng_glyph_cache_get(ng_glyph_cache_t *cache, char character)
+{
+    if (character < NG_GLYPH_FIRST || character > NG_GLYPH_LAST)
+        return NULL;
+
+    return &cache->glyphs[character - NG_GLYPH_FIRST];
+}
+
+void ng_glyph_cache_destroy(ng_glyph_cache_t *cache)
+{
+    SDL_DestroyTexture(cache->texture);
+}
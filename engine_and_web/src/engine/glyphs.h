@@ -0,0 +1,45 @@
+#ifndef _NG_GLYPHS_H
+#define _NG_GLYPHS_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+// Only printable ASCII characters are cached, the rest are skipped
+#define NG_GLYPH_FIRST 32
+#define NG_GLYPH_LAST 126
+#define NG_GLYPH_COUNT (NG_GLYPH_LAST - NG_GLYPH_FIRST + 1)
+
+typedef struct
+{
+    // Where the glyph is inside the atlas, empty for blank glyphs
+    SDL_Rect src;
+
+    // Horizontal offset from the pen position and distance to the next glyph
+    int offset_x;
+    int advance;
+} ng_glyph_t;
+
+/*
+ * Every glyph of the font gets rasterized once and packed inside a single
+ * texture. Text can then be drawn as a bunch of quads pointing inside it,
+ * so changing the text never allocates or uploads a texture
+ */
+typedef struct
+{
+    TTF_Font *font;
+    SDL_Texture *texture;
+
+    ng_glyph_t glyphs[NG_GLYPH_COUNT];
+
+    int line_height;
+    int line_skip;
+} ng_glyph_cache_t;
+
+void ng_glyph_cache_create(ng_glyph_cache_t *cache, SDL_Renderer *renderer, TTF_Font *font);
+
+// Returns NULL for characters that are not cached
+ng_glyph_t* ng_glyph_cache_get(ng_glyph_cache_t *cache, char character);
+
+void ng_glyph_cache_destroy(ng_glyph_cache_t *cache);
+
+#endif
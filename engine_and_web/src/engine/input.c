@@ -0,0 +1,457 @@
+#include "input.h"
+#include "common.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOG_MAGIC 0x5249474e // "NGIR"
+#define LOG_VERSION 1
+
+// Set on key records for pressed keys
+#define KEY_PRESSED 0x8000
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t seed;
+    uint32_t reserved;
+} log_header_t;
+
+// Every record starts with one of these, frames end with a FRAMES record:
+// FRAMES   u8 repeat, u16 updates (this frame and repeat - 1 identical empty ones)
+// KEY      u16 scancode | KEY_PRESSED, the keyboard state changed
+// KEY_EVENT u16 scancode | KEY_PRESSED, u8 repeat, i32 keycode
+// MOTION   i16 x, i16 y
+// QUIT
+typedef enum { OP_FRAMES, OP_KEY, OP_KEY_EVENT, OP_MOTION, OP_QUIT } log_op_t;
+
+void ng_input_create(ng_input_t *input)
+{
+    memset(input->keys, 0, sizeof(input->keys));
+    input->frame = 0;
+
+    input->steps = NULL;
+    input->step_count = input->next_step = 0;
+    input->handle_command = NULL;
+
+    input->record_file = NULL;
+    input->pending_frames = input->pending_updates = 0;
+
+    input->replay_data = NULL;
+    input->replay_size = input->replay_offset = 0;
+    input->replay_events = NULL;
+    input->replay_event_count = input->replay_event_capacity = input->next_replay_event = 0;
+    input->repeated_frames = input->replay_updates = 0;
+    input->is_replay_over = false;
+}
+
+static ng_input_action_t parse_action(const char *name, const char *path, int line)
+{
+    if (strcmp(name, "down") == 0) return NG_INPUT_KEY_DOWN;
+    if (strcmp(name, "up") == 0) return NG_INPUT_KEY_UP;
+    if (strcmp(name, "call") == 0) return NG_INPUT_CALL;
+    if (strcmp(name, "quit") == 0) return NG_INPUT_QUIT;
+
+    ng_die("%s:%d: unknown action '%s'", path, line, name);
+    return NG_INPUT_QUIT;
+}
+
+void ng_input_load_script(ng_input_t *input, const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+        ng_die("failed to open input script %s", path);
+
+    int capacity = 0;
+    char buffer[256];
+    for (int line = 1; fgets(buffer, sizeof(buffer), file); line++)
+    {
+        char action[16], argument[64] = "";
+        unsigned int frame;
+
+        // Comments and empty lines
+        int matched = sscanf(buffer, " %u %15s %63[^\r\n]", &frame, action, argument);
+        if (matched < 2)
+            continue;
+
+        if (input->step_count == capacity)
+        {
+            capacity = capacity > 0 ? capacity * 2 : 64;
+            input->steps = realloc(input->steps, capacity * sizeof(ng_input_step_t));
+            if (!input->steps)
+                ng_die("failed to allocate %d input steps", capacity);
+        }
+
+        ng_input_step_t *step = &input->steps[input->step_count++];
+        step->frame = frame;
+        step->action = parse_action(action, path, line);
+        step->key = SDL_SCANCODE_UNKNOWN;
+        strcpy(step->command, argument);
+
+        if (step->action == NG_INPUT_KEY_DOWN || step->action == NG_INPUT_KEY_UP)
+        {
+            step->key = SDL_GetScancodeFromName(argument);
+            if (step->key == SDL_SCANCODE_UNKNOWN)
+                ng_die("%s:%d: unknown key '%s'", path, line, argument);
+        }
+
+        if (input->step_count > 1 && frame < input->steps[input->step_count - 2].frame)
+            ng_die("%s:%d: steps have to be sorted by frame", path, line);
+    }
+
+    fclose(file);
+
+    if (input->step_count == 0)
+        ng_die("input script %s is empty", path);
+}
+
+void ng_input_set_command_handler(ng_input_t *input, ng_command_handler_t handler)
+{
+    input->handle_command = handler;
+}
+
+bool ng_input_is_scripted(ng_input_t *input)
+{
+    return input->steps != NULL;
+}
+
+bool ng_input_is_recording(ng_input_t *input)
+{
+    return input->record_file != NULL;
+}
+
+bool ng_input_is_replaying(ng_input_t *input)
+{
+    return input->replay_data != NULL;
+}
+
+void ng_input_start_recording(ng_input_t *input, const char *path, uint32_t seed)
+{
+    input->record_file = fopen(path, "wb");
+    if (!input->record_file)
+        ng_die("failed to create input log %s", path);
+
+    log_header_t header = { LOG_MAGIC, LOG_VERSION, seed, 0 };
+    fwrite(&header, sizeof(header), 1, input->record_file);
+
+    // Everything that is already pressed gets written on the first frame
+    memset(input->recorded_keys, 0, sizeof(input->recorded_keys));
+}
+
+uint32_t ng_input_start_replay(ng_input_t *input, const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        ng_die("failed to open input log %s", path);
+
+    fseek(file, 0, SEEK_END);
+    input->replay_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    input->replay_data = malloc(input->replay_size);
+    if (!input->replay_data || fread(input->replay_data, 1, input->replay_size, file) != input->replay_size)
+        ng_die("failed to read input log %s", path);
+
+    fclose(file);
+
+    log_header_t header;
+    if (input->replay_size < sizeof(header))
+        ng_die("%s is not an input log", path);
+
+    memcpy(&header, input->replay_data, sizeof(header));
+    if (header.magic != LOG_MAGIC || header.version != LOG_VERSION)
+        ng_die("%s is not an input log, or was written by another version", path);
+
+    input->replay_offset = sizeof(header);
+    return header.seed;
+}
+
+// Empty frames that are waiting to be merged into a single record
+static void flush_pending_frames(ng_input_t *input)
+{
+    if (input->pending_frames == 0)
+        return;
+
+    uint8_t op = OP_FRAMES, repeat = input->pending_frames;
+    uint16_t updates = input->pending_updates;
+    fwrite(&op, 1, 1, input->record_file);
+    fwrite(&repeat, 1, 1, input->record_file);
+    fwrite(&updates, 2, 1, input->record_file);
+
+    input->pending_frames = 0;
+}
+
+static void write_record(ng_input_t *input, log_op_t op, const void *data, size_t size)
+{
+    // Whatever comes before this record belongs to the earlier frames
+    flush_pending_frames(input);
+
+    uint8_t byte = op;
+    fwrite(&byte, 1, 1, input->record_file);
+    if (size > 0)
+        fwrite(data, size, 1, input->record_file);
+}
+
+static void record_event(ng_input_t *input, SDL_Event *event)
+{
+    uint8_t data[8];
+
+    switch (event->type)
+    {
+    case SDL_KEYDOWN:
+    case SDL_KEYUP:
+    {
+        uint16_t key = event->key.keysym.scancode | (event->type == SDL_KEYDOWN ? KEY_PRESSED : 0);
+        int32_t keycode = event->key.keysym.sym;
+
+        memcpy(data, &key, 2);
+        data[2] = event->key.repeat;
+        memcpy(data + 3, &keycode, 4);
+        write_record(input, OP_KEY_EVENT, data, 7);
+        break;
+    }
+    case SDL_MOUSEMOTION:
+    {
+        int16_t position[2] = { event->motion.x, event->motion.y };
+        write_record(input, OP_MOTION, position, sizeof(position));
+        break;
+    }
+    case SDL_QUIT:
+        write_record(input, OP_QUIT, NULL, 0);
+        break;
+    }
+}
+
+static void read_replay(ng_input_t *input, void *data, size_t size)
+{
+    if (input->replay_offset + size > input->replay_size)
+        ng_die("the input log is cut short");
+
+    memcpy(data, input->replay_data + input->replay_offset, size);
+    input->replay_offset += size;
+}
+
+static void queue_replay_event(ng_input_t *input, SDL_Event *event)
+{
+    if (input->replay_event_count == input->replay_event_capacity)
+    {
+        input->replay_event_capacity = input->replay_event_capacity > 0 ? input->replay_event_capacity * 2 : 16;
+        input->replay_events = realloc(input->replay_events, input->replay_event_capacity * sizeof(SDL_Event));
+        if (!input->replay_events)
+            ng_die("failed to allocate %d replay events", input->replay_event_capacity);
+    }
+
+    input->replay_events[input->replay_event_count++] = *event;
+}
+
+// Reads the records of the next frame, up to and including its FRAMES record
+static void replay_frame(ng_input_t *input)
+{
+    input->replay_event_count = input->next_replay_event = 0;
+
+    if (input->repeated_frames > 0)
+    {
+        input->repeated_frames--;
+        return;
+    }
+
+    while (input->replay_offset < input->replay_size)
+    {
+        uint8_t op;
+        read_replay(input, &op, 1);
+
+        SDL_Event event = {0};
+        switch (op)
+        {
+        case OP_FRAMES:
+        {
+            uint8_t repeat;
+            uint16_t updates;
+            read_replay(input, &repeat, 1);
+            read_replay(input, &updates, 2);
+
+            input->repeated_frames = repeat - 1;
+            input->replay_updates = updates;
+            return;
+        }
+        case OP_KEY:
+        {
+            uint16_t key;
+            read_replay(input, &key, 2);
+            input->keys[(key & ~KEY_PRESSED) % SDL_NUM_SCANCODES] = (key & KEY_PRESSED) != 0;
+            break;
+        }
+        case OP_KEY_EVENT:
+        {
+            uint16_t key;
+            uint8_t repeat;
+            int32_t keycode;
+            read_replay(input, &key, 2);
+            read_replay(input, &repeat, 1);
+            read_replay(input, &keycode, 4);
+
+            event.type = key & KEY_PRESSED ? SDL_KEYDOWN : SDL_KEYUP;
+            event.key.state = key & KEY_PRESSED ? SDL_PRESSED : SDL_RELEASED;
+            event.key.repeat = repeat;
+            event.key.keysym.scancode = key & ~KEY_PRESSED;
+            event.key.keysym.sym = keycode;
+            queue_replay_event(input, &event);
+            break;
+        }
+        case OP_MOTION:
+        {
+            int16_t position[2];
+            read_replay(input, position, sizeof(position));
+
+            event.type = SDL_MOUSEMOTION;
+            event.motion.x = position[0];
+            event.motion.y = position[1];
+            queue_replay_event(input, &event);
+            break;
+        }
+        case OP_QUIT:
+            event.type = SDL_QUIT;
+            queue_replay_event(input, &event);
+            break;
+        default:
+            ng_die("the input log is corrupted, unknown record %d", op);
+        }
+    }
+
+    // Ran out of frames, the replay is over
+    SDL_Event event = { .type = SDL_QUIT };
+    queue_replay_event(input, &event);
+
+    input->replay_updates = 0;
+    input->is_replay_over = true;
+}
+
+static void push_key_event(SDL_Scancode key, bool is_down)
+{
+    SDL_Event event = {0};
+    event.type = is_down ? SDL_KEYDOWN : SDL_KEYUP;
+    event.key.state = is_down ? SDL_PRESSED : SDL_RELEASED;
+    event.key.keysym.scancode = key;
+    event.key.keysym.sym = SDL_GetKeyFromScancode(key);
+
+    SDL_PushEvent(&event);
+}
+
+void ng_input_begin_frame(ng_input_t *input)
+{
+    if (ng_input_is_replaying(input) && !input->is_replay_over)
+        replay_frame(input);
+
+    while (input->next_step < input->step_count && input->steps[input->next_step].frame <= input->frame)
+    {
+        ng_input_step_t *step = &input->steps[input->next_step++];
+
+        switch (step->action)
+        {
+        case NG_INPUT_KEY_DOWN:
+        case NG_INPUT_KEY_UP:
+            input->keys[step->key] = step->action == NG_INPUT_KEY_DOWN;
+            push_key_event(step->key, step->action == NG_INPUT_KEY_DOWN);
+            break;
+        case NG_INPUT_CALL:
+            if (input->handle_command)
+                input->handle_command(step->command);
+            break;
+        case NG_INPUT_QUIT:
+        {
+            SDL_Event event = { .type = SDL_QUIT };
+            SDL_PushEvent(&event);
+            break;
+        }
+        }
+    }
+
+    input->frame++;
+}
+
+bool ng_input_poll_event(ng_input_t *input, SDL_Event *event)
+{
+    if (ng_input_is_replaying(input))
+    {
+        // Live input would throw the replay off, only closing the window is allowed
+        while (SDL_PollEvent(event))
+        {
+            if (event->type == SDL_QUIT)
+                return true;
+        }
+
+        if (input->next_replay_event == input->replay_event_count)
+            return false;
+
+        *event = input->replay_events[input->next_replay_event++];
+        return true;
+    }
+
+    if (!SDL_PollEvent(event))
+        return false;
+
+    if (ng_input_is_recording(input))
+        record_event(input, event);
+
+    return true;
+}
+
+void ng_input_update_keys(ng_input_t *input)
+{
+    // Scripts and replays set the keys on their own
+    if (!ng_input_is_scripted(input) && !ng_input_is_replaying(input))
+        memcpy(input->keys, SDL_GetKeyboardState(NULL), sizeof(input->keys));
+
+    if (!ng_input_is_recording(input))
+        return;
+
+    for (int i = 0; i < SDL_NUM_SCANCODES; i++)
+    {
+        if (input->keys[i] == input->recorded_keys[i])
+            continue;
+
+        uint16_t key = i | (input->keys[i] ? KEY_PRESSED : 0);
+        write_record(input, OP_KEY, &key, 2);
+        input->recorded_keys[i] = input->keys[i];
+    }
+}
+
+int ng_input_get_replay_updates(ng_input_t *input)
+{
+    return input->replay_updates;
+}
+
+void ng_input_end_frame(ng_input_t *input, int updates)
+{
+    if (!ng_input_is_recording(input))
+        return;
+
+    if (updates > UINT16_MAX)
+        ng_die("can't record %d updates in a single frame", updates);
+
+    // Frames in a row with nothing going on are merged together
+    if (input->pending_frames > 0 && (input->pending_updates != updates || input->pending_frames == UINT8_MAX))
+        flush_pending_frames(input);
+
+    input->pending_updates = updates;
+    input->pending_frames++;
+}
+
+const Uint8* ng_input_get_keys(ng_input_t *input)
+{
+    return input->keys;
+}
+
+void ng_input_destroy(ng_input_t *input)
+{
+    if (input->record_file)
+    {
+        flush_pending_frames(input);
+        fclose(input->record_file);
+    }
+
+    free(input->steps);
+    free(input->replay_data);
+    free(input->replay_events);
+}
@@ -0,0 +1,100 @@
+#ifndef _NG_INPUT_H
+#define _NG_INPUT_H
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Called for every `call` line of a script, with the rest of the line
+typedef void (*ng_command_handler_t) (const char *command);
+
+typedef enum
+{
+    NG_INPUT_KEY_DOWN,
+    NG_INPUT_KEY_UP,
+    NG_INPUT_CALL,
+    NG_INPUT_QUIT
+} ng_input_action_t;
+
+typedef struct
+{
+    uint32_t frame;
+    ng_input_action_t action;
+
+    SDL_Scancode key;
+    char command[64];
+} ng_input_step_t;
+
+/*
+ * Where the game should read the keyboard and the events from. Normally
+ * that's just SDL, but a script can take over instead:
+ *
+ *     # <frame> <action> <argument>
+ *     60  down  Space
+ *     61  up    Space
+ *     900 call  scene SLEIGH
+ *     2000 quit
+ *
+ * Key names are the ones SDL_GetScancodeFromName understands. Key presses
+ * and releases also push the matching SDL events, so handlers see them too
+ *
+ * Sessions can also be recorded into a log and replayed later on. The log
+ * holds the random seed, the events, the changes of the keyboard state and
+ * how many updates every frame ran, so a replay goes through the exact same
+ * updates no matter how fast it runs
+ */
+typedef struct
+{
+    // The keyboard state for the current frame
+    Uint8 keys[SDL_NUM_SCANCODES];
+    uint32_t frame;
+
+    ng_input_step_t *steps;
+    int step_count, next_step;
+    ng_command_handler_t handle_command;
+
+    // Recording, the keyboard state is only written when it changes
+    FILE *record_file;
+    Uint8 recorded_keys[SDL_NUM_SCANCODES];
+    int pending_frames, pending_updates;
+
+    // Replaying, the whole log is kept in memory
+    uint8_t *replay_data;
+    size_t replay_size, replay_offset;
+    SDL_Event *replay_events;
+    int replay_event_count, replay_event_capacity, next_replay_event;
+    int repeated_frames, replay_updates;
+    bool is_replay_over;
+} ng_input_t;
+
+void ng_input_create(ng_input_t *input);
+void ng_input_load_script(ng_input_t *input, const char *path);
+void ng_input_set_command_handler(ng_input_t *input, ng_command_handler_t handler);
+
+// NOTE: The seed is only stored, re-seed the generator yourself when replaying
+void ng_input_start_recording(ng_input_t *input, const char *path, uint32_t seed);
+// Returns the seed the session was recorded with
+uint32_t ng_input_start_replay(ng_input_t *input, const char *path);
+
+bool ng_input_is_scripted(ng_input_t *input);
+bool ng_input_is_recording(ng_input_t *input);
+bool ng_input_is_replaying(ng_input_t *input);
+
+// A frame goes like this: begin, poll all the events, update the
+// keys, run the updates, end. The game loop takes care of it
+void ng_input_begin_frame(ng_input_t *input);
+// Use in place of SDL_PollEvent. Replays only let SDL_QUIT through from SDL
+bool ng_input_poll_event(ng_input_t *input, SDL_Event *event);
+void ng_input_update_keys(ng_input_t *input);
+// Replays decide on their own how many updates each frame runs
+int ng_input_get_replay_updates(ng_input_t *input);
+void ng_input_end_frame(ng_input_t *input, int updates);
+
+// Indexed by SDL_Scancode, just like SDL_GetKeyboardState
+const Uint8* ng_input_get_keys(ng_input_t *input);
+
+// Also finishes up the recording, if there is one
+void ng_input_destroy(ng_input_t *input);
+
+#endif
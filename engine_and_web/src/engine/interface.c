@@ -1,5 +1,7 @@
 #include "interface.h"
+#include "common.h"
 #include <SDL2/SDL.h>
+#include <stdlib.h>
 
 // Default font color
 static SDL_Color white = {255, 255, 255, 255};
@@ -11,13 +13,111 @@ void ng_label_create(ng_label_t *label, TTF_Font *font, unsigned int wrap_length
 
     label->font = font;
     label->wrap_length = wrap_length;
+    label->version = 0;
+
+    label->glyphs = NULL;
+    label->quads = NULL;
+    label->quad_count = label->quad_capacity = 0;
+}
+
+void ng_label_create_cached(ng_label_t *label, ng_glyph_cache_t *glyphs, unsigned int wrap_length)
+{
+    ng_label_create(label, glyphs->font, wrap_length);
+    label->glyphs = glyphs;
+}
+
+static void push_quad(ng_label_t *label, ng_glyph_t *glyph, int x, int y)
+{
+    // The buffer only grows, so labels that keep changing stop allocating quickly
+    if (label->quad_count == label->quad_capacity)
+    {
+        label->quad_capacity = label->quad_capacity > 0 ? label->quad_capacity * 2 : 32;
+        label->quads = realloc(label->quads, label->quad_capacity * sizeof(ng_label_quad_t));
+        if (!label->quads)
+            ng_die("failed to allocate %d label quads", label->quad_capacity);
+    }
+
+    ng_label_quad_t *quad = &label->quads[label->quad_count++];
+    quad->src = glyph->src;
+    quad->dst = (SDL_Rect) {x + glyph->offset_x, y, glyph->src.w, glyph->src.h};
+}
+
+// Width of the word starting at the given character, in pixels
+static int get_word_width(ng_glyph_cache_t *glyphs, const char *word)
+{
+    int width = 0;
+    for (const char *c = word; *c && *c != ' ' && *c != '\n'; c++)
+    {
+        ng_glyph_t *glyph = ng_glyph_cache_get(glyphs, *c);
+        if (glyph)
+            width += glyph->advance;
+    }
+
+    return width;
+}
+
+// Wraps the same way TTF_RenderText_Solid_Wrapped does: on new lines and
+// before any word that would end up crossing the wrap length
+static void layout(ng_label_t *label, const char *content)
+{
+    ng_glyph_cache_t *glyphs = label->glyphs;
+    int pen_x = 0, pen_y = 0;
+    int line_width = 0, width = 0;
+
+    label->quad_count = 0;
+    for (const char *c = content; *c; c++)
+    {
+        bool is_word_start = *c != ' ' && *c != '\n' && (c == content || c[-1] == ' ');
+        bool should_wrap = label->wrap_length > 0 && is_word_start && pen_x > 0 &&
+                           pen_x + get_word_width(glyphs, c) > (int) label->wrap_length;
+
+        if (*c == '\n' || should_wrap)
+        {
+            width = MAX(width, line_width);
+            pen_x = line_width = 0;
+            pen_y += glyphs->line_skip;
+
+            if (*c == '\n')
+                continue;
+        }
+
+        ng_glyph_t *glyph = ng_glyph_cache_get(glyphs, *c);
+        if (!glyph)
+            continue;
+
+        if (glyph->src.w > 0)
+            push_quad(label, glyph, pen_x, pen_y);
+
+        pen_x += glyph->advance;
+
+        // Trailing spaces don't count towards the width of the line
+        if (*c != ' ')
+            line_width = pen_x;
+    }
+
+    width = MAX(width, line_width);
+
+    ng_sprite_t *sprite = &label->sprite;
+    sprite->texture = glyphs->texture;
+    sprite->src = (SDL_Rect) {0, 0, width, pen_y + glyphs->line_height};
+
+    sprite->transform.x = sprite->transform.y = 0;
+    ng_sprite_set_scale(sprite, 1.0f);
 }
 
 void ng_label_set_content(ng_label_t *label, SDL_Renderer *renderer, const char *content)
 {
+    label->version++;
+
+    if (label->glyphs)
+    {
+        layout(label, content);
+        return;
+    }
+
     // Avoid the memory leak
     SDL_DestroyTexture(label->sprite.texture);
-    
+
     SDL_Surface *surface = label->wrap_length > 0
         ? TTF_RenderText_Solid_Wrapped(label->font, content, white, label->wrap_length)
         : TTF_RenderText_Solid(label->font, content, white);
@@ -26,7 +126,44 @@ void ng_label_set_content(ng_label_t *label, SDL_Renderer *renderer, const char
     SDL_FreeSurface(surface);
 }
 
+void ng_label_render(ng_label_t *label, ng_render_batch_t *batch)
+{
+    if (!label->glyphs)
+    {
+        if (label->sprite.texture)
+            ng_render_batch_add(batch, &label->sprite);
+
+        return;
+    }
+
+    if (label->quad_count == 0)
+        return;
+
+    // The label might have been scaled, every quad has to follow along
+    SDL_FRect *transform = &label->sprite.transform;
+    float scale_x = transform->w / label->sprite.src.w;
+    float scale_y = transform->h / label->sprite.src.h;
+
+    ng_sprite_t glyph = { .texture = label->glyphs->texture };
+    for (int i = 0; i < label->quad_count; i++)
+    {
+        ng_label_quad_t *quad = &label->quads[i];
+
+        glyph.src = quad->src;
+        glyph.transform.x = transform->x + quad->dst.x * scale_x;
+        glyph.transform.y = transform->y + quad->dst.y * scale_y;
+        glyph.transform.w = quad->dst.w * scale_x;
+        glyph.transform.h = quad->dst.h * scale_y;
+
+        ng_render_batch_add(batch, &glyph);
+    }
+}
+
 void ng_label_destroy(ng_label_t *label)
 {
-    SDL_DestroyTexture(label->sprite.texture);
+    // The texture of cached labels belongs to the glyph cache
+    if (label->glyphs)
+        free(label->quads);
+    else
+        SDL_DestroyTexture(label->sprite.texture);
 }
@@ -3,6 +3,15 @@
 
 #include <stdbool.h>
 #include "sprite.h"
+#include "batch.h"
+#include "glyphs.h"
+
+// A single character of a cached label, relative to the label's top left corner
+typedef struct
+{
+    SDL_Rect src;
+    SDL_Rect dst;
+} ng_label_quad_t;
 
 // Labels will inherit from sprite too
 typedef struct
@@ -11,13 +20,28 @@ typedef struct
 
     TTF_Font *font;
     unsigned int wrap_length;
+
+    // Goes up every time the content changes
+    unsigned int version;
+
+    // Only used by labels created from a glyph cache
+    // The sprite then just holds the size and position of the whole text
+    ng_glyph_cache_t *glyphs;
+    ng_label_quad_t *quads;
+    int quad_count, quad_capacity;
 } ng_label_t;
 
 // NOTE: Leave wrap_length to 0 for default rendering in a single line
 // The wrap width should be provided in pixels
 void ng_label_create(ng_label_t *label, TTF_Font *font, unsigned int wrap_length);
 
+// Same as above, but the text is drawn with glyphs out of the cache, so
+// changing it every frame is cheap (no texture gets created)
+void ng_label_create_cached(ng_label_t *label, ng_glyph_cache_t *glyphs, unsigned int wrap_length);
+
+// NOTE: Resets the position and scale of the label, just like ng_sprite_create
 void ng_label_set_content(ng_label_t *label, SDL_Renderer *renderer, const char *content);
+void ng_label_render(ng_label_t *label, ng_render_batch_t *batch);
 void ng_label_destroy(ng_label_t *label);
 
 #endif
@@ -0,0 +1,386 @@
+#include "jobs.h"
+#include "common.h"
+#include "arena.h"
+#include <stdlib.h>
+
+// Same as the loader, the browser build only has the main thread
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+#define NO_THREADS
+#endif
+
+#define QUEUE_MASK (NG_JOB_QUEUE - 1)
+
+// Which deque belongs to the current thread, if it's a worker
+static _Thread_local ng_jobs_t *owner = NULL;
+static _Thread_local int owner_index = 0;
+
+static int get_deque_index(ng_jobs_t *jobs)
+{
+    return owner == jobs ? owner_index : jobs->worker_count;
+}
+
+static bool push(ng_job_deque_t *deque, int job)
+{
+    SDL_AtomicLock(&deque->lock);
+    bool is_full = deque->bottom - deque->top == NG_JOB_QUEUE;
+    if (!is_full)
+        deque->jobs[deque->bottom++ & QUEUE_MASK] = job;
+    SDL_AtomicUnlock(&deque->lock);
+
+    return !is_full;
+}
+
+static int pop(ng_job_deque_t *deque)
+{
+    int job = -1;
+
+    SDL_AtomicLock(&deque->lock);
+    if (deque->bottom != deque->top)
+        job = deque->jobs[--deque->bottom & QUEUE_MASK];
+    SDL_AtomicUnlock(&deque->lock);
+
+    return job;
+}
+
+static int steal(ng_job_deque_t *deque)
+{
+    int job = -1;
+
+    SDL_AtomicLock(&deque->lock);
+    if (deque->bottom != deque->top)
+        job = deque->jobs[deque->top++ & QUEUE_MASK];
+    SDL_AtomicUnlock(&deque->lock);
+
+    return job;
+}
+
+// The thread's own jobs first, then everybody else's, starting from its neighbour
+static int take_job(ng_jobs_t *jobs, int index)
+{
+    int job = pop(&jobs->deques[index]);
+
+    int deque_count = jobs->worker_count + 1;
+    for (int i = 1; job < 0 && i < deque_count; i++)
+        job = steal(&jobs->deques[(index + i) % deque_count]);
+
+    return job;
+}
+
+static int allocate_job(ng_jobs_t *jobs)
+{
+    SDL_AtomicLock(&jobs->free_lock);
+    int job = jobs->first_free;
+    if (job >= 0)
+        jobs->first_free = jobs->jobs[job].next;
+    SDL_AtomicUnlock(&jobs->free_lock);
+
+    return job;
+}
+
+static void free_job(ng_jobs_t *jobs, int job)
+{
+    SDL_AtomicLock(&jobs->free_lock);
+    jobs->jobs[job].next = jobs->first_free;
+    jobs->first_free = job;
+    SDL_AtomicUnlock(&jobs->free_lock);
+}
+
+static void execute(ng_jobs_t *jobs, int job);
+static void start_workers(ng_jobs_t *jobs);
+
+// Wakes up the threads sleeping in ng_jobs_wait, they check again what they were waiting for
+static void notify_waiters(ng_jobs_t *jobs)
+{
+    if (SDL_AtomicGet(&jobs->waiting_count) == 0)
+        return;
+
+    SDL_LockMutex(jobs->wait_lock);
+    jobs->progress++;
+    SDL_CondBroadcast(jobs->has_progress);
+    SDL_UnlockMutex(jobs->wait_lock);
+}
+
+static void queue_job(ng_jobs_t *jobs, int job)
+{
+    if (!push(&jobs->deques[get_deque_index(jobs)], job))
+    {
+        execute(jobs, job);
+        return;
+    }
+
+    if (jobs->worker_count > 0)
+    {
+        if (!SDL_AtomicGet(&jobs->has_started))
+            start_workers(jobs);
+
+        SDL_SemPost(jobs->has_work);
+    }
+
+    notify_waiters(jobs);
+}
+
+// Counts the job as done, queueing whatever was waiting for the counter
+static void finish(ng_jobs_t *jobs, ng_job_counter_t *counter)
+{
+    if (!counter)
+        return;
+
+    int waiting = -1;
+
+    SDL_AtomicLock(&counter->lock);
+    bool is_done = SDL_AtomicAdd(&counter->pending, -1) == 1;
+    if (is_done)
+    {
+        waiting = counter->first_waiting;
+        counter->first_waiting = -1;
+    }
+    SDL_AtomicUnlock(&counter->lock);
+
+    // The counter may be gone by now, only the list taken out of it is left
+    while (waiting >= 0)
+    {
+        int next = jobs->jobs[waiting].next;
+        queue_job(jobs, waiting);
+        waiting = next;
+    }
+
+    if (is_done)
+        notify_waiters(jobs);
+}
+
+static void execute(ng_jobs_t *jobs, int job)
+{
+    // Copied out, so the slot can be reused by jobs this one submits
+    ng_job_t copy = jobs->jobs[job];
+    free_job(jobs, job);
+
+    copy.function(copy.userdata, copy.start, copy.end);
+    finish(jobs, copy.counter);
+}
+
+#ifndef NO_THREADS
+static int worker_main(void *data)
+{
+    ng_jobs_t *jobs = data;
+    owner = jobs;
+    owner_index = SDL_AtomicAdd(&jobs->started_count, 1);
+
+    while (!SDL_AtomicGet(&jobs->is_quitting))
+    {
+        int job = take_job(jobs, owner_index);
+        if (job >= 0)
+            execute(jobs, job);
+        else
+            SDL_SemWait(jobs->has_work);
+    }
+
+    // In case any of the jobs needed scratch memory
+    ng_scratch_release();
+    return 0;
+}
+#endif
+
+// Only the first caller gets to start them, anybody racing it just goes on:
+// the jobs stay queued until either a worker or a waiting thread takes them
+static void start_workers(ng_jobs_t *jobs)
+{
+    if (!SDL_AtomicCAS(&jobs->has_started, 0, 1))
+        return;
+
+#ifndef NO_THREADS
+    for (int i = 0; i < jobs->worker_count; i++)
+    {
+        jobs->workers[i] = SDL_CreateThread(worker_main, "ng_jobs", jobs);
+        if (!jobs->workers[i])
+            ng_die("failed to create a job thread: %s", SDL_GetError());
+    }
+#endif
+}
+
+void ng_jobs_create(ng_jobs_t *jobs, int worker_count)
+{
+#ifdef NO_THREADS
+    worker_count = 0;
+#else
+    // The main thread helps whenever it waits, so it counts as one of them
+    if (worker_count <= 0)
+        worker_count = MAX(SDL_GetCPUCount() - 1, 1);
+#endif
+
+    jobs->worker_count = worker_count;
+    jobs->deques = calloc(worker_count + 1, sizeof(ng_job_deque_t));
+    jobs->jobs = malloc(NG_MAX_JOBS * sizeof(ng_job_t));
+    jobs->workers = malloc(MAX(worker_count, 1) * sizeof(SDL_Thread*));
+    if (!jobs->deques || !jobs->jobs || !jobs->workers)
+        ng_die("failed to allocate the job system");
+
+    for (int i = 0; i < NG_MAX_JOBS; i++)
+        jobs->jobs[i].next = i + 1 < NG_MAX_JOBS ? i + 1 : -1;
+    jobs->first_free = 0;
+    jobs->free_lock = 0;
+
+    jobs->has_work = SDL_CreateSemaphore(0);
+    jobs->wait_lock = SDL_CreateMutex();
+    jobs->has_progress = SDL_CreateCond();
+    if (!jobs->has_work || !jobs->wait_lock || !jobs->has_progress)
+        ng_die("failed to create the job system's synchronization primitives");
+
+    jobs->progress = 0;
+    SDL_AtomicSet(&jobs->waiting_count, 0);
+    SDL_AtomicSet(&jobs->is_quitting, 0);
+    SDL_AtomicSet(&jobs->started_count, 0);
+    SDL_AtomicSet(&jobs->has_started, 0);
+}
+
+void ng_jobs_counter_init(ng_job_counter_t *counter)
+{
+    SDL_AtomicSet(&counter->pending, 0);
+    counter->lock = 0;
+    counter->first_waiting = -1;
+}
+
+bool ng_jobs_is_done(ng_job_counter_t *counter)
+{
+    return SDL_AtomicGet(&counter->pending) == 0;
+}
+
+// The counter has already been increased for this job
+static void submit(ng_jobs_t *jobs, ng_job_counter_t *dependency, ng_job_function_t function,
+                   void *userdata, int start, int end, ng_job_counter_t *counter)
+{
+    int index = allocate_job(jobs);
+    if (index < 0)
+    {
+        // Out of slots, this one runs right here
+        if (dependency)
+            ng_jobs_wait(jobs, dependency);
+
+        function(userdata, start, end);
+        finish(jobs, counter);
+        return;
+    }
+
+    ng_job_t *job = &jobs->jobs[index];
+    job->function = function;
+    job->userdata = userdata;
+    job->start = start;
+    job->end = end;
+    job->counter = counter;
+
+    if (dependency)
+    {
+        SDL_AtomicLock(&dependency->lock);
+        bool has_to_wait = SDL_AtomicGet(&dependency->pending) > 0;
+        if (has_to_wait)
+        {
+            job->next = dependency->first_waiting;
+            dependency->first_waiting = index;
+        }
+        SDL_AtomicUnlock(&dependency->lock);
+
+        if (has_to_wait)
+            return;
+    }
+
+    queue_job(jobs, index);
+}
+
+void ng_jobs_run(ng_jobs_t *jobs, ng_job_function_t function, void *userdata, ng_job_counter_t *counter)
+{
+    ng_jobs_run_after(jobs, NULL, function, userdata, counter);
+}
+
+void ng_jobs_run_after(ng_jobs_t *jobs, ng_job_counter_t *dependency,
+                       ng_job_function_t function, void *userdata, ng_job_counter_t *counter)
+{
+    if (counter)
+        SDL_AtomicAdd(&counter->pending, 1);
+
+    submit(jobs, dependency, function, userdata, 0, 1, counter);
+}
+
+void ng_jobs_parallel_for(ng_jobs_t *jobs, ng_job_function_t function, void *userdata,
+                          int count, int grain, ng_job_counter_t *counter)
+{
+    ng_jobs_parallel_for_after(jobs, NULL, function, userdata, count, grain, counter);
+}
+
+void ng_jobs_parallel_for_after(ng_jobs_t *jobs, ng_job_counter_t *dependency,
+                                ng_job_function_t function, void *userdata,
+                                int count, int grain, ng_job_counter_t *counter)
+{
+    if (count <= 0)
+        return;
+
+    grain = MAX(grain, 1);
+
+    // Counted all at once, otherwise the first ranges could bring
+    // it down to zero before the last ones are even submitted
+    if (counter)
+        SDL_AtomicAdd(&counter->pending, (count + grain - 1) / grain);
+
+    for (int start = 0; start < count; start += grain)
+        submit(jobs, dependency, function, userdata, start, MIN(start + grain, count), counter);
+}
+
+void ng_jobs_wait(ng_jobs_t *jobs, ng_job_counter_t *counter)
+{
+    int index = get_deque_index(jobs);
+
+    while (SDL_AtomicGet(&counter->pending) > 0)
+    {
+        int job = take_job(jobs, index);
+        if (job >= 0)
+        {
+            execute(jobs, job);
+            continue;
+        }
+
+        // Anything that happens after reading the progress wakes us up, anything
+        // that happened before it (but after the first look) shows up right here
+        SDL_AtomicAdd(&jobs->waiting_count, 1);
+        SDL_LockMutex(jobs->wait_lock);
+        int progress = jobs->progress;
+        SDL_UnlockMutex(jobs->wait_lock);
+
+        job = take_job(jobs, index);
+        if (job < 0 && SDL_AtomicGet(&counter->pending) > 0)
+        {
+            SDL_LockMutex(jobs->wait_lock);
+            while (jobs->progress == progress)
+                SDL_CondWait(jobs->has_progress, jobs->wait_lock);
+            SDL_UnlockMutex(jobs->wait_lock);
+        }
+        SDL_AtomicAdd(&jobs->waiting_count, -1);
+
+        if (job >= 0)
+            execute(jobs, job);
+    }
+
+    // The thread that finished the last job might still be holding the lock
+    SDL_AtomicLock(&counter->lock);
+    SDL_AtomicUnlock(&counter->lock);
+}
+
+void ng_jobs_destroy(ng_jobs_t *jobs)
+{
+    SDL_AtomicSet(&jobs->is_quitting, 1);
+
+#ifndef NO_THREADS
+    if (SDL_AtomicGet(&jobs->has_started))
+    {
+        for (int i = 0; i < jobs->worker_count; i++)
+            SDL_SemPost(jobs->has_work);
+
+        for (int i = 0; i < jobs->worker_count; i++)
+            SDL_WaitThread(jobs->workers[i], NULL);
+    }
+#endif
+
+    SDL_DestroyCond(jobs->has_progress);
+    SDL_DestroyMutex(jobs->wait_lock);
+    SDL_DestroySemaphore(jobs->has_work);
+    free(jobs->workers);
+    free(jobs->jobs);
+    free(jobs->deques);
+}
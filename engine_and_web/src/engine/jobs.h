@@ -0,0 +1,119 @@
+#ifndef _NG_JOBS_H
+#define _NG_JOBS_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+// Jobs that can be queued or waiting at once, past that they just run right away
+#define NG_MAX_JOBS 4096
+// Per thread, has to be a power of two
+#define NG_JOB_QUEUE 1024
+
+// Works on the items in [start, end), single jobs get 0 and 1
+typedef void (*ng_job_function_t) (void *userdata, int start, int end);
+
+// Counts the jobs that haven't finished yet. Jobs that depend on a counter
+// wait on the side (without taking up a thread) until it drops to zero
+// NOTE: Submit every job of a counter before the ones that depend on it,
+// and keep it alive until ng_jobs_wait returns
+typedef struct
+{
+    SDL_atomic_t pending;
+
+    // Guards the list of waiting jobs, -1 ends it
+    SDL_SpinLock lock;
+    int first_waiting;
+} ng_job_counter_t;
+
+typedef struct
+{
+    ng_job_function_t function;
+    void *userdata;
+    int start, end;
+
+    // Can be NULL
+    ng_job_counter_t *counter;
+
+    // In the free list, or in the waiting list of a counter
+    int next;
+} ng_job_t;
+
+// The owner pushes and pops at the bottom, other threads steal from the top
+typedef struct
+{
+    SDL_SpinLock lock;
+    int jobs[NG_JOB_QUEUE];
+    int top, bottom;
+} ng_job_deque_t;
+
+/*
+ * A fixed pool of worker threads for splitting up per-frame work. Every
+ * thread has its own deque: new jobs go to the bottom of the submitting
+ * thread's deque and it takes them back from there (the newest are the
+ * likeliest to still be in the cache), while idle threads steal the oldest
+ * ones from the top of somebody else's. Most of the time everybody works on
+ * their own jobs, so the locks are almost never contended
+ *
+ * Waiting for a counter runs jobs in the meantime, so the main thread always
+ * helps and nested waits inside jobs can't deadlock. Only once there's nothing
+ * left to take does it sleep, until another job gets queued or a counter
+ * finishes. Without threads (the browser build) the waiting thread simply
+ * runs all of them. Jobs shouldn't call SDL's video or render functions,
+ * those have to stay on the main thread
+ *
+ * The workers are only started along with the first job, a game that never
+ * splits anything up doesn't have them sitting around
+ */
+typedef struct
+{
+    SDL_Thread **workers;
+    int worker_count;
+    SDL_atomic_t has_started;
+
+    // One per worker, the last one is shared by every other thread
+    ng_job_deque_t *deques;
+
+    ng_job_t *jobs;
+    int first_free;
+    SDL_SpinLock free_lock;
+
+    // Posted once per queued job, idle workers sleep on it
+    SDL_sem *has_work;
+    SDL_atomic_t is_quitting;
+    // Workers number themselves as they start
+    SDL_atomic_t started_count;
+
+    // Bumped whenever a job gets queued or a counter drops to zero,
+    // but only while somebody is asleep in ng_jobs_wait
+    SDL_mutex *wait_lock;
+    SDL_cond *has_progress;
+    int progress;
+    SDL_atomic_t waiting_count;
+} ng_jobs_t;
+
+// NOTE: Leave worker_count to 0 to use one worker per spare core
+void ng_jobs_create(ng_jobs_t *jobs, int worker_count);
+
+void ng_jobs_counter_init(ng_job_counter_t *counter);
+bool ng_jobs_is_done(ng_job_counter_t *counter);
+
+// The counter (which can be NULL) goes up now and back down once the job has run
+void ng_jobs_run(ng_jobs_t *jobs, ng_job_function_t function, void *userdata, ng_job_counter_t *counter);
+// Same, but it only gets queued once `dependency` drops to zero
+void ng_jobs_run_after(ng_jobs_t *jobs, ng_job_counter_t *dependency,
+                       ng_job_function_t function, void *userdata, ng_job_counter_t *counter);
+
+// Splits [0, count) into jobs of at most `grain` items each
+void ng_jobs_parallel_for(ng_jobs_t *jobs, ng_job_function_t function, void *userdata,
+                          int count, int grain, ng_job_counter_t *counter);
+void ng_jobs_parallel_for_after(ng_jobs_t *jobs, ng_job_counter_t *dependency,
+                                ng_job_function_t function, void *userdata,
+                                int count, int grain, ng_job_counter_t *counter);
+
+// Runs queued jobs until the counter drops to zero, sleeps when there are none
+void ng_jobs_wait(ng_jobs_t *jobs, ng_job_counter_t *counter);
+
+// Any jobs that are still queued are dropped
+void ng_jobs_destroy(ng_jobs_t *jobs);
+
+#endif
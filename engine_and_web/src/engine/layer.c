@@ -0,0 +1,230 @@
+#include "layer.h"
+#include "common.h"
+#include <math.h>
+
+void ng_layer_create(ng_layer_t *layer, SDL_Renderer *renderer, bool is_static)
+{
+    layer->renderer = renderer;
+    layer->is_static = is_static;
+    layer->item_count = 0;
+
+    layer->texture = NULL;
+    layer->texture_width = layer->texture_height = 0;
+    layer->sprite.texture = NULL;
+    layer->scale_x = layer->scale_y = 0;
+    layer->is_dirty = true;
+
+    ng_render_batch_create(&layer->batch, renderer);
+}
+
+static void add_item(ng_layer_t *layer, ng_sprite_t *sprite, ng_label_t *label)
+{
+    if (layer->item_count == NG_LAYER_ITEMS)
+        ng_die("too many items in a layer, the limit is %d", NG_LAYER_ITEMS);
+
+    ng_layer_item_t *item = &layer->items[layer->item_count++];
+    item->sprite = sprite;
+    item->label = label;
+    item->drawn = *sprite;
+    item->drawn_version = label ? label->version : 0;
+    layer->is_dirty = true;
+}
+
+void ng_layer_add_sprite(ng_layer_t *layer, ng_sprite_t *sprite)
+{
+    add_item(layer, sprite, NULL);
+}
+
+void ng_layer_add_label(ng_layer_t *layer, ng_label_t *label)
+{
+    add_item(layer, &label->sprite, label);
+}
+
+void ng_layer_invalidate(ng_layer_t *layer)
+{
+    layer->is_dirty = true;
+}
+
+void ng_layer_release(ng_layer_t *layer)
+{
+    SDL_DestroyTexture(layer->texture);
+    layer->texture = NULL;
+    layer->texture_width = layer->texture_height = 0;
+    layer->sprite.texture = NULL;
+    layer->is_dirty = true;
+}
+
+static bool is_same_sprite(ng_sprite_t *a, ng_sprite_t *b)
+{
+    return a->texture == b->texture &&
+           a->src.x == b->src.x && a->src.y == b->src.y &&
+           a->src.w == b->src.w && a->src.h == b->src.h &&
+           a->transform.x == b->transform.x && a->transform.y == b->transform.y &&
+           a->transform.w == b->transform.w && a->transform.h == b->transform.h;
+}
+
+// Also takes a new snapshot of every item, the cache is about to match them again
+static bool has_changed(ng_layer_t *layer)
+{
+    bool has_changed = layer->is_dirty;
+
+    for (int i = 0; i < layer->item_count; i++)
+    {
+        ng_layer_item_t *item = &layer->items[i];
+        unsigned int version = item->label ? item->label->version : 0;
+
+        if (is_same_sprite(&item->drawn, item->sprite) && item->drawn_version == version)
+            continue;
+
+        item->drawn = *item->sprite;
+        item->drawn_version = version;
+        has_changed = true;
+    }
+
+    return has_changed;
+}
+
+// Queues every item moved by (-x, -y)
+static void queue_items(ng_layer_t *layer, ng_render_batch_t *batch, float x, float y)
+{
+    for (int i = 0; i < layer->item_count; i++)
+    {
+        ng_layer_item_t *item = &layer->items[i];
+        if (item->label)
+        {
+            // Labels only read themselves while rendering, a moved copy draws the same glyphs
+            ng_label_t moved = *item->label;
+            moved.sprite.transform.x -= x;
+            moved.sprite.transform.y -= y;
+            ng_label_render(&moved, batch);
+        }
+        else if (item->sprite->texture)
+        {
+            ng_sprite_t moved = *item->sprite;
+            moved.transform.x -= x;
+            moved.transform.y -= y;
+            ng_render_batch_add(batch, &moved);
+        }
+    }
+}
+
+// The part of the screen covered by the items, in the game's coordinates
+static bool get_bounds(ng_layer_t *layer, float screen_width, float screen_height, SDL_FRect *bounds)
+{
+    float left = screen_width, top = screen_height, right = 0, bottom = 0;
+
+    for (int i = 0; i < layer->item_count; i++)
+    {
+        SDL_FRect *transform = &layer->items[i].sprite->transform;
+        left = MIN(left, transform->x);
+        top = MIN(top, transform->y);
+        right = MAX(right, transform->x + transform->w);
+        bottom = MAX(bottom, transform->y + transform->h);
+    }
+
+    // Backgrounds are often bigger than the screen, there's no point in caching the rest
+    left = floorf(MAX(left, 0));
+    top = floorf(MAX(top, 0));
+    right = MIN(right, screen_width);
+    bottom = MIN(bottom, screen_height);
+
+    *bounds = (SDL_FRect) {left, top, right - left, bottom - top};
+    return bounds->w > 0 && bounds->h > 0;
+}
+
+static void redraw(ng_layer_t *layer, ng_render_batch_t *batch, int output_width, int output_height)
+{
+    SDL_Renderer *renderer = layer->renderer;
+    float scale_x = layer->scale_x, scale_y = layer->scale_y;
+
+    SDL_FRect bounds;
+    layer->sprite.texture = NULL;
+    if (!get_bounds(layer, output_width / scale_x, output_height / scale_y, &bounds))
+        return;
+
+    int used_width = ceilf(bounds.w * scale_x);
+    int used_height = ceilf(bounds.h * scale_y);
+
+    // Grows but never shrinks, layers usually cover about the same area every time
+    if (used_width > layer->texture_width || used_height > layer->texture_height)
+    {
+        int width = MAX(used_width, layer->texture_width);
+        int height = MAX(used_height, layer->texture_height);
+        ng_layer_release(layer);
+
+        layer->texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+                                           SDL_TEXTUREACCESS_TARGET, width, height);
+        if (!layer->texture)
+            ng_die("failed to create a %dx%d layer: %s", width, height, SDL_GetError());
+
+        SDL_SetTextureBlendMode(layer->texture, SDL_BLENDMODE_BLEND);
+        SDL_SetTextureScaleMode(layer->texture, SDL_ScaleModeNearest);
+        layer->texture_width = width;
+        layer->texture_height = height;
+
+        // A new texture can end up at the address of the old one,
+        // the batch must not keep using the old one's size
+        batch->cached_texture = NULL;
+    }
+
+    // Switching targets resets the scale, and the frame's target has to come back after
+    SDL_Texture *previous = SDL_GetRenderTarget(renderer);
+    Uint8 r, g, b, a;
+    SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+
+    SDL_SetRenderTarget(renderer, layer->texture);
+    SDL_RenderSetScale(renderer, scale_x, scale_y);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
+
+    queue_items(layer, &layer->batch, bounds.x, bounds.y);
+    ng_render_batch_flush(&layer->batch);
+
+    SDL_SetRenderTarget(renderer, previous);
+    SDL_RenderSetScale(renderer, scale_x, scale_y);
+    SDL_SetRenderDrawColor(renderer, r, g, b, a);
+
+    layer->sprite.texture = layer->texture;
+    layer->sprite.src = (SDL_Rect) {0, 0, used_width, used_height};
+    layer->sprite.transform = (SDL_FRect) {bounds.x, bounds.y, used_width / scale_x, used_height / scale_y};
+
+    // The cache might be copied to the same place as before, with different pixels
+    ng_render_batch_invalidate(batch, &layer->sprite.transform);
+}
+
+void ng_layer_render(ng_layer_t *layer, ng_render_batch_t *batch)
+{
+    if (!layer->is_static)
+    {
+        queue_items(layer, batch, 0, 0);
+        return;
+    }
+
+    // Same resolution as whatever the frame is being drawn into
+    float scale_x, scale_y;
+    int output_width, output_height;
+    SDL_RenderGetScale(layer->renderer, &scale_x, &scale_y);
+    SDL_GetRendererOutputSize(layer->renderer, &output_width, &output_height);
+
+    if (scale_x != layer->scale_x || scale_y != layer->scale_y)
+    {
+        layer->scale_x = scale_x;
+        layer->scale_y = scale_y;
+        layer->is_dirty = true;
+    }
+
+    if (has_changed(layer))
+    {
+        redraw(layer, batch, output_width, output_height);
+        layer->is_dirty = false;
+    }
+
+    if (layer->sprite.texture)
+        ng_render_batch_add(batch, &layer->sprite);
+}
+
+void ng_layer_destroy(ng_layer_t *layer)
+{
+    ng_layer_release(layer);
+    ng_render_batch_destroy(&layer->batch);
+}
@@ -0,0 +1,74 @@
+#ifndef _NG_LAYER_H
+#define _NG_LAYER_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include "sprite.h"
+#include "batch.h"
+#include "interface.h"
+
+#define NG_LAYER_ITEMS 16
+
+// Either a sprite or a label, along with how it looked when the cache was drawn
+typedef struct
+{
+    ng_sprite_t *sprite;
+    ng_label_t *label;
+
+    ng_sprite_t drawn;
+    unsigned int drawn_version;
+} ng_layer_item_t;
+
+/*
+ * A group of sprites and labels that are always drawn together, in the order
+ * they were added. Static layers are drawn once into a texture of their own
+ * (just big enough for the part of the screen they cover) and every frame
+ * after that only copies it, no matter how many items or glyphs are in there
+ *
+ * Items are plain sprites that the game keeps writing to directly, so the
+ * layer remembers what each one looked like and compares on every render:
+ * a different texture, src or transform (or new content in a label) redraws
+ * the whole cache. Something that changes every frame doesn't belong in a
+ * static layer, it would only pay for the copy on top
+ *
+ * NOTE: The cache is blended over whatever is below it, which is exact for
+ * pixels that are either opaque or fully transparent (pixel art, solid text)
+ */
+typedef struct
+{
+    SDL_Renderer *renderer;
+    bool is_static;
+
+    ng_layer_item_t items[NG_LAYER_ITEMS];
+    int item_count;
+
+    // Only the top left corner of it might be in use
+    SDL_Texture *texture;
+    int texture_width, texture_height;
+
+    // Where the cache goes on the screen, the texture is NULL when it's empty
+    ng_sprite_t sprite;
+    // The render scale the cache was drawn at, it's redrawn when that changes
+    float scale_x, scale_y;
+    bool is_dirty;
+
+    // Only for drawing the cache, so the game's own batch is left alone
+    ng_render_batch_t batch;
+} ng_layer_t;
+
+// NOTE: Layers that aren't static just queue their items every frame
+void ng_layer_create(ng_layer_t *layer, SDL_Renderer *renderer, bool is_static);
+
+// NOTE: Items are not copied, they have to outlive the layer
+void ng_layer_add_sprite(ng_layer_t *layer, ng_sprite_t *sprite);
+void ng_layer_add_label(ng_layer_t *layer, ng_label_t *label);
+
+// Forces a redraw, for changes the layer can't see (e.g. new pixels in the same texture)
+void ng_layer_invalidate(ng_layer_t *layer);
+// Frees the cache until the next render, e.g. when the scene using it is left
+void ng_layer_release(ng_layer_t *layer);
+
+void ng_layer_render(ng_layer_t *layer, ng_render_batch_t *batch);
+void ng_layer_destroy(ng_layer_t *layer);
+
+#endif
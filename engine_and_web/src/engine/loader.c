@@ -0,0 +1,351 @@
+#include "loader.h"
+#include "common.h"
+#include <SDL2/SDL_image.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Without pthreads support the browser build can't spawn workers,
+// so the images get decoded inside ng_loader_pump instead
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+#define NO_THREADS
+#endif
+
+// Is this request completely handled (uploaded or failed and reported)?
+// Only the main thread touches the path once the request is queued
+static bool is_finished(ng_load_request_t *request)
+{
+    return request->path == NULL;
+}
+
+static void decode(ng_load_request_t *request)
+{
+    if (request->baked)
+    {
+        SDL_AtomicSet(&request->state, NG_LOAD_DECODED);
+        return;
+    }
+
+    SDL_Surface *surface = IMG_Load(request->path);
+
+    // Converting here as well, so that the main thread doesn't have to
+    if (surface)
+    {
+        SDL_Surface *converted = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+        SDL_FreeSurface(surface);
+        surface = converted;
+    }
+
+    request->surface = surface;
+
+    // SDL_AtomicSet is a full memory barrier, the surface is visible before the new state
+    SDL_AtomicSet(&request->state, surface ? NG_LOAD_DECODED : NG_LOAD_FAILED);
+}
+
+// Hands the request over to the main thread, the lock has to be held
+static void mark_decoded(ng_loader_t *loader, ng_load_handle_t handle)
+{
+    loader->decoded[loader->decoded_count++] = handle;
+    SDL_CondBroadcast(loader->has_decoded);
+}
+
+#ifdef NO_THREADS
+// Decodes the oldest request that nobody waited for yet, returns false if there's none
+static bool decode_next(ng_loader_t *loader)
+{
+    while (loader->next_to_decode < loader->request_count)
+    {
+        ng_load_handle_t handle = loader->next_to_decode++;
+        ng_load_request_t *request = loader->requests[handle];
+        if (SDL_AtomicGet(&request->state) != NG_LOAD_QUEUED)
+            continue;
+
+        decode(request);
+        mark_decoded(loader, handle);
+        return true;
+    }
+
+    return false;
+}
+#else
+static int worker_main(void *data)
+{
+    ng_loader_t *loader = data;
+
+    SDL_LockMutex(loader->lock);
+    for (;;)
+    {
+        while (!loader->is_quitting && loader->next_to_decode == loader->request_count)
+            SDL_CondWait(loader->has_work, loader->lock);
+
+        if (loader->is_quitting)
+            break;
+
+        ng_load_handle_t handle = loader->next_to_decode++;
+        ng_load_request_t *request = loader->requests[handle];
+
+        // Decoding is the slow part, other workers should be able to go on meanwhile
+        SDL_UnlockMutex(loader->lock);
+        decode(request);
+        SDL_LockMutex(loader->lock);
+
+        mark_decoded(loader, handle);
+    }
+    SDL_UnlockMutex(loader->lock);
+
+    return 0;
+}
+#endif
+
+// Uploads the surface (if any) and notifies whoever asked for it
+// Returns the amount of bytes that were sent to the GPU
+static size_t finish(ng_loader_t *loader, ng_load_request_t *request)
+{
+    size_t bytes = 0;
+
+    if (request->baked)
+    {
+        bytes = (size_t) request->baked->width * request->baked->height * 4;
+        request->texture = ng_pack_create_texture(loader->pack, loader->renderer, request->baked);
+    }
+    else if (request->surface)
+    {
+        bytes = (size_t) request->surface->h * request->surface->pitch;
+        request->texture = SDL_CreateTextureFromSurface(loader->renderer, request->surface);
+
+        SDL_FreeSurface(request->surface);
+        request->surface = NULL;
+    }
+
+    SDL_AtomicSet(&request->state, request->texture ? NG_LOAD_READY : NG_LOAD_FAILED);
+
+    if (request->callback)
+        request->callback(request->path, request->texture, request->userdata);
+
+    // The path is not needed anymore, which also marks the request as finished
+    free(request->path);
+    request->path = NULL;
+    loader->finished_count++;
+
+    return bytes;
+}
+
+void ng_loader_create(ng_loader_t *loader, SDL_Renderer *renderer, int worker_count)
+{
+    loader->renderer = renderer;
+    loader->pack = NULL;
+
+    loader->requests = NULL;
+    loader->request_count = loader->request_capacity = 0;
+    loader->next_to_decode = 0;
+    loader->finished_count = 0;
+    loader->decoded = NULL;
+    loader->decoded_count = loader->next_to_finish = 0;
+    loader->is_quitting = false;
+
+    // Half a dozen medium sized textures per frame by default
+    ng_loader_set_budget(loader, 4 * 1024 * 1024, 6);
+
+    loader->lock = SDL_CreateMutex();
+    loader->has_work = SDL_CreateCond();
+    loader->has_decoded = SDL_CreateCond();
+    if (!loader->lock || !loader->has_work || !loader->has_decoded)
+        ng_die("failed to create the loader's synchronization primitives");
+
+#ifdef NO_THREADS
+    loader->workers = NULL;
+    loader->worker_count = 0;
+#else
+    // The main thread is busy rendering, leave its core alone
+    if (worker_count <= 0)
+        worker_count = MAX(SDL_GetCPUCount() - 1, 1);
+
+    loader->workers = malloc(worker_count * sizeof(SDL_Thread*));
+    if (!loader->workers)
+        ng_die("failed to allocate %d loader workers", worker_count);
+
+    loader->worker_count = worker_count;
+    for (int i = 0; i < worker_count; i++)
+    {
+        loader->workers[i] = SDL_CreateThread(worker_main, "ng_loader", loader);
+        if (!loader->workers[i])
+            ng_die("failed to create a loader thread: %s", SDL_GetError());
+    }
+#endif
+}
+
+void ng_loader_set_budget(ng_loader_t *loader, size_t bytes, int textures)
+{
+    loader->budget_bytes = bytes;
+    loader->budget_textures = textures;
+}
+
+void ng_loader_mount_pack(ng_loader_t *loader, ng_pack_t *pack)
+{
+    loader->pack = pack;
+}
+
+ng_load_handle_t ng_loader_request(ng_loader_t *loader, const char *path,
+                                   ng_load_callback_t callback, void *userdata)
+{
+    ng_load_request_t *request = malloc(sizeof(ng_load_request_t));
+    if (!request)
+        ng_die("failed to allocate a load request for %s", path);
+
+    request->path = strdup(path);
+    request->callback = callback;
+    request->userdata = userdata;
+    request->baked = loader->pack ? ng_pack_find(loader->pack, path) : NULL;
+    request->surface = NULL;
+    request->texture = NULL;
+    SDL_AtomicSet(&request->state, NG_LOAD_QUEUED);
+
+    // The workers read the array too, so it may only grow while locked
+    SDL_LockMutex(loader->lock);
+
+    if (loader->request_count == loader->request_capacity)
+    {
+        loader->request_capacity = loader->request_capacity > 0 ? loader->request_capacity * 2 : 32;
+        loader->requests = realloc(loader->requests, loader->request_capacity * sizeof(ng_load_request_t*));
+        loader->decoded = realloc(loader->decoded, loader->request_capacity * sizeof(ng_load_handle_t));
+        if (!loader->requests || !loader->decoded)
+            ng_die("failed to grow the loader queue");
+    }
+
+    ng_load_handle_t handle = loader->request_count;
+    loader->requests[loader->request_count++] = request;
+
+    SDL_CondSignal(loader->has_work);
+    SDL_UnlockMutex(loader->lock);
+
+    return handle;
+}
+
+// The oldest decoded request that hasn't been looked at, NULL if there's none
+static ng_load_request_t* take_decoded(ng_loader_t *loader)
+{
+    ng_load_request_t *request = NULL;
+    SDL_LockMutex(loader->lock);
+
+#ifdef NO_THREADS
+    if (loader->next_to_finish == loader->decoded_count)
+        decode_next(loader);
+#endif
+
+    if (loader->next_to_finish < loader->decoded_count)
+        request = loader->requests[loader->decoded[loader->next_to_finish++]];
+
+    SDL_UnlockMutex(loader->lock);
+    return request;
+}
+
+int ng_loader_pump(ng_loader_t *loader)
+{
+    int uploads = 0;
+    size_t bytes = 0;
+
+    while (uploads < loader->budget_textures && bytes < loader->budget_bytes)
+    {
+        ng_load_request_t *request = take_decoded(loader);
+        if (!request)
+            break;
+
+        // Somebody waited for it in the meantime
+        if (is_finished(request))
+            continue;
+
+        bytes += finish(loader, request);
+        uploads++;
+    }
+
+    return uploads;
+}
+
+SDL_Texture* ng_loader_wait(ng_loader_t *loader, ng_load_handle_t handle)
+{
+    ng_load_request_t *request = loader->requests[handle];
+    if (is_finished(request))
+        return request->texture;
+
+#ifdef NO_THREADS
+    // decode_next skips it later on
+    if (SDL_AtomicGet(&request->state) == NG_LOAD_QUEUED)
+        decode(request);
+#else
+    // The request might not even be picked up yet, but it will be soon enough.
+    // Workers set the state before taking the lock to announce it, so no wake up gets lost
+    SDL_LockMutex(loader->lock);
+    while (SDL_AtomicGet(&request->state) == NG_LOAD_QUEUED)
+        SDL_CondWait(loader->has_decoded, loader->lock);
+    SDL_UnlockMutex(loader->lock);
+#endif
+
+    finish(loader, request);
+    return request->texture;
+}
+
+void ng_loader_finish(ng_loader_t *loader)
+{
+    while (!ng_loader_is_done(loader))
+    {
+    #ifndef NO_THREADS
+        // Whatever isn't finished yet ends up on the decoded list sooner or later
+        SDL_LockMutex(loader->lock);
+        while (loader->next_to_finish == loader->decoded_count)
+            SDL_CondWait(loader->has_decoded, loader->lock);
+        SDL_UnlockMutex(loader->lock);
+    #endif
+
+        ng_load_request_t *request = take_decoded(loader);
+        if (request && !is_finished(request))
+            finish(loader, request);
+    }
+}
+
+ng_load_state_t ng_loader_get_state(ng_loader_t *loader, ng_load_handle_t handle)
+{
+    return SDL_AtomicGet(&loader->requests[handle]->state);
+}
+
+SDL_Texture* ng_loader_get_texture(ng_loader_t *loader, ng_load_handle_t handle)
+{
+    return loader->requests[handle]->texture;
+}
+
+bool ng_loader_is_done(ng_loader_t *loader)
+{
+    return loader->finished_count == loader->request_count;
+}
+
+float ng_loader_get_progress(ng_loader_t *loader)
+{
+    if (loader->request_count == 0)
+        return 1.0f;
+
+    return (float) loader->finished_count / loader->request_count;
+}
+
+void ng_loader_destroy(ng_loader_t *loader)
+{
+    SDL_LockMutex(loader->lock);
+    loader->is_quitting = true;
+    SDL_CondBroadcast(loader->has_work);
+    SDL_UnlockMutex(loader->lock);
+
+    for (int i = 0; i < loader->worker_count; i++)
+        SDL_WaitThread(loader->workers[i], NULL);
+
+    for (int i = 0; i < loader->request_count; i++)
+    {
+        SDL_FreeSurface(loader->requests[i]->surface);
+        free(loader->requests[i]->path);
+        free(loader->requests[i]);
+    }
+
+    free(loader->requests);
+    free(loader->decoded);
+    free(loader->workers);
+
+    SDL_DestroyCond(loader->has_decoded);
+    SDL_DestroyCond(loader->has_work);
+    SDL_DestroyMutex(loader->lock);
+}
@@ -0,0 +1,107 @@
+#ifndef _NG_LOADER_H
+#define _NG_LOADER_H
+
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+#include "pack.h"
+
+typedef enum
+{
+    NG_LOAD_QUEUED,
+    NG_LOAD_DECODED,
+    NG_LOAD_READY,
+    NG_LOAD_FAILED
+} ng_load_state_t;
+
+// Called on the main thread, right after the texture gets uploaded
+// The texture is NULL if the image could not be decoded
+typedef void (*ng_load_callback_t) (const char *path, SDL_Texture *texture, void *userdata);
+
+typedef struct
+{
+    char *path;
+    ng_load_callback_t callback;
+    void *userdata;
+
+    // Images found in the pack skip decoding, the main thread uploads them as they are
+    ng_pack_entry_t *baked;
+
+    // Written by the workers, read by the main thread
+    SDL_atomic_t state;
+    SDL_Surface *surface;
+
+    SDL_Texture *texture;
+} ng_load_request_t;
+
+// Handles are just indices, they stay valid until the loader is destroyed
+typedef int ng_load_handle_t;
+
+/*
+ * Images are decoded into surfaces by a pool of worker threads, while the
+ * main thread uploads the finished ones to the GPU (renderers are not thread
+ * safe) a few at a time, whenever ng_loader_pump gets called. That way the
+ * frame rate stays intact during long loads
+ */
+typedef struct
+{
+    SDL_Renderer *renderer;
+    // NULL until a pack gets mounted
+    ng_pack_t *pack;
+
+    SDL_Thread **workers;
+    int worker_count;
+
+    // Only the main thread appends requests, the workers
+    // just take the next one in line while holding the lock
+    ng_load_request_t **requests;
+    int request_count, request_capacity;
+    int next_to_decode;
+    int finished_count;
+
+    // Handles in the order their decoding ended (failures too), so the
+    // main thread only ever looks at the ones it can upload. It has as
+    // much room as the requests, the workers never have to grow it
+    ng_load_handle_t *decoded;
+    int decoded_count;
+    int next_to_finish;
+
+    SDL_mutex *lock;
+    SDL_cond *has_work;
+    SDL_cond *has_decoded;
+    bool is_quitting;
+
+    // Upload limits for a single ng_loader_pump call
+    size_t budget_bytes;
+    int budget_textures;
+} ng_loader_t;
+
+// NOTE: Leave worker_count to 0 to use one worker per spare core
+void ng_loader_create(ng_loader_t *loader, SDL_Renderer *renderer, int worker_count);
+void ng_loader_set_budget(ng_loader_t *loader, size_t bytes, int textures);
+// Same as ng_assets_mount_pack, only affects the requests made after it
+// NOTE: The pack has to outlive the loader
+void ng_loader_mount_pack(ng_loader_t *loader, ng_pack_t *pack);
+
+// The callback is optional, handles can be polled instead
+ng_load_handle_t ng_loader_request(ng_loader_t *loader, const char *path,
+                                   ng_load_callback_t callback, void *userdata);
+
+// Uploads decoded images without exceeding the budget
+// Should be called once per frame, returns the number of uploads
+int ng_loader_pump(ng_loader_t *loader);
+
+// Blocks until this specific request is uploaded, ignoring the budget
+SDL_Texture* ng_loader_wait(ng_loader_t *loader, ng_load_handle_t handle);
+// Same for every request made so far
+void ng_loader_finish(ng_loader_t *loader);
+
+ng_load_state_t ng_loader_get_state(ng_loader_t *loader, ng_load_handle_t handle);
+SDL_Texture* ng_loader_get_texture(ng_loader_t *loader, ng_load_handle_t handle);
+
+bool ng_loader_is_done(ng_loader_t *loader);
+float ng_loader_get_progress(ng_loader_t *loader);
+
+// Textures that were already handed out are not destroyed
+void ng_loader_destroy(ng_loader_t *loader);
+
+#endif
@@ -0,0 +1,361 @@
+#include "mixer.h"
+#include "common.h"
+#include <SDL2/SDL.h>
+#include <string.h>
+
+#ifdef HAS_X86
+#include <immintrin.h>
+#endif
+
+#ifdef __wasm_simd128__
+#include <wasm_simd128.h>
+#endif
+
+typedef struct
+{
+    const char *name;
+
+    // mix += samples * gain, alternating between the left and right gain
+    void (*accumulate)(int32_t*, const int16_t*, int32_t, int32_t, int);
+    // stream = clamp(stream + mix)
+    void (*resolve)(int16_t*, const int32_t*, int);
+} implementation_t;
+
+// Scalar versions, these also finish whatever doesn't fill a whole register
+// Counts are in samples, which always come in left/right pairs
+
+static void accumulate_scalar(int32_t *mix, const int16_t *samples, int32_t left, int32_t right, int count)
+{
+    for (int i = 0; i < count; i += 2)
+    {
+        mix[i] += (samples[i] * left) >> 15;
+        mix[i + 1] += (samples[i + 1] * right) >> 15;
+    }
+}
+
+static void resolve_scalar(int16_t *stream, const int32_t *mix, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        int32_t sample = stream[i] + mix[i];
+        stream[i] = sample > INT16_MAX ? INT16_MAX : sample < INT16_MIN ? INT16_MIN : sample;
+    }
+}
+
+static implementation_t scalar_version = { "scalar", accumulate_scalar, resolve_scalar };
+
+#ifdef HAS_X86
+
+// SSE2, 8 samples at a time. There's no 32 bit multiplication, so
+// the low and high halves of the 16 bit products get stitched together
+
+TARGET("sse2")
+static void accumulate_sse2(int32_t *mix, const int16_t *samples, int32_t left, int32_t right, int count)
+{
+    __m128i gains = _mm_set_epi16(right, left, right, left, right, left, right, left);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i*) (samples + i));
+        __m128i low = _mm_mullo_epi16(x, gains);
+        __m128i high = _mm_mulhi_epi16(x, gains);
+
+        __m128i first = _mm_srai_epi32(_mm_unpacklo_epi16(low, high), 15);
+        __m128i second = _mm_srai_epi32(_mm_unpackhi_epi16(low, high), 15);
+
+        __m128i *out = (__m128i*) (mix + i);
+        _mm_storeu_si128(out, _mm_add_epi32(_mm_loadu_si128(out), first));
+        _mm_storeu_si128(out + 1, _mm_add_epi32(_mm_loadu_si128(out + 1), second));
+    }
+
+    accumulate_scalar(mix + i, samples + i, left, right, count - i);
+}
+
+TARGET("sse2")
+static void resolve_sse2(int16_t *stream, const int32_t *mix, int count)
+{
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i*) (stream + i));
+
+        // Sign extending by putting every sample in the upper half first
+        __m128i first = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        __m128i second = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        first = _mm_add_epi32(first, _mm_loadu_si128((const __m128i*) (mix + i)));
+        second = _mm_add_epi32(second, _mm_loadu_si128((const __m128i*) (mix + i + 4)));
+
+        _mm_storeu_si128((__m128i*) (stream + i), _mm_packs_epi32(first, second));
+    }
+
+    resolve_scalar(stream + i, mix + i, count - i);
+}
+
+static implementation_t sse2_version = { "SSE2", accumulate_sse2, resolve_sse2 };
+
+// AVX2, 8 samples (widened to 32 bits) or 16 samples at a time
+
+TARGET("avx2")
+static void accumulate_avx2(int32_t *mix, const int16_t *samples, int32_t left, int32_t right, int count)
+{
+    __m256i gains = _mm256_set_epi32(right, left, right, left, right, left, right, left);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*) (samples + i)));
+        __m256i product = _mm256_srai_epi32(_mm256_mullo_epi32(x, gains), 15);
+
+        __m256i *out = (__m256i*) (mix + i);
+        _mm256_storeu_si256(out, _mm256_add_epi32(_mm256_loadu_si256(out), product));
+    }
+
+    accumulate_scalar(mix + i, samples + i, left, right, count - i);
+}
+
+TARGET("avx2")
+static void resolve_avx2(int16_t *stream, const int32_t *mix, int count)
+{
+    int i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m256i first = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*) (stream + i)));
+        __m256i second = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*) (stream + i + 8)));
+        first = _mm256_add_epi32(first, _mm256_loadu_si256((const __m256i*) (mix + i)));
+        second = _mm256_add_epi32(second, _mm256_loadu_si256((const __m256i*) (mix + i + 8)));
+
+        // Packing works within each 128 bit lane, the permutation puts the samples back in order
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(first, second), 0xD8);
+        _mm256_storeu_si256((__m256i*) (stream + i), packed);
+    }
+
+    resolve_scalar(stream + i, mix + i, count - i);
+}
+
+static implementation_t avx2_version = { "AVX2", accumulate_avx2, resolve_avx2 };
+
+#endif
+
+#ifdef __wasm_simd128__
+
+// SIMD128, 8 samples at a time
+
+static void accumulate_simd128(int32_t *mix, const int16_t *samples, int32_t left, int32_t right, int count)
+{
+    v128_t gains = wasm_i32x4_make(left, right, left, right);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        v128_t x = wasm_v128_load(samples + i);
+        v128_t first = wasm_i32x4_shr(wasm_i32x4_mul(wasm_i32x4_extend_low_i16x8(x), gains), 15);
+        v128_t second = wasm_i32x4_shr(wasm_i32x4_mul(wasm_i32x4_extend_high_i16x8(x), gains), 15);
+
+        wasm_v128_store(mix + i, wasm_i32x4_add(wasm_v128_load(mix + i), first));
+        wasm_v128_store(mix + i + 4, wasm_i32x4_add(wasm_v128_load(mix + i + 4), second));
+    }
+
+    accumulate_scalar(mix + i, samples + i, left, right, count - i);
+}
+
+static void resolve_simd128(int16_t *stream, const int32_t *mix, int count)
+{
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        v128_t x = wasm_v128_load(stream + i);
+        v128_t first = wasm_i32x4_add(wasm_i32x4_extend_low_i16x8(x), wasm_v128_load(mix + i));
+        v128_t second = wasm_i32x4_add(wasm_i32x4_extend_high_i16x8(x), wasm_v128_load(mix + i + 4));
+
+        wasm_v128_store(stream + i, wasm_i16x8_narrow_i32x4(first, second));
+    }
+
+    resolve_scalar(stream + i, mix + i, count - i);
+}
+
+static implementation_t simd128_version = { "SIMD128", accumulate_simd128, resolve_simd128 };
+
+#endif
+
+// Whatever gets mixed before ng_mixer_create goes through the scalar versions
+static implementation_t *active = &scalar_version;
+
+// The fastest version this machine supports
+static implementation_t* get_implementation(void)
+{
+    switch (ng_get_instruction_set())
+    {
+#ifdef HAS_X86
+    case NG_AVX2:
+        return &avx2_version;
+    case NG_SSE2:
+        return &sse2_version;
+#endif
+#ifdef __wasm_simd128__
+    case NG_SIMD128:
+        return &simd128_version;
+#endif
+    default:
+        return &scalar_version;
+    }
+}
+
+void ng_mixer_create(ng_mixer_t *mixer, int voice_budget)
+{
+    mixer->playing_count = 0;
+    mixer->free_count = NG_MAX_VOICES;
+    for (int i = 0; i < NG_MAX_VOICES; i++)
+        mixer->free[i] = NG_MAX_VOICES - 1 - i;
+
+    mixer->voice_budget = CLAMP(voice_budget, 1, NG_MAX_VOICES);
+    mixer->volume = 128;
+    mixer->clock = 0;
+
+    mixer->stolen_count = 0;
+    mixer->dropped_count = 0;
+
+    // Picked here, so the audio thread doesn't have to
+    active = get_implementation();
+}
+
+// Whether voice `a` goes before voice `b` in the playing order
+static bool comes_before(ng_voice_t *a, ng_voice_t *b)
+{
+    if (a->priority != b->priority)
+        return a->priority > b->priority;
+
+    return a->started > b->started;
+}
+
+static void remove_from_order(ng_mixer_t *mixer, int position)
+{
+    memmove(&mixer->order[position], &mixer->order[position + 1],
+            (mixer->playing_count - position - 1) * sizeof(int));
+    mixer->playing_count--;
+}
+
+bool ng_mixer_play(ng_mixer_t *mixer, const int16_t *samples, int frame_count,
+                   float gain, float pan, int priority, int loops)
+{
+    if (!samples || frame_count <= 0)
+        return false;
+
+    if (mixer->free_count == 0)
+    {
+        // The last one is the least important, and the oldest among equals
+        int victim = mixer->order[mixer->playing_count - 1];
+        if (mixer->voices[victim].priority > priority)
+        {
+            mixer->dropped_count++;
+            return false;
+        }
+
+        remove_from_order(mixer, mixer->playing_count - 1);
+        mixer->free[mixer->free_count++] = victim;
+        mixer->stolen_count++;
+    }
+
+    int index = mixer->free[--mixer->free_count];
+    ng_voice_t *voice = &mixer->voices[index];
+
+    gain = CLAMP(gain, 0, 1);
+    pan = CLAMP(pan, -1, 1);
+
+    voice->samples = samples;
+    voice->frame_count = frame_count;
+    voice->position = 0;
+    voice->loops = loops;
+    voice->left = (int16_t) (gain * MIN(1, 1 - pan) * 32767);
+    voice->right = (int16_t) (gain * MIN(1, 1 + pan) * 32767);
+    voice->priority = priority;
+    voice->started = ++mixer->clock;
+
+    // Being the newest, it goes right after the voices of higher or equal priority
+    int position = mixer->playing_count;
+    while (position > 0 && comes_before(voice, &mixer->voices[mixer->order[position - 1]]))
+        position--;
+
+    memmove(&mixer->order[position + 1], &mixer->order[position],
+            (mixer->playing_count - position) * sizeof(int));
+    mixer->order[position] = index;
+    mixer->playing_count++;
+
+    return true;
+}
+
+void ng_mixer_stop_all(ng_mixer_t *mixer)
+{
+    for (int i = 0; i < mixer->playing_count; i++)
+        mixer->free[mixer->free_count++] = mixer->order[i];
+
+    mixer->playing_count = 0;
+}
+
+void ng_mixer_set_volume(ng_mixer_t *mixer, int volume)
+{
+    mixer->volume = CLAMP(volume, 0, 128);
+}
+
+// Mixes (or just skips, when it's over the budget) the next frames of the voice
+// Returns false once it's done playing
+static bool advance_voice(ng_mixer_t *mixer, ng_voice_t *voice, int frame_count, bool is_audible)
+{
+    int32_t left = voice->left * mixer->volume >> 7;
+    int32_t right = voice->right * mixer->volume >> 7;
+
+    int offset = 0;
+    while (offset < frame_count)
+    {
+        int count = MIN(frame_count - offset, voice->frame_count - voice->position);
+        if (is_audible)
+            active->accumulate(mixer->mix + offset * 2, voice->samples + voice->position * 2, left, right, count * 2);
+
+        offset += count;
+        voice->position += count;
+
+        if (voice->position < voice->frame_count)
+            continue;
+
+        if (voice->loops == 0)
+            return false;
+
+        if (voice->loops > 0)
+            voice->loops--;
+
+        voice->position = 0;
+    }
+
+    return true;
+}
+
+void ng_mixer_mix(ng_mixer_t *mixer, int16_t *stream, int frame_count)
+{
+    for (int start = 0; start < frame_count; start += NG_MIX_FRAMES)
+    {
+        int count = MIN(frame_count - start, NG_MIX_FRAMES);
+        if (mixer->playing_count == 0)
+            return;
+
+        memset(mixer->mix, 0, count * 2 * sizeof(int32_t));
+
+        // Finished voices are dropped from the order as it's walked
+        int kept = 0;
+        for (int i = 0; i < mixer->playing_count; i++)
+        {
+            int index = mixer->order[i];
+            if (advance_voice(mixer, &mixer->voices[index], count, i < mixer->voice_budget))
+                mixer->order[kept++] = index;
+            else
+                mixer->free[mixer->free_count++] = index;
+        }
+        mixer->playing_count = kept;
+
+        active->resolve(stream + start * 2, mixer->mix, count * 2);
+    }
+}
+
+const char* ng_mixer_get_instruction_set(void)
+{
+    return active->name;
+}
@@ -0,0 +1,82 @@
+#ifndef _NG_MIXER_H
+#define _NG_MIXER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define NG_MAX_VOICES 256
+// Longer buffers are mixed in pieces of this many frames
+#define NG_MIX_FRAMES 1024
+
+typedef struct
+{
+    // Interleaved 16 bit stereo, in the format the device was opened with
+    const int16_t *samples;
+    int frame_count;
+    // Next frame to be mixed
+    int position;
+    // -1 loops forever
+    int loops;
+
+    // Q15, 32767 is full volume
+    int16_t left, right;
+
+    int priority;
+    // Newer voices have bigger stamps
+    uint32_t started;
+} ng_voice_t;
+
+/*
+ * Mixes any number of overlapping sounds straight into the device buffer,
+ * instead of SDL_mixer's fixed channels (where a sound just doesn't play
+ * once they're all busy). Only the audio thread should touch it, audio.c
+ * feeds it from the command queue
+ *
+ * Voices come from a fixed pool. When it runs out, the lowest priority
+ * voice (the oldest one among equals) makes room for the new one, unless
+ * the new one has an even lower priority. Only the first `voice_budget`
+ * voices in priority order get mixed, the rest keep advancing silently, so
+ * a pile of overlapping effects can't make the callback miss its deadline
+ *
+ * Voices are added up in 32 bits with SSE2/AVX2 (SIMD128 on the web),
+ * and clamped to 16 bits once at the end. Every version gives the exact
+ * same samples
+ */
+typedef struct
+{
+    ng_voice_t voices[NG_MAX_VOICES];
+
+    // Playing voices, highest priority first and newest first among equals
+    int order[NG_MAX_VOICES];
+    int playing_count;
+
+    int free[NG_MAX_VOICES];
+    int free_count;
+
+    int voice_budget;
+    // 0 to 128, applies to every voice
+    int volume;
+    uint32_t clock;
+
+    int stolen_count;
+    int dropped_count;
+
+    int32_t mix[NG_MIX_FRAMES * 2];
+} ng_mixer_t;
+
+void ng_mixer_create(ng_mixer_t *mixer, int voice_budget);
+
+// Gain goes from 0 to 1, pan from -1 (left) to 1 (right). Returns false if
+// every voice is busy with something more important
+bool ng_mixer_play(ng_mixer_t *mixer, const int16_t *samples, int frame_count,
+                   float gain, float pan, int priority, int loops);
+void ng_mixer_stop_all(ng_mixer_t *mixer);
+void ng_mixer_set_volume(ng_mixer_t *mixer, int volume);
+
+// Adds the playing voices on top of what's already in the stream
+void ng_mixer_mix(ng_mixer_t *mixer, int16_t *stream, int frame_count);
+
+// "AVX2", "SSE2", "SIMD128" or "scalar"
+const char* ng_mixer_get_instruction_set(void);
+
+#endif
@@ -0,0 +1,214 @@
+#include "pack.h"
+#include "common.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The browser's file system can't really map files, reading them is just as good
+#if defined(__EMSCRIPTEN__) || defined(_WIN32)
+#define NO_MMAP
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+static bool map_file(ng_pack_t *pack, const char *file)
+{
+#ifdef NO_MMAP
+    FILE *stream = fopen(file, "rb");
+    if (!stream)
+        return false;
+
+    fseek(stream, 0, SEEK_END);
+    pack->size = ftell(stream);
+    fseek(stream, 0, SEEK_SET);
+
+    pack->data = malloc(pack->size);
+    if (!pack->data || fread(pack->data, 1, pack->size, stream) != pack->size)
+    {
+        free(pack->data);
+        fclose(stream);
+        return false;
+    }
+
+    fclose(stream);
+    pack->is_mapped = false;
+    return true;
+#else
+    int fd = open(file, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    // Private and writable, SDL_mixer wants non-const buffers but never
+    // writes into them, so the pages just stay shared with the page cache
+    void *data = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED)
+        return false;
+
+    pack->data = data;
+    pack->size = info.st_size;
+    pack->is_mapped = true;
+    return true;
+#endif
+}
+
+static void unmap_file(ng_pack_t *pack)
+{
+#ifdef NO_MMAP
+    free(pack->data);
+#else
+    if (pack->is_mapped)
+        munmap(pack->data, pack->size);
+    else
+        free(pack->data);
+#endif
+
+    pack->data = NULL;
+}
+
+bool ng_pack_open(ng_pack_t *pack, const char *file)
+{
+    pack->data = NULL;
+    pack->entries = NULL;
+    pack->entry_count = 0;
+    pack->can_use_sounds = false;
+
+    if (!map_file(pack, file))
+        return false;
+
+    ng_pack_header_t *header = (ng_pack_header_t*) pack->data;
+    if (pack->size < sizeof(ng_pack_header_t) || header->magic != NG_PACK_MAGIC ||
+        header->version != NG_PACK_VERSION ||
+        pack->size < sizeof(ng_pack_header_t) + (size_t) header->entry_count * sizeof(ng_pack_entry_t))
+    {
+        fprintf(stderr, "Ignoring %s, it's not a valid asset pack\n", file);
+        unmap_file(pack);
+        return false;
+    }
+
+    pack->entries = (ng_pack_entry_t*) (pack->data + sizeof(ng_pack_header_t));
+    pack->entry_count = header->entry_count;
+
+    // Drop the whole pack if a path runs past its field or a block points outside of the file
+    for (uint32_t i = 0; i < pack->entry_count; i++)
+    {
+        ng_pack_entry_t *entry = &pack->entries[i];
+        if (!memchr(entry->path, '\0', sizeof(entry->path)))
+        {
+            fprintf(stderr, "Ignoring %s, entry %u has no valid path\n", file, i);
+            unmap_file(pack);
+            return false;
+        }
+
+        bool is_truncated = entry->offset > pack->size || entry->size > pack->size - entry->offset;
+        if (entry->type == NG_PACK_IMAGE)
+            is_truncated |= (uint64_t) entry->width * entry->height * 4 > entry->size;
+
+        if (is_truncated)
+        {
+            fprintf(stderr, "Ignoring %s, entry %s is truncated\n", file, entry->path);
+            unmap_file(pack);
+            return false;
+        }
+    }
+
+#ifndef NO_AUDIO
+    // The mixer might have settled for a different format than the one we baked
+    int frequency, channels;
+    Uint16 format;
+    if (Mix_QuerySpec(&frequency, &format, &channels))
+    {
+        pack->can_use_sounds = frequency == NG_PACK_AUDIO_FREQUENCY &&
+                               format == NG_PACK_AUDIO_FORMAT &&
+                               channels == NG_PACK_AUDIO_CHANNELS;
+    }
+#endif
+
+    return true;
+}
+
+ng_pack_entry_t* ng_pack_find(ng_pack_t *pack, const char *path)
+{
+    if (!pack->data)
+        return NULL;
+
+    // The bake tool sorts the table of contents by path
+    int low = 0, high = (int) pack->entry_count - 1;
+    while (low <= high)
+    {
+        int middle = (low + high) / 2;
+        int order = strcmp(path, pack->entries[middle].path);
+
+        if (order == 0)
+            return &pack->entries[middle];
+
+        if (order < 0)
+            high = middle - 1;
+        else
+            low = middle + 1;
+    }
+
+    return NULL;
+}
+
+SDL_Texture* ng_pack_create_texture(ng_pack_t *pack, SDL_Renderer *renderer, ng_pack_entry_t *entry)
+{
+    if (entry->type != NG_PACK_IMAGE)
+        ng_die("pack entry %s is not an image", entry->path);
+
+    SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC,
+                                             entry->width, entry->height);
+    if (!texture)
+        ng_die("failed to create texture for %s: %s", entry->path, SDL_GetError());
+
+    SDL_UpdateTexture(texture, NULL, pack->data + entry->offset, entry->width * 4);
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+    return texture;
+}
+
+SDL_Surface* ng_pack_create_surface(ng_pack_t *pack, ng_pack_entry_t *entry)
+{
+    if (entry->type != NG_PACK_IMAGE)
+        ng_die("pack entry %s is not an image", entry->path);
+
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormatFrom(pack->data + entry->offset, entry->width, entry->height,
+                                                              32, entry->width * 4, SDL_PIXELFORMAT_RGBA32);
+    if (!surface)
+        ng_die("failed to create surface for %s: %s", entry->path, SDL_GetError());
+
+    return surface;
+}
+
+Mix_Chunk* ng_pack_create_sound(ng_pack_t *pack, ng_pack_entry_t *entry)
+{
+    if (entry->type != NG_PACK_SOUND)
+        ng_die("pack entry %s is not a sound", entry->path);
+
+    // The chunk just references the samples, nothing gets copied
+    Mix_Chunk *sound = Mix_QuickLoad_RAW(pack->data + entry->offset, entry->size);
+    if (!sound)
+        ng_die("failed to create sound for %s", entry->path);
+
+    return sound;
+}
+
+void ng_pack_close(ng_pack_t *pack)
+{
+    if (pack->data)
+        unmap_file(pack);
+
+    pack->entries = NULL;
+    pack->entry_count = 0;
+}
@@ -0,0 +1,83 @@
+#ifndef _NG_PACK_H
+#define _NG_PACK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+
+/*
+ * A pack file holds assets that were already decoded offline by the bake
+ * tool (see tools/bake.c), so that loading them is just a matter of pointing
+ * SDL to the right bytes. Layout: header, table of contents sorted by path,
+ * then the data blocks, each one aligned to NG_PACK_ALIGNMENT bytes
+ */
+#define NG_PACK_MAGIC 0x4b50474e // "NGPK"
+#define NG_PACK_VERSION 1
+#define NG_PACK_ALIGNMENT 16
+
+// The format the audio is baked in, it has to match Mix_OpenAudio
+#define NG_PACK_AUDIO_FREQUENCY 44100
+#define NG_PACK_AUDIO_FORMAT AUDIO_S16SYS
+#define NG_PACK_AUDIO_CHANNELS 2
+
+typedef enum
+{
+    // Tightly packed RGBA32 pixels, width * 4 bytes per row
+    NG_PACK_IMAGE = 1,
+    // Interleaved PCM samples in the format defined above
+    NG_PACK_SOUND = 2
+} ng_pack_entry_type_t;
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t reserved;
+} ng_pack_header_t;
+
+typedef struct
+{
+    // Same path that would be used to load the original file
+    char path[112];
+
+    uint32_t type;
+    uint32_t width, height;
+    uint32_t reserved;
+
+    // Relative to the beginning of the file
+    uint64_t offset;
+    uint64_t size;
+} ng_pack_entry_t;
+
+typedef struct
+{
+    uint8_t *data;
+    size_t size;
+    // Whether the data is memory mapped or just read into memory
+    bool is_mapped;
+
+    ng_pack_entry_t *entries;
+    uint32_t entry_count;
+
+    // Baked sounds can only be used if the device runs at the same format
+    bool can_use_sounds;
+} ng_pack_t;
+
+// Returns false if there is no (valid) pack, so that the caller
+// can fall back to loading the original files
+bool ng_pack_open(ng_pack_t *pack, const char *file);
+
+ng_pack_entry_t* ng_pack_find(ng_pack_t *pack, const char *path);
+
+// No decoding happens here, the data is used straight from the pack
+SDL_Texture* ng_pack_create_texture(ng_pack_t *pack, SDL_Renderer *renderer, ng_pack_entry_t *entry);
+// NOTE: The surface points inside the pack, same as sounds
+SDL_Surface* ng_pack_create_surface(ng_pack_t *pack, ng_pack_entry_t *entry);
+// NOTE: The chunk points inside the pack, free it before closing the pack
+Mix_Chunk* ng_pack_create_sound(ng_pack_t *pack, ng_pack_entry_t *entry);
+
+void ng_pack_close(ng_pack_t *pack);
+
+#endif
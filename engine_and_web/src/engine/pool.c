@@ -0,0 +1,110 @@
+#include "pool.h"
+#include "common.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Links the items in [from, to) into the free list, in order
+static void add_free_items(ng_pool_t *pool, int from, int to)
+{
+    for (int i = from; i < to; i++)
+    {
+        pool->next_free[i] = i + 1 < to ? i + 1 : pool->first_free;
+        pool->live_position[i] = -1;
+    }
+
+    if (from < to)
+        pool->first_free = from;
+}
+
+static void grow(ng_pool_t *pool, int capacity)
+{
+    pool->items = realloc(pool->items, capacity * pool->item_size);
+    pool->next_free = realloc(pool->next_free, capacity * sizeof(int));
+    pool->live = realloc(pool->live, capacity * sizeof(int));
+    pool->live_position = realloc(pool->live_position, capacity * sizeof(int));
+
+    if (!pool->items || !pool->next_free || !pool->live || !pool->live_position)
+        ng_die("failed to grow the pool to %d items", capacity);
+
+    memset(pool->items + pool->capacity * pool->item_size, 0, (capacity - pool->capacity) * pool->item_size);
+    add_free_items(pool, pool->capacity, capacity);
+
+    pool->capacity = capacity;
+}
+
+void ng_pool_create(ng_pool_t *pool, size_t item_size, int capacity, bool can_grow)
+{
+    pool->items = NULL;
+    pool->item_size = item_size;
+    pool->capacity = 0;
+    pool->can_grow = can_grow;
+
+    pool->next_free = NULL;
+    pool->first_free = -1;
+
+    pool->live = NULL;
+    pool->live_count = 0;
+    pool->live_position = NULL;
+
+    grow(pool, MAX(capacity, 1));
+}
+
+int ng_pool_acquire(ng_pool_t *pool)
+{
+    if (pool->first_free < 0)
+    {
+        if (!pool->can_grow)
+            return -1;
+
+        grow(pool, pool->capacity * 2);
+    }
+
+    int index = pool->first_free;
+    pool->first_free = pool->next_free[index];
+
+    pool->live_position[index] = pool->live_count;
+    pool->live[pool->live_count++] = index;
+
+    return index;
+}
+
+void ng_pool_release(ng_pool_t *pool, int index)
+{
+    int position = pool->live_position[index];
+    if (position < 0)
+        return;
+
+    // Fill the hole with the last live item
+    int last = pool->live[--pool->live_count];
+    pool->live[position] = last;
+    pool->live_position[last] = position;
+
+    pool->live_position[index] = -1;
+    pool->next_free[index] = pool->first_free;
+    pool->first_free = index;
+}
+
+void ng_pool_clear(ng_pool_t *pool)
+{
+    pool->first_free = -1;
+    pool->live_count = 0;
+    add_free_items(pool, 0, pool->capacity);
+}
+
+void* ng_pool_get(ng_pool_t *pool, int index)
+{
+    return pool->items + index * pool->item_size;
+}
+
+bool ng_pool_is_live(ng_pool_t *pool, int index)
+{
+    return index >= 0 && index < pool->capacity && pool->live_position[index] >= 0;
+}
+
+void ng_pool_destroy(ng_pool_t *pool)
+{
+    free(pool->items);
+    free(pool->next_free);
+    free(pool->live);
+    free(pool->live_position);
+}
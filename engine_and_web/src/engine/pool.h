@@ -0,0 +1,50 @@
+#ifndef _NG_POOL_H
+#define _NG_POOL_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * Fixed size items that can be acquired and released in O(1), no matter
+ * how many of them there are. Free items are chained into a list, live
+ * ones are tracked in a dense array so loops only visit what is alive:
+ *
+ *     for (int i = pool.live_count - 1; i >= 0; i--)
+ *         thing_t *thing = ng_pool_get(&pool, pool.live[i]);
+ *
+ * Going backwards like that allows releasing the current item in the loop
+ * NOTE: Growing moves the items around, don't keep pointers to them, only indices
+ */
+typedef struct
+{
+    char *items;
+    size_t item_size;
+    int capacity;
+    bool can_grow;
+
+    // Each free item points to the next one, -1 ends the list
+    int *next_free;
+    int first_free;
+
+    // Indices of the live items, in no particular order
+    int *live;
+    int live_count;
+    // Where each item is inside `live`, -1 when it's free
+    int *live_position;
+} ng_pool_t;
+
+// Items start out zeroed, they are left untouched when released
+void ng_pool_create(ng_pool_t *pool, size_t item_size, int capacity, bool can_grow);
+
+// Returns the index of the item, or -1 if the pool is full and can't grow
+int ng_pool_acquire(ng_pool_t *pool);
+void ng_pool_release(ng_pool_t *pool, int index);
+// Releases every item at once
+void ng_pool_clear(ng_pool_t *pool);
+
+void* ng_pool_get(ng_pool_t *pool, int index);
+bool ng_pool_is_live(ng_pool_t *pool, int index);
+
+void ng_pool_destroy(ng_pool_t *pool);
+
+#endif
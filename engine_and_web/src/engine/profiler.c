@@ -0,0 +1,233 @@
+#include "profiler.h"
+
+#ifdef NG_PROFILE
+
+#include "interface.h"
+#include "common.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Numbers changing on every single frame can't be read, so
+// the text of the overlay only gets refreshed every few frames
+#define HUD_REFRESH_FRAMES 30
+
+#define HUD_X 10
+#define HUD_Y 10
+#define HUD_LINES 3
+
+// Each frame gets two pixels of the graph
+#define GRAPH_WIDTH (NG_PROFILER_FRAMES * 2)
+#define GRAPH_HEIGHT 80
+// Frame times above that get clipped at the top of the graph
+#define GRAPH_MAX_MS 50.0
+
+static const char *phase_names[NG_PHASE_COUNT] = {"events", "update", "render", "flush", "present"};
+
+static struct
+{
+    // Ring buffer, `current` is the frame being recorded right now
+    ng_profiler_frame_t frames[NG_PROFILER_FRAMES];
+    int current;
+    int recorded;
+
+    uint64_t frame_start;
+    uint64_t phase_start[NG_PHASE_COUNT];
+    double ms_per_tick;
+
+    ng_glyph_cache_t *glyphs;
+    ng_label_t labels[HUD_LINES];
+    bool is_hud_visible;
+    int frames_since_refresh;
+} profiler;
+
+void ng_profiler_begin_frame(void)
+{
+    if (profiler.ms_per_tick == 0)
+        profiler.ms_per_tick = 1000.0 / SDL_GetPerformanceFrequency();
+
+    memset(&profiler.frames[profiler.current], 0, sizeof(ng_profiler_frame_t));
+    profiler.frame_start = SDL_GetPerformanceCounter();
+}
+
+void ng_profiler_end_frame(void)
+{
+    ng_profiler_frame_t *frame = &profiler.frames[profiler.current];
+    frame->total = SDL_GetPerformanceCounter() - profiler.frame_start;
+
+    profiler.current = (profiler.current + 1) % NG_PROFILER_FRAMES;
+    profiler.recorded = MIN(profiler.recorded + 1, NG_PROFILER_FRAMES);
+}
+
+void ng_profiler_begin(ng_phase_t phase)
+{
+    profiler.phase_start[phase] = SDL_GetPerformanceCounter();
+}
+
+void ng_profiler_end(ng_phase_t phase)
+{
+    profiler.frames[profiler.current].phases[phase] += SDL_GetPerformanceCounter() - profiler.phase_start[phase];
+}
+
+void ng_profiler_count_sprite(void)
+{
+    profiler.frames[profiler.current].sprites++;
+}
+
+void ng_profiler_count_draw_call(void)
+{
+    profiler.frames[profiler.current].draw_calls++;
+}
+
+void ng_profiler_count_texture_switch(void)
+{
+    profiler.frames[profiler.current].texture_switches++;
+}
+
+void ng_profiler_set_hud_glyphs(ng_glyph_cache_t *glyphs)
+{
+    profiler.glyphs = glyphs;
+
+    for (int i = 0; i < HUD_LINES; i++)
+        ng_label_create_cached(&profiler.labels[i], glyphs, 0);
+}
+
+void ng_profiler_toggle_hud(void)
+{
+    profiler.is_hud_visible = !profiler.is_hud_visible;
+
+    // Show fresh numbers right away
+    profiler.frames_since_refresh = HUD_REFRESH_FRAMES;
+}
+
+bool ng_profiler_is_hud_visible(void)
+{
+    return profiler.is_hud_visible;
+}
+
+// Returns the recorded frame that is `age` frames old, 1 being the last finished one
+static ng_profiler_frame_t* get_past_frame(int age)
+{
+    return &profiler.frames[(profiler.current - age + NG_PROFILER_FRAMES) % NG_PROFILER_FRAMES];
+}
+
+static int compare_ticks(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+    return (x > y) - (x < y);
+}
+
+static void refresh_labels(SDL_Renderer *renderer)
+{
+    int count = profiler.recorded;
+
+    uint64_t totals[NG_PROFILER_FRAMES];
+    uint64_t phases[NG_PHASE_COUNT] = {0};
+    uint64_t sum = 0;
+
+    for (int age = 1; age <= count; age++)
+    {
+        ng_profiler_frame_t *frame = get_past_frame(age);
+
+        totals[age - 1] = frame->total;
+        sum += frame->total;
+        for (int p = 0; p < NG_PHASE_COUNT; p++)
+            phases[p] += frame->phases[p];
+    }
+
+    qsort(totals, count, sizeof(uint64_t), compare_ticks);
+
+    double average = sum * profiler.ms_per_tick / count;
+    double p50 = totals[(count - 1) * 50 / 100] * profiler.ms_per_tick;
+    double p99 = totals[(count - 1) * 99 / 100] * profiler.ms_per_tick;
+
+    char text[256];
+    snprintf(text, sizeof(text), "frame %.2fms (%.0f fps)  p50 %.2fms  p99 %.2fms",
+             average, average > 0 ? 1000.0 / average : 0.0, p50, p99);
+    ng_label_set_content(&profiler.labels[0], renderer, text);
+
+    int length = 0;
+    for (int p = 0; p < NG_PHASE_COUNT; p++)
+        length += snprintf(text + length, sizeof(text) - length, "%s %.2f  ",
+                           phase_names[p], phases[p] * profiler.ms_per_tick / count);
+    ng_label_set_content(&profiler.labels[1], renderer, text);
+
+    ng_profiler_frame_t *last = get_past_frame(1);
+    snprintf(text, sizeof(text), "sprites %d  draw calls %d  texture switches %d",
+             last->sprites, last->draw_calls, last->texture_switches);
+    ng_label_set_content(&profiler.labels[2], renderer, text);
+
+    profiler.frames_since_refresh = 0;
+}
+
+static void render_graph(SDL_Renderer *renderer)
+{
+    SDL_FPoint points[NG_PROFILER_FRAMES];
+    int count = profiler.recorded;
+
+    // Oldest frame on the left, newest one on the right
+    for (int age = count; age >= 1; age--)
+    {
+        double ms = get_past_frame(age)->total * profiler.ms_per_tick;
+
+        SDL_FPoint *point = &points[count - age];
+        point->x = HUD_X + (count - age) * 2;
+        point->y = HUD_Y + GRAPH_HEIGHT - MIN(ms / GRAPH_MAX_MS, 1.0) * GRAPH_HEIGHT;
+    }
+
+    // Reference line at the 60 FPS budget
+    float budget_y = HUD_Y + GRAPH_HEIGHT - (1000.0 / 60 / GRAPH_MAX_MS) * GRAPH_HEIGHT;
+    SDL_SetRenderDrawColor(renderer, 200, 60, 60, 255);
+    SDL_RenderDrawLineF(renderer, HUD_X, budget_y, HUD_X + GRAPH_WIDTH, budget_y);
+
+    SDL_SetRenderDrawColor(renderer, 80, 220, 80, 255);
+    SDL_RenderDrawLinesF(renderer, points, count);
+}
+
+void ng_profiler_render_hud(ng_render_batch_t *batch)
+{
+    if (!profiler.is_hud_visible || !profiler.glyphs || profiler.recorded == 0)
+        return;
+
+    SDL_Renderer *renderer = batch->renderer;
+    if (profiler.frames_since_refresh++ >= HUD_REFRESH_FRAMES)
+        refresh_labels(renderer);
+
+    // Drawing the overlay should not count towards the frame's numbers
+    ng_profiler_frame_t *frame = &profiler.frames[profiler.current];
+    ng_profiler_frame_t counters = *frame;
+
+    int line_skip = profiler.glyphs->line_skip;
+    float text_y = HUD_Y + GRAPH_HEIGHT + 4;
+
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 180);
+    SDL_FRect background = {HUD_X - 4, HUD_Y - 4, GRAPH_WIDTH * 2 + 8, GRAPH_HEIGHT + HUD_LINES * line_skip + 12};
+    SDL_RenderFillRectF(renderer, &background);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+
+    render_graph(renderer);
+
+    for (int i = 0; i < HUD_LINES; i++)
+    {
+        profiler.labels[i].sprite.transform.x = HUD_X;
+        profiler.labels[i].sprite.transform.y = text_y + i * line_skip;
+        ng_label_render(&profiler.labels[i], batch);
+    }
+    ng_render_batch_flush(batch);
+
+    frame->sprites = counters.sprites;
+    frame->draw_calls = counters.draw_calls;
+    frame->texture_switches = counters.texture_switches;
+}
+
+void ng_profiler_destroy(void)
+{
+    if (!profiler.glyphs)
+        return;
+
+    for (int i = 0; i < HUD_LINES; i++)
+        ng_label_destroy(&profiler.labels[i]);
+}
+
+#endif
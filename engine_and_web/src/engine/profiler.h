@@ -0,0 +1,92 @@
+#ifndef _NG_PROFILER_H
+#define _NG_PROFILER_H
+
+/*
+ * Frame profiler, only compiled in when NG_PROFILE is defined (make PROFILE=1)
+ * Otherwise every macro below expands to nothing, so the instrumentation
+ * can stay in place without costing anything in release builds
+ *
+ * The game loop times its own phases, the batch counts the draw calls
+ * Press F3 to toggle the overlay
+ */
+#ifdef NG_PROFILE
+
+#include <SDL2/SDL.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "batch.h"
+#include "glyphs.h"
+
+// How many frames are kept around for the graph and the percentiles
+#define NG_PROFILER_FRAMES 128
+
+typedef enum
+{
+    NG_PHASE_EVENTS,
+    NG_PHASE_UPDATE,
+    NG_PHASE_RENDER,
+    NG_PHASE_FLUSH,
+    NG_PHASE_PRESENT,
+    NG_PHASE_COUNT
+} ng_phase_t;
+
+typedef struct
+{
+    // In performance counter ticks
+    uint64_t phases[NG_PHASE_COUNT];
+    uint64_t total;
+
+    int sprites;
+    int draw_calls;
+    int texture_switches;
+} ng_profiler_frame_t;
+
+void ng_profiler_begin_frame(void);
+void ng_profiler_end_frame(void);
+
+void ng_profiler_begin(ng_phase_t phase);
+void ng_profiler_end(ng_phase_t phase);
+
+void ng_profiler_count_sprite(void);
+void ng_profiler_count_draw_call(void);
+void ng_profiler_count_texture_switch(void);
+
+// The overlay only shows up once it has a font to draw its text with
+void ng_profiler_set_hud_glyphs(ng_glyph_cache_t *glyphs);
+void ng_profiler_toggle_hud(void);
+bool ng_profiler_is_hud_visible(void);
+// Draws and flushes the overlay on its own, it doesn't show up in the counters
+void ng_profiler_render_hud(ng_render_batch_t *batch);
+
+void ng_profiler_destroy(void);
+
+#define NG_PROFILE_BEGIN_FRAME() ng_profiler_begin_frame()
+#define NG_PROFILE_END_FRAME() ng_profiler_end_frame()
+#define NG_PROFILE_BEGIN(phase) ng_profiler_begin(phase)
+#define NG_PROFILE_END(phase) ng_profiler_end(phase)
+#define NG_PROFILE_COUNT_SPRITE() ng_profiler_count_sprite()
+#define NG_PROFILE_COUNT_DRAW_CALL() ng_profiler_count_draw_call()
+#define NG_PROFILE_COUNT_TEXTURE_SWITCH() ng_profiler_count_texture_switch()
+#define NG_PROFILE_SET_HUD_GLYPHS(glyphs) ng_profiler_set_hud_glyphs(glyphs)
+#define NG_PROFILE_TOGGLE_HUD() ng_profiler_toggle_hud()
+#define NG_PROFILE_RENDER_HUD(batch) ng_profiler_render_hud(batch)
+#define NG_PROFILE_DESTROY() ng_profiler_destroy()
+
+#else
+
+// Still expand to a statement, so the macros can be used anywhere a call can
+#define NG_PROFILE_BEGIN_FRAME() ((void) 0)
+#define NG_PROFILE_END_FRAME() ((void) 0)
+#define NG_PROFILE_BEGIN(phase) ((void) 0)
+#define NG_PROFILE_END(phase) ((void) 0)
+#define NG_PROFILE_COUNT_SPRITE() ((void) 0)
+#define NG_PROFILE_COUNT_DRAW_CALL() ((void) 0)
+#define NG_PROFILE_COUNT_TEXTURE_SWITCH() ((void) 0)
+#define NG_PROFILE_SET_HUD_GLYPHS(glyphs) ((void) 0)
+#define NG_PROFILE_TOGGLE_HUD() ((void) 0)
+#define NG_PROFILE_RENDER_HUD(batch) ((void) 0)
+#define NG_PROFILE_DESTROY() ((void) 0)
+
+#endif
+
+#endif
@@ -0,0 +1,84 @@
+#include "rng.h"
+
+// The constants from the reference implementation (pcg-random.org)
+#define MULTIPLIER 6364136223846793005ULL
+
+void ng_rng_create(ng_rng_t *rng, uint64_t seed, uint64_t stream)
+{
+    // The increment has to be odd, the stream picks which one
+    rng->state = 0;
+    rng->increment = stream << 1 | 1;
+
+    ng_rng_next(rng);
+    rng->state += seed;
+    ng_rng_next(rng);
+}
+
+uint32_t ng_rng_next(ng_rng_t *rng)
+{
+    uint64_t state = rng->state;
+    rng->state = state * MULTIPLIER + rng->increment;
+
+    // Output permutation: xorshift the high bits, then rotate by the top 5 bits
+    uint32_t shifted = (uint32_t) (((state >> 18) ^ state) >> 27);
+    uint32_t rotation = (uint32_t) (state >> 59);
+
+    return shifted >> rotation | shifted << ((-rotation) & 31);
+}
+
+uint32_t ng_rng_below(ng_rng_t *rng, uint32_t bound)
+{
+    if (bound == 0)
+        return 0;
+
+    // Lemire's method: the high half of a 64 bit product is already in range,
+    // only the few values that would make some results more likely get thrown away
+    uint64_t product = (uint64_t) ng_rng_next(rng) * bound;
+    uint32_t low = (uint32_t) product;
+
+    if (low < bound)
+    {
+        uint32_t threshold = -bound % bound;
+        while (low < threshold)
+        {
+            product = (uint64_t) ng_rng_next(rng) * bound;
+            low = (uint32_t) product;
+        }
+    }
+
+    return product >> 32;
+}
+
+int ng_rng_int_in_range(ng_rng_t *rng, int start, int end)
+{
+    return start + (int) ng_rng_below(rng, (uint32_t) (end - start));
+}
+
+bool ng_rng_bool(ng_rng_t *rng)
+{
+    // The top bit is the best one
+    return ng_rng_next(rng) >> 31;
+}
+
+float ng_rng_float(ng_rng_t *rng)
+{
+    // 24 bits fill the whole mantissa, so every result is exact
+    return (ng_rng_next(rng) >> 8) * (1.0f / 16777216.0f);
+}
+
+float ng_rng_float_in_range(ng_rng_t *rng, float start, float end)
+{
+    return start + ng_rng_float(rng) * (end - start);
+}
+
+void ng_rng_fill(ng_rng_t *rng, uint32_t *values, int count)
+{
+    for (int i = 0; i < count; i++)
+        values[i] = ng_rng_next(rng);
+}
+
+void ng_rng_fill_floats(ng_rng_t *rng, float *values, int count)
+{
+    for (int i = 0; i < count; i++)
+        values[i] = ng_rng_float(rng);
+}
@@ -0,0 +1,37 @@
+#ifndef _NG_RNG_H
+#define _NG_RNG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * PCG32 random number generator. Everything it needs is in here, so each
+ * thread (or each system) can own one without sharing any hidden state,
+ * and the same seed gives the same numbers on every platform
+ *
+ * Generators with the same seed but a different stream produce
+ * unrelated sequences, handy for giving every job its own generator
+ */
+typedef struct
+{
+    uint64_t state;
+    uint64_t increment;
+} ng_rng_t;
+
+void ng_rng_create(ng_rng_t *rng, uint64_t seed, uint64_t stream);
+
+uint32_t ng_rng_next(ng_rng_t *rng);
+// Uniform in [0, bound), without the bias of `next % bound`
+uint32_t ng_rng_below(ng_rng_t *rng, uint32_t bound);
+// Uniform in [start, end)
+int ng_rng_int_in_range(ng_rng_t *rng, int start, int end);
+bool ng_rng_bool(ng_rng_t *rng);
+// Uniform in [0, 1)
+float ng_rng_float(ng_rng_t *rng);
+float ng_rng_float_in_range(ng_rng_t *rng, float start, float end);
+
+// Same as calling ng_rng_next / ng_rng_float count times
+void ng_rng_fill(ng_rng_t *rng, uint32_t *values, int count);
+void ng_rng_fill_floats(ng_rng_t *rng, float *values, int count);
+
+#endif
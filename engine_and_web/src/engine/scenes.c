@@ -0,0 +1,151 @@
+#include "scenes.h"
+#include "common.h"
+#include <string.h>
+
+void ng_scenes_create(ng_scene_manager_t *manager, const ng_scene_t *scenes, int scene_count,
+                      ng_assets_t *assets, ng_loader_t *loader, size_t texture_budget)
+{
+    if (scene_count > NG_MAX_SCENES)
+        ng_die("too many scenes, the limit is %d", NG_MAX_SCENES);
+
+    manager->scenes = scenes;
+    manager->scene_count = scene_count;
+    manager->current = -1;
+
+    manager->assets = assets;
+    manager->loader = loader;
+    manager->texture_budget = texture_budget;
+
+    manager->held_count = 0;
+}
+
+static const ng_scene_t* get_current(ng_scene_manager_t *manager)
+{
+    return manager->current >= 0 ? &manager->scenes[manager->current] : NULL;
+}
+
+static int list_textures(const ng_scene_t *scene, const char **paths)
+{
+    if (!scene->list_textures)
+        return 0;
+
+    int count = scene->list_textures(paths);
+    if (count > NG_SCENE_TEXTURES)
+        ng_die("scene %s needs %d textures, the limit is %d", scene->name, count, NG_SCENE_TEXTURES);
+
+    return count;
+}
+
+static void release_held(ng_scene_manager_t *manager)
+{
+    for (int i = 0; i < manager->held_count; i++)
+        ng_assets_release(manager->assets, manager->held[i]);
+
+    manager->held_count = 0;
+}
+
+static void prefetch_successors(ng_scene_manager_t *manager, const ng_scene_t *scene)
+{
+    if (!manager->loader)
+        return;
+
+    for (int i = 0; i < manager->scene_count; i++)
+    {
+        if (!(scene->next & (1u << i)))
+            continue;
+
+        const char *paths[NG_SCENE_TEXTURES];
+        int count = list_textures(&manager->scenes[i], paths);
+        for (int j = 0; j < count; j++)
+            ng_assets_prefetch_texture(manager->assets, manager->loader, paths[j]);
+    }
+}
+
+void ng_scenes_switch(ng_scene_manager_t *manager, int scene)
+{
+    if (scene < 0 || scene >= manager->scene_count)
+        ng_die("there is no scene %d", scene);
+
+    const ng_scene_t *next = &manager->scenes[scene];
+
+    // Taken before the old references are dropped, so that
+    // textures shared by both scenes never get unloaded
+    const char *paths[NG_SCENE_TEXTURES];
+    SDL_Texture *held[NG_SCENE_TEXTURES];
+    int held_count = list_textures(next, paths);
+    for (int i = 0; i < held_count; i++)
+        held[i] = ng_assets_get_texture(manager->assets, paths[i]);
+
+    const ng_scene_t *previous = get_current(manager);
+    if (previous && previous->leave)
+        previous->leave();
+
+    release_held(manager);
+    memcpy(manager->held, held, held_count * sizeof(SDL_Texture*));
+    manager->held_count = held_count;
+    manager->current = scene;
+
+    ng_assets_trim(manager->assets, manager->texture_budget);
+
+    if (next->enter)
+        next->enter();
+
+    // Requested last, the trimming would only be racing them otherwise
+    prefetch_successors(manager, next);
+}
+
+int ng_scenes_get_current(ng_scene_manager_t *manager)
+{
+    return manager->current;
+}
+
+const char* ng_scenes_get_name(ng_scene_manager_t *manager)
+{
+    const ng_scene_t *scene = get_current(manager);
+    return scene ? scene->name : NULL;
+}
+
+int ng_scenes_find(ng_scene_manager_t *manager, const char *name)
+{
+    for (int i = 0; i < manager->scene_count; i++)
+    {
+        if (strcmp(manager->scenes[i].name, name) == 0)
+            return i;
+    }
+
+    return -1;
+}
+
+void ng_scenes_update(ng_scene_manager_t *manager, float delta)
+{
+    if (manager->loader)
+        ng_loader_pump(manager->loader);
+
+    const ng_scene_t *scene = get_current(manager);
+    if (scene && scene->update)
+        scene->update(delta);
+}
+
+void ng_scenes_tick(ng_scene_manager_t *manager)
+{
+    const ng_scene_t *scene = get_current(manager);
+    if (scene && scene->tick)
+        scene->tick();
+}
+
+void ng_scenes_render(ng_scene_manager_t *manager)
+{
+    const ng_scene_t *scene = get_current(manager);
+    if (scene && scene->render)
+        scene->render();
+}
+
+void ng_scenes_destroy(ng_scene_manager_t *manager)
+{
+    const ng_scene_t *scene = get_current(manager);
+    if (scene && scene->leave)
+        scene->leave();
+
+    release_held(manager);
+    manager->current = -1;
+}
@@ -0,0 +1,84 @@
+#ifndef _NG_SCENES_H
+#define _NG_SCENES_H
+
+#include <SDL2/SDL.h>
+#include <stdint.h>
+#include "assets.h"
+#include "loader.h"
+
+#define NG_SCENE_TEXTURES 8
+// The successors of a scene are a bit mask
+#define NG_MAX_SCENES 32
+
+// Writes the paths of the textures the scene needs and returns how many
+// there are. It gets asked again on every transition, so the set can
+// depend on the state of the game
+typedef int (*ng_scene_textures_t) (const char **paths);
+
+typedef struct
+{
+    const char *name;
+
+    // Every hook is optional
+    void (*enter)(void);
+    void (*leave)(void);
+    void (*update)(float delta);
+    void (*tick)(void);
+    void (*render)(void);
+
+    ng_scene_textures_t list_textures;
+
+    // Scenes that can come right after this one, (1 << index) for each of them
+    // Their textures get decoded in the background while this one is running
+    uint32_t next;
+} ng_scene_t;
+
+/*
+ * Runs one scene at a time and keeps only the textures it declared loaded.
+ * On every transition the manager:
+ *
+ *   1. references the textures of the new scene, loading whatever is missing
+ *   2. lets the old scene leave and drops its references
+ *   3. frees the least recently used unreferenced textures over the budget
+ *   4. enters the new scene and prefetches the textures of its successors
+ *
+ * So at any point only the current scene, the ones that may follow it and
+ * whatever still fits in the budget are resident, instead of the whole game
+ */
+typedef struct
+{
+    const ng_scene_t *scenes;
+    int scene_count;
+    // -1 until the first switch
+    int current;
+
+    ng_assets_t *assets;
+    // Can be NULL, then nothing gets prefetched
+    ng_loader_t *loader;
+    size_t texture_budget;
+
+    // References taken for the current scene
+    SDL_Texture *held[NG_SCENE_TEXTURES];
+    int held_count;
+} ng_scene_manager_t;
+
+// NOTE: The scenes are not copied, they have to outlive the manager
+void ng_scenes_create(ng_scene_manager_t *manager, const ng_scene_t *scenes, int scene_count,
+                      ng_assets_t *assets, ng_loader_t *loader, size_t texture_budget);
+
+// Happens right away, hooks of the old scene shouldn't touch its state after calling this
+void ng_scenes_switch(ng_scene_manager_t *manager, int scene);
+
+int ng_scenes_get_current(ng_scene_manager_t *manager);
+const char* ng_scenes_get_name(ng_scene_manager_t *manager);
+// Returns -1 if no scene is called like that
+int ng_scenes_find(ng_scene_manager_t *manager, const char *name);
+
+// These call the hook of the current scene, updating also uploads prefetched textures
+void ng_scenes_update(ng_scene_manager_t *manager, float delta);
+void ng_scenes_tick(ng_scene_manager_t *manager);
+void ng_scenes_render(ng_scene_manager_t *manager);
+
+void ng_scenes_destroy(ng_scene_manager_t *manager);
+
+#endif
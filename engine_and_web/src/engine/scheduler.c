@@ -0,0 +1,229 @@
+#include "scheduler.h"
+#include "common.h"
+
+// Same layout as entity handles: the lower bits are the pool index
+#define INDEX_BITS 20
+#define INDEX_MASK ((1u << INDEX_BITS) - 1)
+#define MAX_GENERATION (UINT32_MAX >> INDEX_BITS)
+
+#define MAKE_HANDLE(index, generation) ((ng_task_t) ((generation) << INDEX_BITS | (index)))
+
+#define SLOT_BITS 8
+#define SLOT_MASK (NG_WHEEL_SLOTS - 1)
+
+#define INITIAL_TASKS 64
+
+void ng_scheduler_create(ng_scheduler_t *scheduler)
+{
+    scheduler->time = 0;
+    scheduler->pending_ms = 0;
+    scheduler->time_scale = 1;
+    scheduler->is_paused = false;
+
+    for (int level = 0; level < NG_WHEEL_LEVELS; level++)
+    {
+        for (int slot = 0; slot < NG_WHEEL_SLOTS; slot++)
+            scheduler->wheel[level][slot] = -1;
+    }
+
+    ng_pool_create(&scheduler->tasks, sizeof(ng_scheduled_task_t), INITIAL_TASKS, true);
+}
+
+static ng_scheduled_task_t* get_task(ng_scheduler_t *scheduler, int index)
+{
+    return ng_pool_get(&scheduler->tasks, index);
+}
+
+static int* get_slot(ng_scheduler_t *scheduler, int slot)
+{
+    return &scheduler->wheel[slot / NG_WHEEL_SLOTS][slot % NG_WHEEL_SLOTS];
+}
+
+// Puts the task into the lowest level that reaches its expiry time
+static void link_task(ng_scheduler_t *scheduler, int index)
+{
+    ng_scheduled_task_t *task = get_task(scheduler, index);
+
+    int level = 0;
+    while (level < NG_WHEEL_LEVELS - 1 &&
+           (task->expires >> (level * SLOT_BITS)) - (scheduler->time >> (level * SLOT_BITS)) >= NG_WHEEL_SLOTS)
+    {
+        level++;
+    }
+
+    task->slot = level * NG_WHEEL_SLOTS + ((task->expires >> (level * SLOT_BITS)) & SLOT_MASK);
+
+    int *head = get_slot(scheduler, task->slot);
+    task->previous = -1;
+    task->next = *head;
+    if (*head >= 0)
+        get_task(scheduler, *head)->previous = index;
+    *head = index;
+}
+
+static void unlink_task(ng_scheduler_t *scheduler, int index)
+{
+    ng_scheduled_task_t *task = get_task(scheduler, index);
+
+    if (task->previous >= 0)
+        get_task(scheduler, task->previous)->next = task->next;
+    else
+        *get_slot(scheduler, task->slot) = task->next;
+
+    if (task->next >= 0)
+        get_task(scheduler, task->next)->previous = task->previous;
+
+    task->slot = -1;
+}
+
+static void release_task(ng_scheduler_t *scheduler, int index)
+{
+    ng_scheduled_task_t *task = get_task(scheduler, index);
+
+    // Old handles to this task are no longer valid (0 is never used, so NG_NO_TASK stays invalid)
+    task->generation = task->generation == MAX_GENERATION ? 1 : task->generation + 1;
+    ng_pool_release(&scheduler->tasks, index);
+}
+
+static ng_task_t schedule(ng_scheduler_t *scheduler, uint32_t delay, uint32_t period,
+                          ng_task_handler_t handler, void *userdata)
+{
+    int index = ng_pool_acquire(&scheduler->tasks);
+    if (index > (int) INDEX_MASK)
+        ng_die("too many scheduled tasks, the limit is %d", INDEX_MASK + 1);
+
+    ng_scheduled_task_t *task = get_task(scheduler, index);
+    if (task->generation == 0)
+        task->generation = 1;
+
+    // The current millisecond has already been processed
+    task->expires = scheduler->time + MAX(delay, 1);
+    task->period = period;
+    task->handler = handler;
+    task->userdata = userdata;
+
+    link_task(scheduler, index);
+    return MAKE_HANDLE(index, task->generation);
+}
+
+ng_task_t ng_scheduler_after(ng_scheduler_t *scheduler, uint32_t delay, ng_task_handler_t handler, void *userdata)
+{
+    return schedule(scheduler, delay, 0, handler, userdata);
+}
+
+ng_task_t ng_scheduler_every(ng_scheduler_t *scheduler, uint32_t period, ng_task_handler_t handler, void *userdata)
+{
+    period = MAX(period, 1);
+    return schedule(scheduler, period, period, handler, userdata);
+}
+
+void ng_scheduler_cancel(ng_scheduler_t *scheduler, ng_task_t task)
+{
+    int index = task & INDEX_MASK;
+    if (task == NG_NO_TASK || !ng_pool_is_live(&scheduler->tasks, index))
+        return;
+
+    if (get_task(scheduler, index)->generation != task >> INDEX_BITS)
+        return;
+
+    unlink_task(scheduler, index);
+    release_task(scheduler, index);
+}
+
+void ng_scheduler_cancel_all(ng_scheduler_t *scheduler)
+{
+    for (int i = scheduler->tasks.live_count - 1; i >= 0; i--)
+    {
+        int index = scheduler->tasks.live[i];
+        unlink_task(scheduler, index);
+        release_task(scheduler, index);
+    }
+}
+
+// Moves every task of a higher level slot down, now that they are close enough
+static void cascade(ng_scheduler_t *scheduler, int level)
+{
+    int slot = (scheduler->time >> (level * SLOT_BITS)) & SLOT_MASK;
+    int *head = &scheduler->wheel[level][slot];
+
+    while (*head >= 0)
+    {
+        int index = *head;
+        unlink_task(scheduler, index);
+        link_task(scheduler, index);
+    }
+}
+
+static void run_tick(ng_scheduler_t *scheduler)
+{
+    scheduler->time++;
+
+    // Whenever the lower levels wrap around, the next slot of the level above
+    // comes due. The highest one goes first, its tasks may land in the others
+    int levels = 1;
+    while (levels < NG_WHEEL_LEVELS && (scheduler->time & ((1u << (levels * SLOT_BITS)) - 1)) == 0)
+        levels++;
+
+    for (int level = levels - 1; level >= 1; level--)
+        cascade(scheduler, level);
+
+    int *head = &scheduler->wheel[0][scheduler->time & SLOT_MASK];
+    while (*head >= 0)
+    {
+        int index = *head;
+        unlink_task(scheduler, index);
+
+        // Copied out, the handler might schedule more tasks and grow the pool
+        ng_scheduled_task_t *task = get_task(scheduler, index);
+        ng_task_handler_t handler = task->handler;
+        void *userdata = task->userdata;
+
+        // Rescheduled before running, so the handler can cancel it
+        if (task->period > 0)
+        {
+            task->expires += task->period;
+            link_task(scheduler, index);
+        }
+        else
+        {
+            release_task(scheduler, index);
+        }
+
+        handler(userdata);
+    }
+}
+
+void ng_scheduler_advance(ng_scheduler_t *scheduler, double ms)
+{
+    if (scheduler->is_paused)
+        return;
+
+    scheduler->pending_ms += ms * scheduler->time_scale;
+
+    // Every millisecond gets processed, so the tasks due in it run in order
+    while (scheduler->pending_ms >= 1)
+    {
+        scheduler->pending_ms -= 1;
+        run_tick(scheduler);
+    }
+}
+
+void ng_scheduler_set_paused(ng_scheduler_t *scheduler, bool is_paused)
+{
+    scheduler->is_paused = is_paused;
+}
+
+void ng_scheduler_set_time_scale(ng_scheduler_t *scheduler, float time_scale)
+{
+    scheduler->time_scale = MAX(time_scale, 0);
+}
+
+uint32_t ng_scheduler_get_time(ng_scheduler_t *scheduler)
+{
+    return scheduler->time;
+}
+
+void ng_scheduler_destroy(ng_scheduler_t *scheduler)
+{
+    ng_pool_destroy(&scheduler->tasks);
+}
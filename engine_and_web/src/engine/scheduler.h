@@ -0,0 +1,80 @@
+#ifndef _NG_SCHEDULER_H
+#define _NG_SCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pool.h"
+
+// Handles stay valid until the task is cancelled or a one-shot task has fired
+typedef uint32_t ng_task_t;
+#define NG_NO_TASK 0
+
+typedef void (*ng_task_handler_t) (void *userdata);
+
+#define NG_WHEEL_LEVELS 4
+#define NG_WHEEL_SLOTS 256
+
+typedef struct
+{
+    // When it fires next, in scheduler milliseconds
+    uint32_t expires;
+    // 0 for one-shot tasks
+    uint32_t period;
+
+    ng_task_handler_t handler;
+    void *userdata;
+
+    uint32_t generation;
+
+    // Tasks in the same slot are chained together, -1 ends the list
+    int slot;
+    int previous, next;
+} ng_scheduled_task_t;
+
+/*
+ * Runs callbacks after some time, once or repeatedly, without checking every
+ * task on every frame. Tasks are sorted into a hierarchical timer wheel: the
+ * first level has a slot per millisecond for the next 256ms, each level after
+ * that covers 256 times more with the same number of slots. Tasks only move
+ * down a level when their slot comes up, so advancing costs O(1) per millisecond
+ * no matter how many tasks there are
+ *
+ * Time only moves when ng_scheduler_advance is called (the game does it after
+ * every update), so it follows the game's clock and pauses along with it.
+ * Repeating tasks are rescheduled from when they were due, not from when they
+ * ran, so they never drift, and a long step fires them as often as they missed
+ */
+typedef struct
+{
+    // Milliseconds that have been processed
+    uint32_t time;
+    // Scaled time that hasn't added up to a whole millisecond yet
+    double pending_ms;
+
+    float time_scale;
+    bool is_paused;
+
+    int wheel[NG_WHEEL_LEVELS][NG_WHEEL_SLOTS];
+    ng_pool_t tasks;
+} ng_scheduler_t;
+
+void ng_scheduler_create(ng_scheduler_t *scheduler);
+
+// Delays are in milliseconds of scheduler time, anything below 1 is rounded up
+ng_task_t ng_scheduler_after(ng_scheduler_t *scheduler, uint32_t delay, ng_task_handler_t handler, void *userdata);
+ng_task_t ng_scheduler_every(ng_scheduler_t *scheduler, uint32_t period, ng_task_handler_t handler, void *userdata);
+// Safe to call from inside a task, also on the task itself
+void ng_scheduler_cancel(ng_scheduler_t *scheduler, ng_task_t task);
+void ng_scheduler_cancel_all(ng_scheduler_t *scheduler);
+
+// Runs every task that is due within the next `ms` milliseconds, in order
+void ng_scheduler_advance(ng_scheduler_t *scheduler, double ms);
+
+void ng_scheduler_set_paused(ng_scheduler_t *scheduler, bool is_paused);
+// 2 runs tasks twice as fast, 0.5 half as fast
+void ng_scheduler_set_time_scale(ng_scheduler_t *scheduler, float time_scale);
+uint32_t ng_scheduler_get_time(ng_scheduler_t *scheduler);
+
+void ng_scheduler_destroy(ng_scheduler_t *scheduler);
+
+#endif
@@ -0,0 +1,220 @@
+#include "spatial.h"
+#include "common.h"
+#include <stdlib.h>
+#include <math.h>
+
+#define INITIAL_ITEMS 64
+
+static void* ensure_capacity(void *buffer, int *capacity, int needed, size_t element_size)
+{
+    if (needed <= *capacity)
+        return buffer;
+
+    int new_capacity = *capacity > 0 ? *capacity * 2 : INITIAL_ITEMS;
+    while (new_capacity < needed)
+        new_capacity *= 2;
+
+    buffer = realloc(buffer, new_capacity * element_size);
+    if (!buffer)
+        ng_die("failed to grow the spatial hash to %d elements", new_capacity);
+
+    *capacity = new_capacity;
+    return buffer;
+}
+
+void ng_spatial_create(ng_spatial_hash_t *hash, float cell_size, int bucket_count)
+{
+    int buckets = 1;
+    while (buckets < bucket_count)
+        buckets *= 2;
+
+    hash->cell_size = cell_size;
+    hash->inv_cell_size = 1.0f / cell_size;
+
+    hash->buckets = malloc(buckets * sizeof(int));
+    if (!hash->buckets)
+        ng_die("failed to allocate %d spatial hash buckets", buckets);
+    hash->bucket_mask = buckets - 1;
+
+    hash->items = NULL;
+    hash->item_count = hash->item_capacity = 0;
+    hash->cells = NULL;
+    hash->cell_count = hash->cell_capacity = 0;
+    hash->stamp = 0;
+
+    ng_spatial_clear(hash);
+}
+
+void ng_spatial_clear(ng_spatial_hash_t *hash)
+{
+    for (int i = 0; i <= hash->bucket_mask; i++)
+        hash->buckets[i] = -1;
+
+    hash->item_count = 0;
+    hash->cell_count = 0;
+}
+
+static int get_cell(ng_spatial_hash_t *hash, float position)
+{
+    return (int) floorf(position * hash->inv_cell_size);
+}
+
+static int get_bucket(ng_spatial_hash_t *hash, int cell_x, int cell_y)
+{
+    // Large primes spread neighbouring cells over different buckets
+    uint32_t key = ((uint32_t) cell_x * 73856093u) ^ ((uint32_t) cell_y * 19349663u);
+    return key & hash->bucket_mask;
+}
+
+void ng_spatial_insert(ng_spatial_hash_t *hash, int id, SDL_FRect *bounds)
+{
+    hash->items = ensure_capacity(hash->items, &hash->item_capacity,
+                                  hash->item_count + 1, sizeof(ng_spatial_item_t));
+
+    int item = hash->item_count++;
+    hash->items[item] = (ng_spatial_item_t) { id, *bounds, 0 };
+
+    int min_x = get_cell(hash, bounds->x), max_x = get_cell(hash, bounds->x + bounds->w);
+    int min_y = get_cell(hash, bounds->y), max_y = get_cell(hash, bounds->y + bounds->h);
+
+    hash->cells = ensure_capacity(hash->cells, &hash->cell_capacity,
+                                  hash->cell_count + (max_x - min_x + 1) * (max_y - min_y + 1),
+                                  sizeof(ng_spatial_cell_t));
+
+    for (int y = min_y; y <= max_y; y++)
+    {
+        for (int x = min_x; x <= max_x; x++)
+        {
+            int bucket = get_bucket(hash, x, y);
+
+            ng_spatial_cell_t *cell = &hash->cells[hash->cell_count];
+            *cell = (ng_spatial_cell_t) { item, x, y, hash->buckets[bucket] };
+            hash->buckets[bucket] = hash->cell_count++;
+        }
+    }
+}
+
+void ng_spatial_insert_point(ng_spatial_hash_t *hash, int id, float x, float y)
+{
+    SDL_FRect bounds = { x, y, 0, 0 };
+    ng_spatial_insert(hash, id, &bounds);
+}
+
+static bool overlaps(SDL_FRect *a, SDL_FRect *b)
+{
+    return a->x <= b->x + b->w && b->x <= a->x + a->w &&
+           a->y <= b->y + b->h && b->y <= a->y + a->h;
+}
+
+// Squared distance from the point to the closest point of the rectangle
+static float get_squared_distance(SDL_FRect *rect, float x, float y)
+{
+    float dx = MAX(MAX(rect->x - x, 0), x - (rect->x + rect->w));
+    float dy = MAX(MAX(rect->y - y, 0), y - (rect->y + rect->h));
+
+    return dx * dx + dy * dy;
+}
+
+typedef struct
+{
+    float x, y, squared_radius;
+} circle_t;
+
+static bool is_in_circle(SDL_FRect *bounds, void *area)
+{
+    circle_t *circle = area;
+    return get_squared_distance(bounds, circle->x, circle->y) < circle->squared_radius;
+}
+
+static bool is_in_rect(SDL_FRect *bounds, void *area)
+{
+    return overlaps(bounds, area);
+}
+
+// Goes through every item in the cells the bounding box touches, each one only once
+static int query(ng_spatial_hash_t *hash, SDL_FRect *box, bool (*is_inside)(SDL_FRect*, void*),
+                 void *area, int *results, int max_results)
+{
+    int count = 0;
+    hash->stamp++;
+
+    int min_x = get_cell(hash, box->x), max_x = get_cell(hash, box->x + box->w);
+    int min_y = get_cell(hash, box->y), max_y = get_cell(hash, box->y + box->h);
+
+    for (int y = min_y; y <= max_y; y++)
+    {
+        for (int x = min_x; x <= max_x; x++)
+        {
+            for (int c = hash->buckets[get_bucket(hash, x, y)]; c >= 0; c = hash->cells[c].next)
+            {
+                ng_spatial_cell_t *cell = &hash->cells[c];
+                ng_spatial_item_t *item = &hash->items[cell->item];
+
+                // Other cells can end up in the same bucket
+                if (cell->cell_x != x || cell->cell_y != y || item->stamp == hash->stamp)
+                    continue;
+
+                item->stamp = hash->stamp;
+                if (is_inside(&item->bounds, area))
+                {
+                    results[count++] = item->id;
+                    if (count == max_results)
+                        return count;
+                }
+            }
+        }
+    }
+
+    return count;
+}
+
+int ng_spatial_query_radius(ng_spatial_hash_t *hash, float x, float y, float radius,
+                            int *results, int max_results)
+{
+    SDL_FRect box = { x - radius, y - radius, radius * 2, radius * 2 };
+    circle_t circle = { x, y, radius * radius };
+
+    return query(hash, &box, is_in_circle, &circle, results, max_results);
+}
+
+int ng_spatial_query_rect(ng_spatial_hash_t *hash, SDL_FRect *rect, int *results, int max_results)
+{
+    return query(hash, rect, is_in_rect, rect, results, max_results);
+}
+
+void ng_spatial_for_each_pair(ng_spatial_hash_t *hash, ng_pair_handler_t handler, void *userdata)
+{
+    for (int b = 0; b <= hash->bucket_mask; b++)
+    {
+        for (int first = hash->buckets[b]; first >= 0; first = hash->cells[first].next)
+        {
+            ng_spatial_cell_t *a = &hash->cells[first];
+
+            for (int second = a->next; second >= 0; second = hash->cells[second].next)
+            {
+                ng_spatial_cell_t *c = &hash->cells[second];
+                if (c->cell_x != a->cell_x || c->cell_y != a->cell_y)
+                    continue;
+
+                SDL_FRect *first_bounds = &hash->items[a->item].bounds;
+                SDL_FRect *second_bounds = &hash->items[c->item].bounds;
+                if (!overlaps(first_bounds, second_bounds))
+                    continue;
+
+                // Items sharing several cells would be reported by each of them,
+                // only the cell with the top left corner of the overlap counts
+                float x = MAX(first_bounds->x, second_bounds->x);
+                float y = MAX(first_bounds->y, second_bounds->y);
+                if (get_cell(hash, x) == a->cell_x && get_cell(hash, y) == a->cell_y)
+                    handler(hash->items[a->item].id, hash->items[c->item].id, userdata);
+            }
+        }
+    }
+}
+
+void ng_spatial_destroy(ng_spatial_hash_t *hash)
+{
+    free(hash->buckets);
+    free(hash->items);
+    free(hash->cells);
+}
@@ -0,0 +1,70 @@
+#ifndef _NG_SPATIAL_H
+#define _NG_SPATIAL_H
+
+#include <SDL2/SDL.h>
+#include <stdint.h>
+
+// Called once for every pair of overlapping items
+typedef void (*ng_pair_handler_t) (int first_id, int second_id, void *userdata);
+
+typedef struct
+{
+    int id;
+    SDL_FRect bounds;
+
+    // The last query that returned this item, so it's only returned once
+    uint32_t stamp;
+} ng_spatial_item_t;
+
+// One of the cells an item touches, chained with the other cells of the same bucket
+typedef struct
+{
+    int item;
+    int cell_x, cell_y;
+    int next;
+} ng_spatial_cell_t;
+
+/*
+ * Uniform grid for finding what is near what without checking every pair.
+ * The grid is infinite, cells are hashed into a fixed number of buckets
+ * Clear and insert everything again each tick, that's only O(n)
+ *
+ * Pick a cell size around the size of the things being queried, items bigger
+ * than a cell are inserted into every cell they touch
+ */
+typedef struct
+{
+    float cell_size, inv_cell_size;
+
+    int *buckets;
+    int bucket_mask;
+
+    ng_spatial_item_t *items;
+    int item_count, item_capacity;
+
+    ng_spatial_cell_t *cells;
+    int cell_count, cell_capacity;
+
+    uint32_t stamp;
+} ng_spatial_hash_t;
+
+// NOTE: The bucket count gets rounded up to a power of two
+void ng_spatial_create(ng_spatial_hash_t *hash, float cell_size, int bucket_count);
+void ng_spatial_clear(ng_spatial_hash_t *hash);
+
+// The id is whatever the caller wants back from queries (an index, usually)
+void ng_spatial_insert(ng_spatial_hash_t *hash, int id, SDL_FRect *bounds);
+void ng_spatial_insert_point(ng_spatial_hash_t *hash, int id, float x, float y);
+
+// Both return how many ids got written, up to max_results
+// Items are tested by their bounds, with squared distances (no square roots)
+int ng_spatial_query_radius(ng_spatial_hash_t *hash, float x, float y, float radius,
+                            int *results, int max_results);
+int ng_spatial_query_rect(ng_spatial_hash_t *hash, SDL_FRect *rect, int *results, int max_results);
+
+// Every overlapping pair is reported exactly once
+void ng_spatial_for_each_pair(ng_spatial_hash_t *hash, ng_pair_handler_t handler, void *userdata);
+
+void ng_spatial_destroy(ng_spatial_hash_t *hash);
+
+#endif
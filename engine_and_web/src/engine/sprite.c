@@ -1,16 +1,27 @@
 #include "sprite.h"
 #include "common.h"
+#include "profiler.h"
 
 void ng_sprite_create(ng_sprite_t *sprite, SDL_Texture *texture)
 {
     if (!texture)
         ng_die("failed to create sprite, an invalid texture was provided");
     
-    sprite->texture = texture;
-    sprite->src.x = sprite->src.y = 0;
+    SDL_Rect region = {0, 0, 0, 0};
 
     // Fetching the texture's dimensions and saving them in the sprite's source rect 
-    SDL_QueryTexture(texture, NULL, NULL, &sprite->src.w, &sprite->src.h);
+    SDL_QueryTexture(texture, NULL, NULL, &region.w, &region.h);
+
+    ng_sprite_create_from_region(sprite, texture, &region);
+}
+
+void ng_sprite_create_from_region(ng_sprite_t *sprite, SDL_Texture *texture, SDL_Rect *region)
+{
+    if (!texture)
+        ng_die("failed to create sprite, an invalid texture was provided");
+
+    sprite->texture = texture;
+    sprite->src = *region;
 
     sprite->transform.x = sprite->transform.y = 0;
     ng_sprite_set_scale(sprite, 1.0f);
@@ -27,14 +38,24 @@ void ng_sprite_set_scale(ng_sprite_t *sprite, float scale)
 void ng_sprite_render(ng_sprite_t *sprite, SDL_Renderer *renderer)
 {
     SDL_RenderCopyF(renderer, sprite->texture, &sprite->src, &sprite->transform);
+    NG_PROFILE_COUNT_DRAW_CALL();
 }
 
 void ng_animated_create(ng_animated_sprite_t *anim, SDL_Texture *texture,
                         unsigned int total_frames)
 {
-    ng_sprite_create(&anim->sprite, texture);
+    SDL_Rect region = {0, 0, 0, 0};
+    SDL_QueryTexture(texture, NULL, NULL, &region.w, &region.h);
+
+    ng_animated_create_from_region(anim, texture, &region, total_frames);
+}
+
+void ng_animated_create_from_region(ng_animated_sprite_t *anim, SDL_Texture *texture,
+                                    SDL_Rect *region, unsigned int total_frames)
+{
+    ng_sprite_create_from_region(&anim->sprite, texture, region);
 
-    anim->total_frames = total_frames = total_frames;
+    anim->total_frames = total_frames;
     anim->frame = 0;
 
     // Adjust source size, we are only interested in a single frame
@@ -44,6 +65,8 @@ void ng_animated_create(ng_animated_sprite_t *anim, SDL_Texture *texture,
 
 void ng_animated_set_frame(ng_animated_sprite_t *anim, int frame_index)
 {
+    // Moving relative to the current frame, since the first frame
+    // doesn't have to sit at x = 0 (e.g. when packed inside an atlas)
+    anim->sprite.src.x += (frame_index - anim->frame) * anim->sprite.src.w;
     anim->frame = frame_index;
-    anim->sprite.src.x = frame_index * anim->sprite.src.w;
 }
@@ -18,6 +18,8 @@ typedef struct
 } ng_sprite_t;
 
 void ng_sprite_create(ng_sprite_t *sprite, SDL_Texture *texture);
+// Same as above, but only a part of the texture is used (e.g. an atlas entry)
+void ng_sprite_create_from_region(ng_sprite_t *sprite, SDL_Texture *texture, SDL_Rect *region);
 void ng_sprite_render(ng_sprite_t *sprite, SDL_Renderer *renderer);
 void ng_sprite_set_scale(ng_sprite_t *sprite, float scale);
 
@@ -35,6 +37,9 @@ typedef struct
 // Some sprites will have a texture consisting of multiple frames inside a larger texture atlas
 void ng_animated_create(ng_animated_sprite_t *anim, SDL_Texture *texture,
                         unsigned int total_frames);
+// The frames are laid out horizontally inside the region, same as above
+void ng_animated_create_from_region(ng_animated_sprite_t *anim, SDL_Texture *texture,
+                                    SDL_Rect *region, unsigned int total_frames);
 
 void ng_animated_set_frame(ng_animated_sprite_t *anim, int frame_index);
 
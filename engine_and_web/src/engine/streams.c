@@ -0,0 +1,512 @@
+#include "streams.h"
+#include "common.h"
+#include <math.h>
+
+#ifdef HAS_X86
+#include <immintrin.h>
+#endif
+
+#ifdef __wasm_simd128__
+#include <wasm_simd128.h>
+#endif
+
+typedef struct
+{
+    const char *name;
+
+    void (*add)(float*, float*, const float*, const float*, int);
+    void (*scale)(float*, float*, float, int);
+    void (*multiply_add)(float*, float*, const float*, const float*, float, int);
+    void (*normalize)(float*, float*, int);
+    void (*squared_distance)(float*, const float*, const float*, float, float, int);
+    int (*are_inside)(bool*, const float*, const float*, SDL_FRect*, int);
+} implementation_t;
+
+// Scalar versions, these also finish whatever doesn't fill a whole register
+
+static void add_scalar(float *x, float *y, const float *other_x, const float *other_y, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        x[i] += other_x[i];
+        y[i] += other_y[i];
+    }
+}
+
+static void scale_scalar(float *x, float *y, float scalar, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        x[i] *= scalar;
+        y[i] *= scalar;
+    }
+}
+
+static void multiply_add_scalar(float *x, float *y, const float *other_x, const float *other_y,
+                                float scalar, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        x[i] += other_x[i] * scalar;
+        y[i] += other_y[i] * scalar;
+    }
+}
+
+static void normalize_scalar(float *x, float *y, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        float squared = x[i] * x[i] + y[i] * y[i];
+        float magnitude = sqrtf(squared);
+
+        x[i] = squared > 0 ? x[i] / magnitude : 0;
+        y[i] = squared > 0 ? y[i] / magnitude : 0;
+    }
+}
+
+static void squared_distance_scalar(float *result, const float *x, const float *y,
+                                    float to_x, float to_y, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        float dx = x[i] - to_x, dy = y[i] - to_y;
+        result[i] = dx * dx + dy * dy;
+    }
+}
+
+static int are_inside_scalar(bool *result, const float *x, const float *y, SDL_FRect *rect, int count)
+{
+    float right = rect->x + rect->w, bottom = rect->y + rect->h;
+    int inside = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        result[i] = x[i] > rect->x && x[i] < right && y[i] > rect->y && y[i] < bottom;
+        inside += result[i];
+    }
+
+    return inside;
+}
+
+static implementation_t scalar_version = {
+    "scalar", add_scalar, scale_scalar, multiply_add_scalar,
+    normalize_scalar, squared_distance_scalar, are_inside_scalar
+};
+
+#if defined(HAS_X86) || defined(__wasm_simd128__)
+
+// Spreads the comparison bits of a register over the result array
+static int write_mask(bool *result, int bits, int width)
+{
+    int inside = 0;
+    for (int k = 0; k < width; k++)
+    {
+        result[k] = bits >> k & 1;
+        inside += result[k];
+    }
+
+    return inside;
+}
+
+#endif
+
+#ifdef HAS_X86
+
+// SSE2, 4 floats at a time
+
+TARGET("sse2")
+static void add_sse2(float *x, float *y, const float *other_x, const float *other_y, int count)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_ps(x + i, _mm_add_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(other_x + i)));
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_loadu_ps(other_y + i)));
+    }
+
+    add_scalar(x + i, y + i, other_x + i, other_y + i, count - i);
+}
+
+TARGET("sse2")
+static void scale_sse2(float *x, float *y, float scalar, int count)
+{
+    __m128 s = _mm_set1_ps(scalar);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm_storeu_ps(x + i, _mm_mul_ps(_mm_loadu_ps(x + i), s));
+        _mm_storeu_ps(y + i, _mm_mul_ps(_mm_loadu_ps(y + i), s));
+    }
+
+    scale_scalar(x + i, y + i, scalar, count - i);
+}
+
+TARGET("sse2")
+static void multiply_add_sse2(float *x, float *y, const float *other_x, const float *other_y,
+                              float scalar, int count)
+{
+    __m128 s = _mm_set1_ps(scalar);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 dx = _mm_mul_ps(_mm_loadu_ps(other_x + i), s);
+        __m128 dy = _mm_mul_ps(_mm_loadu_ps(other_y + i), s);
+        _mm_storeu_ps(x + i, _mm_add_ps(_mm_loadu_ps(x + i), dx));
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), dy));
+    }
+
+    multiply_add_scalar(x + i, y + i, other_x + i, other_y + i, scalar, count - i);
+}
+
+TARGET("sse2")
+static void normalize_sse2(float *x, float *y, int count)
+{
+    __m128 zero = _mm_setzero_ps();
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 vx = _mm_loadu_ps(x + i), vy = _mm_loadu_ps(y + i);
+        __m128 squared = _mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy));
+        __m128 magnitude = _mm_sqrt_ps(squared);
+
+        // Dividing zero vectors gives NaNs, the mask turns them back into zeros
+        __m128 is_valid = _mm_cmpgt_ps(squared, zero);
+        _mm_storeu_ps(x + i, _mm_and_ps(is_valid, _mm_div_ps(vx, magnitude)));
+        _mm_storeu_ps(y + i, _mm_and_ps(is_valid, _mm_div_ps(vy, magnitude)));
+    }
+
+    normalize_scalar(x + i, y + i, count - i);
+}
+
+TARGET("sse2")
+static void squared_distance_sse2(float *result, const float *x, const float *y,
+                                  float to_x, float to_y, int count)
+{
+    __m128 tx = _mm_set1_ps(to_x), ty = _mm_set1_ps(to_y);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(x + i), tx);
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(y + i), ty);
+        _mm_storeu_ps(result + i, _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+    }
+
+    squared_distance_scalar(result + i, x + i, y + i, to_x, to_y, count - i);
+}
+
+TARGET("sse2")
+static int are_inside_sse2(bool *result, const float *x, const float *y, SDL_FRect *rect, int count)
+{
+    __m128 left = _mm_set1_ps(rect->x), right = _mm_set1_ps(rect->x + rect->w);
+    __m128 top = _mm_set1_ps(rect->y), bottom = _mm_set1_ps(rect->y + rect->h);
+    int inside = 0;
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 vx = _mm_loadu_ps(x + i), vy = _mm_loadu_ps(y + i);
+        __m128 is_inside = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(vx, left), _mm_cmplt_ps(vx, right)),
+                                      _mm_and_ps(_mm_cmpgt_ps(vy, top), _mm_cmplt_ps(vy, bottom)));
+
+        inside += write_mask(result + i, _mm_movemask_ps(is_inside), 4);
+    }
+
+    return inside + are_inside_scalar(result + i, x + i, y + i, rect, count - i);
+}
+
+static implementation_t sse2_version = {
+    "SSE2", add_sse2, scale_sse2, multiply_add_sse2,
+    normalize_sse2, squared_distance_sse2, are_inside_sse2
+};
+
+// AVX2, 8 floats at a time
+// NOTE: No FMA on purpose, fused multiply-adds round differently than the other versions
+
+TARGET("avx2")
+static void add_avx2(float *x, float *y, const float *other_x, const float *other_y, int count)
+{
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        _mm256_storeu_ps(x + i, _mm256_add_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(other_x + i)));
+        _mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_loadu_ps(other_y + i)));
+    }
+
+    add_sse2(x + i, y + i, other_x + i, other_y + i, count - i);
+}
+
+TARGET("avx2")
+static void scale_avx2(float *x, float *y, float scalar, int count)
+{
+    __m256 s = _mm256_set1_ps(scalar);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        _mm256_storeu_ps(x + i, _mm256_mul_ps(_mm256_loadu_ps(x + i), s));
+        _mm256_storeu_ps(y + i, _mm256_mul_ps(_mm256_loadu_ps(y + i), s));
+    }
+
+    scale_sse2(x + i, y + i, scalar, count - i);
+}
+
+TARGET("avx2")
+static void multiply_add_avx2(float *x, float *y, const float *other_x, const float *other_y,
+                              float scalar, int count)
+{
+    __m256 s = _mm256_set1_ps(scalar);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 dx = _mm256_mul_ps(_mm256_loadu_ps(other_x + i), s);
+        __m256 dy = _mm256_mul_ps(_mm256_loadu_ps(other_y + i), s);
+        _mm256_storeu_ps(x + i, _mm256_add_ps(_mm256_loadu_ps(x + i), dx));
+        _mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), dy));
+    }
+
+    multiply_add_sse2(x + i, y + i, other_x + i, other_y + i, scalar, count - i);
+}
+
+TARGET("avx2")
+static void normalize_avx2(float *x, float *y, int count)
+{
+    __m256 zero = _mm256_setzero_ps();
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i);
+        __m256 squared = _mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy));
+        __m256 magnitude = _mm256_sqrt_ps(squared);
+
+        __m256 is_valid = _mm256_cmp_ps(squared, zero, _CMP_GT_OQ);
+        _mm256_storeu_ps(x + i, _mm256_and_ps(is_valid, _mm256_div_ps(vx, magnitude)));
+        _mm256_storeu_ps(y + i, _mm256_and_ps(is_valid, _mm256_div_ps(vy, magnitude)));
+    }
+
+    normalize_sse2(x + i, y + i, count - i);
+}
+
+TARGET("avx2")
+static void squared_distance_avx2(float *result, const float *x, const float *y,
+                                  float to_x, float to_y, int count)
+{
+    __m256 tx = _mm256_set1_ps(to_x), ty = _mm256_set1_ps(to_y);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + i), tx);
+        __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + i), ty);
+        _mm256_storeu_ps(result + i, _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+    }
+
+    squared_distance_sse2(result + i, x + i, y + i, to_x, to_y, count - i);
+}
+
+TARGET("avx2")
+static int are_inside_avx2(bool *result, const float *x, const float *y, SDL_FRect *rect, int count)
+{
+    __m256 left = _mm256_set1_ps(rect->x), right = _mm256_set1_ps(rect->x + rect->w);
+    __m256 top = _mm256_set1_ps(rect->y), bottom = _mm256_set1_ps(rect->y + rect->h);
+    int inside = 0;
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i);
+        __m256 is_inside = _mm256_and_ps(
+            _mm256_and_ps(_mm256_cmp_ps(vx, left, _CMP_GT_OQ), _mm256_cmp_ps(vx, right, _CMP_LT_OQ)),
+            _mm256_and_ps(_mm256_cmp_ps(vy, top, _CMP_GT_OQ), _mm256_cmp_ps(vy, bottom, _CMP_LT_OQ)));
+
+        inside += write_mask(result + i, _mm256_movemask_ps(is_inside), 8);
+    }
+
+    return inside + are_inside_sse2(result + i, x + i, y + i, rect, count - i);
+}
+
+static implementation_t avx2_version = {
+    "AVX2", add_avx2, scale_avx2, multiply_add_avx2,
+    normalize_avx2, squared_distance_avx2, are_inside_avx2
+};
+
+#endif
+
+#ifdef __wasm_simd128__
+
+// SIMD128, 4 floats at a time. There's no runtime detection on the web,
+// build_web.sh compiles with -msimd128 and every browser gets this version
+
+static void add_simd128(float *x, float *y, const float *other_x, const float *other_y, int count)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        wasm_v128_store(x + i, wasm_f32x4_add(wasm_v128_load(x + i), wasm_v128_load(other_x + i)));
+        wasm_v128_store(y + i, wasm_f32x4_add(wasm_v128_load(y + i), wasm_v128_load(other_y + i)));
+    }
+
+    add_scalar(x + i, y + i, other_x + i, other_y + i, count - i);
+}
+
+static void scale_simd128(float *x, float *y, float scalar, int count)
+{
+    v128_t s = wasm_f32x4_splat(scalar);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        wasm_v128_store(x + i, wasm_f32x4_mul(wasm_v128_load(x + i), s));
+        wasm_v128_store(y + i, wasm_f32x4_mul(wasm_v128_load(y + i), s));
+    }
+
+    scale_scalar(x + i, y + i, scalar, count - i);
+}
+
+static void multiply_add_simd128(float *x, float *y, const float *other_x, const float *other_y,
+                                 float scalar, int count)
+{
+    v128_t s = wasm_f32x4_splat(scalar);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        v128_t dx = wasm_f32x4_mul(wasm_v128_load(other_x + i), s);
+        v128_t dy = wasm_f32x4_mul(wasm_v128_load(other_y + i), s);
+        wasm_v128_store(x + i, wasm_f32x4_add(wasm_v128_load(x + i), dx));
+        wasm_v128_store(y + i, wasm_f32x4_add(wasm_v128_load(y + i), dy));
+    }
+
+    multiply_add_scalar(x + i, y + i, other_x + i, other_y + i, scalar, count - i);
+}
+
+static void normalize_simd128(float *x, float *y, int count)
+{
+    v128_t zero = wasm_f32x4_splat(0);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        v128_t vx = wasm_v128_load(x + i), vy = wasm_v128_load(y + i);
+        v128_t squared = wasm_f32x4_add(wasm_f32x4_mul(vx, vx), wasm_f32x4_mul(vy, vy));
+        v128_t magnitude = wasm_f32x4_sqrt(squared);
+
+        v128_t is_valid = wasm_f32x4_gt(squared, zero);
+        wasm_v128_store(x + i, wasm_v128_and(is_valid, wasm_f32x4_div(vx, magnitude)));
+        wasm_v128_store(y + i, wasm_v128_and(is_valid, wasm_f32x4_div(vy, magnitude)));
+    }
+
+    normalize_scalar(x + i, y + i, count - i);
+}
+
+static void squared_distance_simd128(float *result, const float *x, const float *y,
+                                     float to_x, float to_y, int count)
+{
+    v128_t tx = wasm_f32x4_splat(to_x), ty = wasm_f32x4_splat(to_y);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        v128_t dx = wasm_f32x4_sub(wasm_v128_load(x + i), tx);
+        v128_t dy = wasm_f32x4_sub(wasm_v128_load(y + i), ty);
+        wasm_v128_store(result + i, wasm_f32x4_add(wasm_f32x4_mul(dx, dx), wasm_f32x4_mul(dy, dy)));
+    }
+
+    squared_distance_scalar(result + i, x + i, y + i, to_x, to_y, count - i);
+}
+
+static int are_inside_simd128(bool *result, const float *x, const float *y, SDL_FRect *rect, int count)
+{
+    v128_t left = wasm_f32x4_splat(rect->x), right = wasm_f32x4_splat(rect->x + rect->w);
+    v128_t top = wasm_f32x4_splat(rect->y), bottom = wasm_f32x4_splat(rect->y + rect->h);
+    int inside = 0;
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        v128_t vx = wasm_v128_load(x + i), vy = wasm_v128_load(y + i);
+        v128_t is_inside = wasm_v128_and(wasm_v128_and(wasm_f32x4_gt(vx, left), wasm_f32x4_lt(vx, right)),
+                                         wasm_v128_and(wasm_f32x4_gt(vy, top), wasm_f32x4_lt(vy, bottom)));
+
+        inside += write_mask(result + i, wasm_i32x4_bitmask(is_inside), 4);
+    }
+
+    return inside + are_inside_scalar(result + i, x + i, y + i, rect, count - i);
+}
+
+static implementation_t simd128_version = {
+    "SIMD128", add_simd128, scale_simd128, multiply_add_simd128,
+    normalize_simd128, squared_distance_simd128, are_inside_simd128
+};
+
+#endif
+
+// Whatever runs before ng_streams_init gets the scalar versions
+static implementation_t *active = &scalar_version;
+
+// The fastest version this machine supports
+static implementation_t* get_implementation(void)
+{
+    switch (ng_get_instruction_set())
+    {
+#ifdef HAS_X86
+    case NG_AVX2:
+        return &avx2_version;
+    case NG_SSE2:
+        return &sse2_version;
+#endif
+#ifdef __wasm_simd128__
+    case NG_SIMD128:
+        return &simd128_version;
+#endif
+    default:
+        return &scalar_version;
+    }
+}
+
+void ng_streams_init(void)
+{
+    active = get_implementation();
+}
+
+void ng_streams_add(float *x, float *y, const float *other_x, const float *other_y, int count)
+{
+    active->add(x, y, other_x, other_y, count);
+}
+
+void ng_streams_scale(float *x, float *y, float scalar, int count)
+{
+    active->scale(x, y, scalar, count);
+}
+
+void ng_streams_multiply_add(float *x, float *y, const float *other_x, const float *other_y,
+                             float scalar, int count)
+{
+    active->multiply_add(x, y, other_x, other_y, scalar, count);
+}
+
+void ng_streams_normalize(float *x, float *y, int count)
+{
+    active->normalize(x, y, count);
+}
+
+void ng_streams_squared_distance(float *result, const float *x, const float *y,
+                                 float to_x, float to_y, int count)
+{
+    active->squared_distance(result, x, y, to_x, to_y, count);
+}
+
+int ng_streams_are_inside(bool *result, const float *x, const float *y, SDL_FRect *rect, int count)
+{
+    return active->are_inside(result, x, y, rect, count);
+}
+
+const char* ng_streams_get_instruction_set(void)
+{
+    return active->name;
+}
@@ -0,0 +1,40 @@
+#ifndef _NG_STREAMS_H
+#define _NG_STREAMS_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+/*
+ * The ng_vec2 functions, but for whole arrays of vectors at once. The x and y
+ * components live in separate arrays (like the columns of ng_world_t), which
+ * lets SSE2/AVX2 (or SIMD128 on the web) go through 4-8 vectors per instruction
+ *
+ * The fastest instruction set the CPU supports gets picked once, by
+ * ng_streams_init, before any job worker could call these. Every version does
+ * the exact same float operations in the same order, so the results don't
+ * depend on the machine (replays stay in sync)
+ */
+
+// Called by ng_game_create, the scalar versions run until then
+void ng_streams_init(void);
+
+// x += other_x, y += other_y
+void ng_streams_add(float *x, float *y, const float *other_x, const float *other_y, int count);
+// x *= scalar, y *= scalar
+void ng_streams_scale(float *x, float *y, float scalar, int count);
+// x += other_x * scalar, y += other_y * scalar (moving positions by velocity * delta)
+void ng_streams_multiply_add(float *x, float *y, const float *other_x, const float *other_y,
+                             float scalar, int count);
+// NOTE: Zero vectors stay zero, unlike ng_vector_normalize
+void ng_streams_normalize(float *x, float *y, int count);
+
+// Squared distance of every point from (to_x, to_y), written into result
+void ng_streams_squared_distance(float *result, const float *x, const float *y,
+                                 float to_x, float to_y, int count);
+// Same rules as ng_is_point_inside, returns how many points are inside
+int ng_streams_are_inside(bool *result, const float *x, const float *y, SDL_FRect *rect, int count);
+
+// "AVX2", "SSE2", "SIMD128" or "scalar"
+const char* ng_streams_get_instruction_set(void);
+
+#endif
@@ -0,0 +1,413 @@
+#include "timeline.h"
+#include "common.h"
+#include "audio.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *key_names[] = {
+    "x", "y", "scale", "frame", "texture", "text", "show", "hide", "play", "pause", "resume", "call"
+};
+
+void ng_timeline_create(ng_timeline_t *timeline, SDL_Renderer *renderer, ng_assets_t *assets)
+{
+    memset(timeline, 0, sizeof(ng_timeline_t));
+    timeline->renderer = renderer;
+    timeline->assets = assets;
+}
+
+static ng_timeline_target_t* bind(ng_timeline_t *timeline, const char *name, ng_target_type_t type, void *data)
+{
+    if (timeline->target_count == NG_TIMELINE_TARGETS)
+        ng_die("too many timeline targets, the limit is %d", NG_TIMELINE_TARGETS);
+
+    ng_timeline_target_t *target = &timeline->targets[timeline->target_count++];
+    snprintf(target->name, sizeof(target->name), "%s", name);
+    target->type = type;
+    target->data = data;
+    target->world = NULL;
+    target->entity = NG_NO_ENTITY;
+    target->is_visible = false;
+
+    return target;
+}
+
+void ng_timeline_bind_sprite(ng_timeline_t *timeline, const char *name, ng_sprite_t *sprite)
+{
+    bind(timeline, name, NG_TARGET_SPRITE, sprite);
+}
+
+void ng_timeline_bind_animated(ng_timeline_t *timeline, const char *name, ng_animated_sprite_t *anim)
+{
+    bind(timeline, name, NG_TARGET_ANIMATED, anim);
+}
+
+void ng_timeline_bind_label(ng_timeline_t *timeline, const char *name, ng_label_t *label)
+{
+    bind(timeline, name, NG_TARGET_LABEL, label);
+}
+
+void ng_timeline_bind_entity(ng_timeline_t *timeline, const char *name, ng_world_t *world, ng_entity_t entity)
+{
+    ng_timeline_target_t *target = bind(timeline, name, NG_TARGET_ENTITY, NULL);
+    target->world = world;
+    target->entity = entity;
+}
+
+void ng_timeline_bind_music(ng_timeline_t *timeline, const char *name, Mix_Music *music)
+{
+    bind(timeline, name, NG_TARGET_MUSIC, music);
+}
+
+void ng_timeline_bind_sound(ng_timeline_t *timeline, const char *name, Mix_Chunk *sound)
+{
+    bind(timeline, name, NG_TARGET_SOUND, sound);
+}
+
+static int find_target(ng_timeline_t *timeline, const char *name)
+{
+    for (int i = 0; i < timeline->target_count; i++)
+    {
+        if (strcmp(timeline->targets[i].name, name) == 0)
+            return i;
+    }
+
+    return -1;
+}
+
+static ng_key_type_t parse_key_type(const char *name, const char *path, int line)
+{
+    for (size_t i = 0; i < SDL_arraysize(key_names); i++)
+    {
+        if (strcmp(key_names[i], name) == 0)
+            return i;
+    }
+
+    ng_die("%s:%d: unknown property '%s'", path, line, name);
+    return NG_KEY_CALL;
+}
+
+// Makes sure the target can actually do what the key asks for
+static bool is_supported(ng_target_type_t target, ng_key_type_t key)
+{
+    switch (key)
+    {
+    case NG_KEY_X:
+    case NG_KEY_Y:
+    case NG_KEY_SCALE:
+    case NG_KEY_SHOW:
+    case NG_KEY_HIDE:
+        return target == NG_TARGET_SPRITE || target == NG_TARGET_ANIMATED ||
+               target == NG_TARGET_LABEL || target == NG_TARGET_ENTITY;
+    case NG_KEY_FRAME:
+        return target == NG_TARGET_ANIMATED || target == NG_TARGET_ENTITY;
+    case NG_KEY_TEXTURE:
+        return target == NG_TARGET_SPRITE;
+    case NG_KEY_TEXT:
+        return target == NG_TARGET_LABEL;
+    case NG_KEY_PLAY:
+        return target == NG_TARGET_MUSIC || target == NG_TARGET_SOUND;
+    case NG_KEY_PAUSE:
+    case NG_KEY_RESUME:
+        return target == NG_TARGET_MUSIC;
+    default:
+        return false;
+    }
+}
+
+static void parse_key(ng_timeline_t *timeline, ng_keyframe_t *key, const char *path, int line,
+                      const char *target, const char *rest)
+{
+    key->text = NULL;
+    key->value = 0;
+    key->is_linear = false;
+    key->next_linear = -1;
+
+    if (strcmp(target, "call") == 0)
+    {
+        key->type = NG_KEY_CALL;
+        key->target = -1;
+        key->text = strdup(rest);
+        return;
+    }
+
+    key->target = find_target(timeline, target);
+    if (key->target < 0)
+        ng_die("%s:%d: nothing is bound to '%s'", path, line, target);
+
+    char property[16], argument[128] = "";
+    if (sscanf(rest, "%15s %127[^\r\n]", property, argument) < 1)
+        ng_die("%s:%d: missing property", path, line);
+
+    key->type = parse_key_type(property, path, line);
+    if (!is_supported(timeline->targets[key->target].type, key->type))
+        ng_die("%s:%d: '%s' doesn't support %s", path, line, target, property);
+
+    char extra[128] = "";
+    switch (key->type)
+    {
+    case NG_KEY_X:
+    case NG_KEY_Y:
+    case NG_KEY_SCALE:
+        if (sscanf(argument, "%f %127s", &key->value, extra) < 1)
+            ng_die("%s:%d: %s needs a value", path, line, property);
+
+        key->is_linear = strcmp(extra, "linear") == 0;
+        if (extra[0] && !key->is_linear)
+            ng_die("%s:%d: unknown interpolation '%s'", path, line, extra);
+        break;
+    case NG_KEY_FRAME:
+        if (sscanf(argument, "%f", &key->value) != 1)
+            ng_die("%s:%d: frame needs an index", path, line);
+        break;
+    case NG_KEY_TEXTURE:
+        if (sscanf(argument, "%127s %f", extra, &key->value) != 2)
+            ng_die("%s:%d: texture needs a path and a scale", path, line);
+
+        key->text = strdup(extra);
+        break;
+    case NG_KEY_TEXT:
+        key->text = strdup(argument);
+        break;
+    default:
+        break;
+    }
+}
+
+// Links every numeric key to the next key of its track, if that one slides over from it
+static void link_tweens(ng_timeline_t *timeline)
+{
+    int following[NG_TIMELINE_TARGETS][NG_NUMERIC_KEYS];
+    for (int i = 0; i < NG_TIMELINE_TARGETS; i++)
+    {
+        for (int j = 0; j < NG_NUMERIC_KEYS; j++)
+            following[i][j] = -1;
+    }
+
+    for (int i = timeline->key_count - 1; i >= 0; i--)
+    {
+        ng_keyframe_t *key = &timeline->keys[i];
+        if (key->type >= NG_NUMERIC_KEYS)
+            continue;
+
+        int next = following[key->target][key->type];
+        key->next_linear = next >= 0 && timeline->keys[next].is_linear ? next : -1;
+        following[key->target][key->type] = i;
+    }
+}
+
+void ng_timeline_load(ng_timeline_t *timeline, const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+        ng_die("failed to open timeline %s", path);
+
+    int capacity = 0;
+    char buffer[256];
+    for (int line = 1; fgets(buffer, sizeof(buffer), file); line++)
+    {
+        char target[32], rest[192] = "";
+        unsigned int time;
+
+        // Comments and empty lines
+        if (sscanf(buffer, " %u %31s %191[^\r\n]", &time, target, rest) < 2)
+            continue;
+
+        if (timeline->key_count == capacity)
+        {
+            capacity = capacity > 0 ? capacity * 2 : 64;
+            timeline->keys = realloc(timeline->keys, capacity * sizeof(ng_keyframe_t));
+            if (!timeline->keys)
+                ng_die("failed to allocate %d timeline keys", capacity);
+        }
+
+        ng_keyframe_t *key = &timeline->keys[timeline->key_count++];
+        key->time = time;
+        parse_key(timeline, key, path, line, target, rest);
+
+        if (timeline->key_count > 1 && time < timeline->keys[timeline->key_count - 2].time)
+            ng_die("%s:%d: keys have to be sorted by time", path, line);
+    }
+
+    fclose(file);
+    link_tweens(timeline);
+}
+
+void ng_timeline_set_command_handler(ng_timeline_t *timeline, ng_command_handler_t handler)
+{
+    timeline->handle_command = handler;
+}
+
+void ng_timeline_start(ng_timeline_t *timeline)
+{
+    timeline->time = 0;
+    timeline->cursor = 0;
+    timeline->tween_count = 0;
+
+    for (int i = 0; i < timeline->target_count; i++)
+        timeline->targets[i].is_visible = false;
+}
+
+static ng_sprite_t* get_sprite(ng_timeline_target_t *target)
+{
+    switch (target->type)
+    {
+    case NG_TARGET_SPRITE:
+        return target->data;
+    case NG_TARGET_ANIMATED:
+        return &((ng_animated_sprite_t*) target->data)->sprite;
+    case NG_TARGET_LABEL:
+        return &((ng_label_t*) target->data)->sprite;
+    default:
+        return NULL;
+    }
+}
+
+static void set_value(ng_timeline_target_t *target, ng_key_type_t type, float value)
+{
+    if (target->type == NG_TARGET_ENTITY)
+    {
+        ng_world_t *world = target->world;
+        int i = ng_world_index_of(world, target->entity);
+        if (i < 0)
+            return;
+
+        if (type == NG_KEY_X)
+            world->x[i] = value;
+        else if (type == NG_KEY_Y)
+            world->y[i] = value;
+        else
+        {
+            world->w[i] = world->src[i].w * value;
+            world->h[i] = world->src[i].h * value;
+        }
+        return;
+    }
+
+    ng_sprite_t *sprite = get_sprite(target);
+    if (type == NG_KEY_X)
+        sprite->transform.x = value;
+    else if (type == NG_KEY_Y)
+        sprite->transform.y = value;
+    else
+        ng_sprite_set_scale(sprite, value);
+}
+
+// The key that was slid towards has been reached, the value is in its exact place now
+static void end_tween(ng_timeline_t *timeline, int to)
+{
+    for (int i = 0; i < timeline->tween_count; i++)
+    {
+        if (timeline->tweens[i].to == to)
+        {
+            timeline->tweens[i] = timeline->tweens[--timeline->tween_count];
+            return;
+        }
+    }
+}
+
+static void apply_key(ng_timeline_t *timeline, int index)
+{
+    ng_keyframe_t *key = &timeline->keys[index];
+    if (key->type == NG_KEY_CALL)
+    {
+        if (timeline->handle_command)
+            timeline->handle_command(key->text);
+        return;
+    }
+
+    ng_timeline_target_t *target = &timeline->targets[key->target];
+    switch (key->type)
+    {
+    case NG_KEY_X:
+    case NG_KEY_Y:
+    case NG_KEY_SCALE:
+        set_value(target, key->type, key->value);
+        end_tween(timeline, index);
+
+        // The track slides towards its next key from now on
+        if (key->next_linear >= 0)
+            timeline->tweens[timeline->tween_count++] = (ng_tween_t) { index, key->next_linear };
+        break;
+    case NG_KEY_FRAME:
+        if (target->type == NG_TARGET_ANIMATED)
+            ng_animated_set_frame(target->data, (int) key->value);
+        else if (ng_world_is_alive(target->world, target->entity))
+            ng_world_set_frame(target->world, ng_world_index_of(target->world, target->entity), (int) key->value);
+        break;
+    case NG_KEY_TEXTURE:
+        // Same as swapping any other texture, the asset manager keeps count
+        ng_assets_release(timeline->assets, get_sprite(target)->texture);
+        ng_sprite_create(target->data, ng_assets_get_texture(timeline->assets, key->text));
+        ng_sprite_set_scale(target->data, key->value);
+        break;
+    case NG_KEY_TEXT:
+        ng_label_set_content(target->data, timeline->renderer, key->text);
+        break;
+    case NG_KEY_SHOW:
+    case NG_KEY_HIDE:
+        target->is_visible = key->type == NG_KEY_SHOW;
+        break;
+    case NG_KEY_PLAY:
+        if (target->type == NG_TARGET_MUSIC)
+            ng_audio_play_music(target->data, 1);
+        else
+            ng_audio_play(target->data);
+        break;
+    case NG_KEY_PAUSE:
+        ng_audio_pause_music();
+        break;
+    case NG_KEY_RESUME:
+        ng_audio_resume_music();
+        break;
+    default:
+        break;
+    }
+}
+
+void ng_timeline_advance(ng_timeline_t *timeline, double ms)
+{
+    timeline->time += ms;
+
+    while (timeline->cursor < timeline->key_count && timeline->keys[timeline->cursor].time <= timeline->time)
+        apply_key(timeline, timeline->cursor++);
+
+    for (int i = 0; i < timeline->tween_count; i++)
+    {
+        ng_keyframe_t *from = &timeline->keys[timeline->tweens[i].from];
+        ng_keyframe_t *to = &timeline->keys[timeline->tweens[i].to];
+
+        float progress = (timeline->time - from->time) / (to->time - from->time);
+        set_value(&timeline->targets[to->target], to->type, from->value + (to->value - from->value) * progress);
+    }
+}
+
+bool ng_timeline_is_finished(ng_timeline_t *timeline)
+{
+    return timeline->cursor == timeline->key_count && timeline->tween_count == 0;
+}
+
+void ng_timeline_render(ng_timeline_t *timeline, ng_render_batch_t *batch)
+{
+    for (int i = 0; i < timeline->target_count; i++)
+    {
+        ng_timeline_target_t *target = &timeline->targets[i];
+        if (!target->is_visible)
+            continue;
+
+        if (target->type == NG_TARGET_LABEL)
+            ng_label_render(target->data, batch);
+        else if (target->type == NG_TARGET_ENTITY)
+            ng_world_render_entity(target->world, batch, target->entity);
+        else
+            ng_render_batch_add(batch, get_sprite(target));
+    }
+}
+
+void ng_timeline_destroy(ng_timeline_t *timeline)
+{
+    for (int i = 0; i < timeline->key_count; i++)
+        free(timeline->keys[i].text);
+
+    free(timeline->keys);
+}
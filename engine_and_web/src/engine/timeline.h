@@ -0,0 +1,149 @@
+#ifndef _NG_TIMELINE_H
+#define _NG_TIMELINE_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "sprite.h"
+#include "interface.h"
+#include "assets.h"
+#include "ecs.h"
+#include "input.h"
+
+#define NG_TIMELINE_TARGETS 16
+
+typedef enum
+{
+    NG_TARGET_SPRITE,
+    NG_TARGET_ANIMATED,
+    NG_TARGET_LABEL,
+    NG_TARGET_ENTITY,
+    NG_TARGET_MUSIC,
+    NG_TARGET_SOUND
+} ng_target_type_t;
+
+// Something the keys of a timeline refer to by name
+typedef struct
+{
+    char name[32];
+    ng_target_type_t type;
+
+    // ng_sprite_t, ng_animated_sprite_t, ng_label_t, Mix_Music or Mix_Chunk
+    void *data;
+    ng_world_t *world;
+    ng_entity_t entity;
+
+    bool is_visible;
+} ng_timeline_target_t;
+
+typedef enum
+{
+    // These three can slide over from their previous key
+    NG_KEY_X,
+    NG_KEY_Y,
+    NG_KEY_SCALE,
+
+    NG_KEY_FRAME,
+    NG_KEY_TEXTURE,
+    NG_KEY_TEXT,
+    NG_KEY_SHOW,
+    NG_KEY_HIDE,
+    NG_KEY_PLAY,
+    NG_KEY_PAUSE,
+    NG_KEY_RESUME,
+    NG_KEY_CALL
+} ng_key_type_t;
+
+#define NG_NUMERIC_KEYS (NG_KEY_SCALE + 1)
+
+typedef struct
+{
+    // Milliseconds since the timeline started
+    uint32_t time;
+    ng_key_type_t type;
+    // -1 for calls
+    int target;
+
+    float value;
+    // Texture path, label text or command
+    char *text;
+
+    // Slides from the previous key of the same target and property, instead of jumping
+    bool is_linear;
+    // The next key of the same target and property when it slides, -1 otherwise
+    int next_linear;
+} ng_keyframe_t;
+
+// A value sliding between two keys right now
+typedef struct
+{
+    int from, to;
+} ng_tween_t;
+
+/*
+ * Cutscenes as data: keys say what happens to which target and when,
+ * the timeline plays them back as the game advances it
+ *
+ *     # <ms> <target> <property> [value] [linear]
+ *     0     player  show
+ *     1000  player  x 400
+ *     3000  player  x 900 linear
+ *     3000  theme   play
+ *     3500  call    player_jumps
+ *
+ * Properties: x, y, scale (which can slide), frame, texture <path> <scale>,
+ * text <content>, show, hide, play, pause and resume. `call` lines go to the
+ * command handler, for whatever data can't express
+ *
+ * Keys are kept in one list sorted by time, a cursor marks the next one that
+ * is due. Advancing only looks at the keys that come due plus the values that
+ * are sliding at the moment, so the length of the cutscene doesn't matter.
+ * Slides are evaluated at the exact time of every update, not in steps
+ */
+typedef struct
+{
+    SDL_Renderer *renderer;
+    ng_assets_t *assets;
+
+    // Rendered in the order they were bound
+    ng_timeline_target_t targets[NG_TIMELINE_TARGETS];
+    int target_count;
+
+    ng_keyframe_t *keys;
+    int key_count;
+    int cursor;
+
+    // At most one per target and numeric property
+    ng_tween_t tweens[NG_TIMELINE_TARGETS * NG_NUMERIC_KEYS];
+    int tween_count;
+
+    double time;
+    ng_command_handler_t handle_command;
+} ng_timeline_t;
+
+// Textures set by keys come from (and go back to) the asset manager
+void ng_timeline_create(ng_timeline_t *timeline, SDL_Renderer *renderer, ng_assets_t *assets);
+
+// Targets have to be bound before loading the keys that use them
+void ng_timeline_bind_sprite(ng_timeline_t *timeline, const char *name, ng_sprite_t *sprite);
+void ng_timeline_bind_animated(ng_timeline_t *timeline, const char *name, ng_animated_sprite_t *anim);
+void ng_timeline_bind_label(ng_timeline_t *timeline, const char *name, ng_label_t *label);
+void ng_timeline_bind_entity(ng_timeline_t *timeline, const char *name, ng_world_t *world, ng_entity_t entity);
+void ng_timeline_bind_music(ng_timeline_t *timeline, const char *name, Mix_Music *music);
+void ng_timeline_bind_sound(ng_timeline_t *timeline, const char *name, Mix_Chunk *sound);
+
+void ng_timeline_load(ng_timeline_t *timeline, const char *path);
+void ng_timeline_set_command_handler(ng_timeline_t *timeline, ng_command_handler_t handler);
+
+// Goes back to the beginning and hides every target
+void ng_timeline_start(ng_timeline_t *timeline);
+void ng_timeline_advance(ng_timeline_t *timeline, double ms);
+bool ng_timeline_is_finished(ng_timeline_t *timeline);
+
+// Queues every visible target
+void ng_timeline_render(ng_timeline_t *timeline, ng_render_batch_t *batch);
+
+void ng_timeline_destroy(ng_timeline_t *timeline);
+
+#endif
@@ -1,25 +1,44 @@
 #include "timers.h"
 #include <SDL2/SDL.h>
 
+static bool is_clock_virtual = false;
+static double virtual_ms = 0;
+
+void ng_clock_use_virtual(bool is_virtual)
+{
+    is_clock_virtual = is_virtual;
+    virtual_ms = 0;
+}
+
+void ng_clock_advance(double ms)
+{
+    virtual_ms += ms;
+}
+
+uint32_t ng_clock_get_ticks(void)
+{
+    return is_clock_virtual ? (uint32_t) virtual_ms : SDL_GetTicks();
+}
+
 void ng_timer_start(ng_timer_t *timer)
 {
     // Remember: SDL_GetTicks() returns milliseconds since SDL initialization
-    timer->starting_time = SDL_GetTicks();
+    timer->starting_time = ng_clock_get_ticks();
     timer->is_active = true;
 }
 
 uint32_t ng_timer_get_elapsed(ng_timer_t *timer)
 {
-    return SDL_GetTicks() - timer->starting_time;
+    return ng_clock_get_ticks() - timer->starting_time;
 }
 
 uint32_t ng_timer_restart(ng_timer_t *timer)
 {
-    uint32_t now = SDL_GetTicks();
+    uint32_t now = ng_clock_get_ticks();
     uint32_t elapsed = now - timer->starting_time;
 
     // Restart the timer by making it count time since now
-    timer->starting_time = SDL_GetTicks();
+    timer->starting_time = now;
 
     return elapsed;
 }
@@ -27,7 +46,7 @@ uint32_t ng_timer_restart(ng_timer_t *timer)
 void ng_interval_create(ng_interval_t *interval, uint32_t duration)
 {
     interval->duration = duration;
-    interval->starting_time = SDL_GetTicks();
+    interval->starting_time = ng_clock_get_ticks();
 }
 
 // Returns true whenever the interval has completed,
@@ -35,10 +54,11 @@ void ng_interval_create(ng_interval_t *interval, uint32_t duration)
 // It's like a timer, but it repeats
 bool ng_interval_is_ready(ng_interval_t *interval)
 {
-    if (SDL_GetTicks() - interval->starting_time > interval->duration)
+    if (ng_clock_get_ticks() - interval->starting_time >= interval->duration)
     {
-        // If the interval has been reached, restart the timer and return true
-        interval->starting_time = SDL_GetTicks();
+        // Moving the start by exactly one duration (instead of to now) keeps
+        // it from drifting, a late check just makes the next one come sooner
+        interval->starting_time += interval->duration;
 
         return true;
     }
@@ -9,7 +9,15 @@
  * These timers amount for real-world time, not for game time. That's why they
  * do not require delta time as input. You might want to change that depending
  * on your use case
+ *
+ * Headless runs swap the real clock for a virtual one that only moves when
+ * the game loop says so, which keeps them deterministic
  */
+void ng_clock_use_virtual(bool is_virtual);
+void ng_clock_advance(double ms);
+// Milliseconds since SDL initialization, or since the virtual clock was enabled
+uint32_t ng_clock_get_ticks(void);
+
 typedef struct
 {
     bool is_active;
@@ -30,6 +38,8 @@ typedef struct
     uint32_t duration;
 } ng_interval_t;
 
+// NOTE: Has to be polled, use the game's scheduler (see scheduler.h) for anything
+// that should just happen every so often
 void ng_interval_create(ng_interval_t *interval, uint32_t duration);
 bool ng_interval_is_ready(ng_interval_t *interval);
 
@@ -1,5 +1,6 @@
 #include <SDL2/SDL_image.h>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 #include "engine/game.h"
 #include "engine/common.h"
@@ -7,31 +8,74 @@
 #include "engine/interface.h"
 #include "engine/timers.h"
 #include "engine/audio.h"
+#include "engine/atlas.h"
+#include "engine/assets.h"
+#include "engine/loader.h"
+#include "engine/pack.h"
+#include "engine/profiler.h"
+#include "engine/input.h"
+#include "engine/ecs.h"
+#include "engine/spatial.h"
+#include "engine/timeline.h"
+#include "engine/scenes.h"
+#include "engine/layer.h"
 
 #define WIDTH 1280
 #define HEIGHT 640*1.4
 
 #define PRESENT_V 120
 #define MAX_VERT_V 960
-
-typedef enum { HOMESCREEN, CONTEXT_SCENE, PENGUIN_CHASE, PENG_TO_SLEIGH, SLEIGH, BLACK_SCREEN, WAKE_UP, EHH, FINAL_CUTSCENE } Scene;
+#define UPDATES_PER_SECOND 60
+#define MAX_FALLING_PRESENTS 10
+// Countdowns and cutscenes move forward once every game tick
+#define GAME_TICK_MS 50
+// The dancing penguins used to move 400 * delta once every tick, that many pixels per second
+#define PENGUIN_DANCE_V (400.0f / UPDATES_PER_SECOND * 1000 / GAME_TICK_MS)
+// Unused textures are kept around for a while, as long as they fit in here
+// The final cutscene alone takes 0.75 MB
+#define TEXTURE_BUDGET (1024 * 1024)
+// Every sprite and label is drawn at a whole multiple of its size, twice at the
+// very least, so the scene gets rendered at half the window's resolution and
+// scaled up once without losing a single pixel. Keep new scales like that
+#define PIXEL_SCALE 2
+// Sounds played through ng_audio_play (the timeline's) have a priority of 0
+#define SWITCH_SOUND_PRIORITY 1
+
+// Small sprites that are drawn next to each other share a single atlas
+typedef enum { ELF_SPRITE, PENGUIN_SPRITE, PRESENT_SPRITE, SLEIGH_SPRITE, QUESTIONMARK_SPRITE, ACTOR_SPRITES } ActorSprite;
+
+static const char *actor_files[ACTOR_SPRITES] = {
+    "res/elf_sprite.png", "res/penquin.png", "res/present.png", "res/slay_sprite.png", "res/questionmark.png"
+};
+
+// Indices into the scene table, see the bottom of the file
+typedef enum { LOADING, HOMESCREEN, CONTEXT_SCENE, PENGUIN_CHASE, PENG_TO_SLEIGH, SLEIGH, BLACK_SCREEN, WAKE_UP, EHH, FINAL_CUTSCENE, SCENES } Scene;
+
+// Tags of the entities living in ctx.world
+enum { PENGUIN = NG_FIRST_TAG, FALLING_PRESENT = NG_FIRST_TAG << 1 };
+
+// Picked with the command line arguments, see main()
+typedef enum { PLAY, BENCHMARK, RECORD, REPLAY, FAST_REPLAY } RunMode;
 
 static struct
 {
     ng_game_t game;
-    ng_interval_t game_tick;
-
-    // A collection of assets used by entities
-    // Ideally, they should have been automatically loaded
-    // by iterating over the res/ folder and filling in a hastable
-    SDL_Texture *player_texture, *penguin_texture, *present_texture, *home_bg_texture, *penguin_bg1_texture, *penguin_bg2_texture, 
-                *penguin_bg3_texture, *sleigh_bg_texture, *sleigh_bg_2_texture, *sleigh_texture, *final_bg1_texture, *final_bg2_texture, 
-                *final_bg3_texture, *questionmark_texture;
+
+    // Every file inside res/ is known to the asset manager,
+    // which loads it the first time it is requested
+    ng_assets_t assets;
+    ng_pack_t pack;
+    ng_loader_t loader;
+    ng_atlas_t actors_atlas;
     TTF_Font *main_font;
+    ng_glyph_cache_t main_glyphs;
 
     Mix_Chunk *switch_sound;
 
-    Scene current_scene;
+    // Only the textures of the current scene (and of the next ones) are loaded
+    ng_scene_manager_t scenes;
+    ng_label_t loading_label;
+    int loaded_count;
     ng_label_t welcome_label;
     ng_sprite_t home_bg;
     ng_sprite_t questionmark;
@@ -39,16 +83,38 @@ static struct
     bool show_help;
     ng_label_t penguin_context_label;
 
+    // Whatever only changes between scenes is drawn once and then copied
+    ng_layer_t home_layer;
+    ng_layer_t context_layer;
+    ng_layer_t sleigh_layer;
+
     ng_sprite_t penguin_bg;
+    // Both change as the dream goes on
+    const char *penguin_background;
+    const char *sleigh_background;
 
     ng_animated_sprite_t player;
-    ng_animated_sprite_t penguins[3];
-    short int penguin_velocity[3];
+
+    // Moving things are drawn between where they were before the last update
+    // and where they are now. A new scene places everything from scratch, so
+    // nothing gets interpolated until it has been updated once
+    SDL_FPoint previous_player;
+    int interpolated_scene;
+    float alpha;
+
+    // Penguins and the presents they drop, the handles of the
+    // penguins are kept around since cutscenes move them one by one
+    ng_world_t world;
+    ng_entity_t penguins[3];
+    ng_sprite_t present_template;
+    int falling_count;
+    ng_spatial_hash_t present_grid;
 
     short int present_countdown;
     short int max_present_countdown;
 
-    ng_sprite_t presents[10];
+    // The pile of presents that gets loaded onto the sleigh
+    ng_sprite_t stacked_presents[10];
     short int score;
     ng_label_t score_label;
 
@@ -70,102 +136,137 @@ static struct
     ng_sprite_t final_bg;
     ng_label_t talk_label;
     Mix_Music *final_audio;
+    ng_timeline_t final_timeline;
 } ctx;
 
-static void create_actors(void){
-    ng_game_create(&ctx.game, "DISASTER BEFORE CHRISTMAS", WIDTH, HEIGHT);
-
-    ctx.switch_sound = ng_audio_load("res/154953__keykrusher__microwave-beep.wav");
-    ctx.final_audio = Mix_LoadMUS("res/final_ms3.wav");
-    if (!ctx.final_audio) ng_die("Something went wrong, couldn't load audio file final_ms2!");
-
-    ctx.main_font = TTF_OpenFont("res/free_mono.ttf", 16);
-    ctx.player_texture = IMG_LoadTexture(ctx.game.renderer, "res/elf_sprite.png");
-    ctx.penguin_texture = IMG_LoadTexture(ctx.game.renderer, "res/penquin.png");
-    ctx.present_texture = IMG_LoadTexture(ctx.game.renderer, "res/present.png");
-    ctx.home_bg_texture = IMG_LoadTexture(ctx.game.renderer, "res/home_background.png");
-    ctx.penguin_bg1_texture = IMG_LoadTexture(ctx.game.renderer, "res/penguin_bg1.png");
-    ctx.penguin_bg2_texture = IMG_LoadTexture(ctx.game.renderer, "res/penguin_bg2.png");
-    ctx.penguin_bg3_texture = IMG_LoadTexture(ctx.game.renderer, "res/penguin_bg3.png");
-    ctx.sleigh_bg_texture = IMG_LoadTexture(ctx.game.renderer, "res/slay_bg.png");
-    ctx.sleigh_bg_2_texture = IMG_LoadTexture(ctx.game.renderer, "res/slay_bg_2.png");
-    ctx.sleigh_texture = IMG_LoadTexture(ctx.game.renderer, "res/slay_sprite.png");
-    ctx.final_bg1_texture = IMG_LoadTexture(ctx.game.renderer, "res/final_bg1.png");
-    ctx.final_bg2_texture = IMG_LoadTexture(ctx.game.renderer, "res/final_bg2.png");
-    ctx.final_bg3_texture = IMG_LoadTexture(ctx.game.renderer, "res/final_bg3.png");
-    ctx.questionmark_texture = IMG_LoadTexture(ctx.game.renderer, "res/questionmark.png");
-
-    ng_interval_create(&ctx.game_tick, 50);
-
-    ctx.current_scene = HOMESCREEN;
+// Marks every scene change, nothing the timeline plays should be able to cut it off
+static void play_switch_sound(){
+    ng_audio_play_voice(ctx.switch_sound, 1, 0, SWITCH_SOUND_PRIORITY);
+}
+
+// Backgrounds are swapped through the asset manager, so
+// that it knows which textures are still being used
+static void set_background(ng_sprite_t *background, const char *path, float scale){
+    ng_assets_release(&ctx.assets, background->texture);
+    ng_sprite_create(background, ng_assets_get_texture(&ctx.assets, path));
+    ng_sprite_set_scale(background, scale);
+}
+
+// When leaving a scene, so the texture can go once the scene manager is done with it
+static void drop_background(ng_sprite_t *background){
+    ng_assets_release(&ctx.assets, background->texture);
+    background->texture = NULL;
+}
+
+// For the `call` lines of cutscene timelines, whatever depends on the game's state
+static void handle_cutscene_command(const char *command){
+    if (strcmp(command, "player_on_sleigh") == 0){
+        ctx.player.sprite.transform.y = ctx.sleigh.sprite.transform.y + ctx.player.sprite.transform.h - 15;
+    }
+    else ng_die("unknown cutscene command '%s'", command);
+}
+
+static void create_actors(RunMode mode, const char *path){
+    if (mode == BENCHMARK || mode == FAST_REPLAY) ng_game_create_headless(&ctx.game, "DISASTER BEFORE CHRISTMAS", WIDTH, HEIGHT);
+    else ng_game_create(&ctx.game, "DISASTER BEFORE CHRISTMAS", WIDTH, HEIGHT);
+
+    ng_game_set_pixel_scale(&ctx.game, PIXEL_SCALE, true);
+
+    // Opt-in for machines without a GPU, benchmarks keep measuring whole frames
+    if (mode != BENCHMARK && mode != FAST_REPLAY && SDL_getenv("NG_DIRTY_RECTS")) ng_game_use_dirty_rects(&ctx.game);
+
+    // Has to happen before any timer gets created
+    if (mode == RECORD) ng_game_record(&ctx.game, path);
+    if (mode == REPLAY || mode == FAST_REPLAY) ng_game_replay(&ctx.game, path, mode == FAST_REPLAY);
+
+    ng_assets_create(&ctx.assets, ctx.game.renderer);
+    ng_assets_scan(&ctx.assets, "res");
+
+    // Produced by `make bake`, the original files are used if it's missing
+    bool has_pack = ng_pack_open(&ctx.pack, "res.pack");
+    if (has_pack) ng_assets_mount_pack(&ctx.assets, &ctx.pack);
+
+    ctx.switch_sound = ng_assets_get_sound(&ctx.assets, "res/154953__keykrusher__microwave-beep.wav");
+    ctx.final_audio = ng_assets_get_music(&ctx.assets, "res/final_ms3.wav");
+
+    ng_loader_create(&ctx.loader, ctx.game.renderer, 0);
+    if (has_pack) ng_loader_mount_pack(&ctx.loader, &ctx.pack);
+
+    ctx.main_font = ng_assets_get_font(&ctx.assets, "res/free_mono.ttf", 16);
+    ng_glyph_cache_create(&ctx.main_glyphs, ctx.game.renderer, ctx.main_font);
+    NG_PROFILE_SET_HUD_GLYPHS(&ctx.main_glyphs);
+    ng_atlas_create(&ctx.actors_atlas, ctx.game.renderer, &ctx.pack, actor_files, ACTOR_SPRITES, 512);
+
+    ctx.loaded_count = -1;
     ctx.carrying_present = false;
     ctx.top_present = 9;
     ctx.vertical_velocity = 0;
     ctx.is_jumping = false;
     ctx.repetition_count = 0;
+    ctx.penguin_background = "res/penguin_bg1.png";
+    ctx.sleigh_background = "res/slay_bg.png";
 
-    ng_sprite_create(&ctx.home_bg, ctx.home_bg_texture);
-    ng_sprite_set_scale(&ctx.home_bg, 2.9f);
-    ctx.home_bg.transform.x = -200;
-
-    ng_sprite_create(&ctx.questionmark, ctx.questionmark_texture);
-    ng_sprite_set_scale(&ctx.questionmark, 2.9f);
+    ng_atlas_get_sprite(&ctx.actors_atlas, &ctx.questionmark, QUESTIONMARK_SPRITE);
+    ng_sprite_set_scale(&ctx.questionmark, 3.0f);
     ctx.questionmark.transform.x = WIDTH - 100;
     ctx.questionmark.transform.y = 20;
     ctx.show_help = false;
 
-    ng_sprite_create(&ctx.penguin_bg, ctx.penguin_bg1_texture);
-    ng_sprite_set_scale(&ctx.penguin_bg, 5.0f);
-
-    ng_sprite_create(&ctx.sleigh_bg, ctx.sleigh_bg_texture);
-    ng_sprite_set_scale(&ctx.sleigh_bg, 5.0f);
-
-    ng_sprite_create(&ctx.final_bg, ctx.final_bg1_texture);
-    ng_sprite_set_scale(&ctx.final_bg, 10.0f);
-
-    ng_animated_create(&ctx.sleigh, ctx.sleigh_texture, 4);
+    ng_atlas_get_animated(&ctx.actors_atlas, &ctx.sleigh, SLEIGH_SPRITE, 4);
     ng_sprite_set_scale(&ctx.sleigh.sprite, 8.0f);
     ctx.sleigh.sprite.transform.x = ctx.sleigh.sprite.transform.w - 100;
     ctx.sleigh.sprite.transform.y = HEIGHT - ctx.sleigh.sprite.transform.h - 125;
 
-    ng_animated_create(&ctx.player, ctx.player_texture, 3);
+    ng_atlas_get_animated(&ctx.actors_atlas, &ctx.player, ELF_SPRITE, 3);
     ng_sprite_set_scale(&ctx.player.sprite, 4.0f);
     ctx.player.sprite.transform.x = (WIDTH - ctx.player.sprite.transform.w - 10)/2;
     ctx.player.sprite.transform.y = HEIGHT - ctx.player.sprite.transform.h - 30;
     ctx.floor = ctx.player.sprite.transform.y;
 
+    ng_world_create(&ctx.world, 16);
+    ng_spatial_create(&ctx.present_grid, 128, 64);
+
+    ng_animated_sprite_t penguin;
+    ng_atlas_get_animated(&ctx.actors_atlas, &penguin, PENGUIN_SPRITE, 2);
+    ng_sprite_set_scale(&penguin.sprite, 3.0f);
     for (size_t i = 0; i < 3; i++){
-        ng_animated_create(&ctx.penguins[i], ctx.penguin_texture, 2);
-        ng_sprite_set_scale(&ctx.penguins[i].sprite, 3.0f);
-        ctx.penguins[i].sprite.transform.x = (WIDTH - ctx.penguins[i].sprite.transform.w - 10) / 3.0 * (i) + 50;
-        ctx.penguins[i].sprite.transform.y = 55;
-        ctx.penguin_velocity[i] = pow(-1, i) * 120 * (i+1);
+        ctx.penguins[i] = ng_world_spawn(&ctx.world, NG_POSITION | NG_VELOCITY | NG_SPRITE | NG_ANIMATION | PENGUIN);
+
+        int p = ng_world_index_of(&ctx.world, ctx.penguins[i]);
+        ng_world_set_sprite(&ctx.world, p, &penguin.sprite);
+        ctx.world.total_frames[p] = penguin.total_frames;
     }
-    ng_animated_set_frame(&ctx.penguins[1], (ctx.penguins[1].frame + 1) % ctx.penguins[1].total_frames);
+    // Positions and velocities are set in prepare_peng_scene
 
+    ng_atlas_get_sprite(&ctx.actors_atlas, &ctx.present_template, PRESENT_SPRITE);
+    ng_sprite_set_scale(&ctx.present_template, 3.0f);
+    ctx.falling_count = 0;
 
     for (size_t i = 0; i < 10; i++){
-        ng_sprite_create(&ctx.presents[i], ctx.present_texture);
-        ng_sprite_set_scale(&ctx.presents[i], 3.0f);
-        ctx.presents[i].transform.x = -100;
-        ctx.presents[i].transform.y = -100;
+        ctx.stacked_presents[i] = ctx.present_template;
+        ctx.stacked_presents[i].transform.x = -100;
+        ctx.stacked_presents[i].transform.y = -100;
     }
     ctx.max_present_countdown = ctx.present_countdown = 30;
 
-    ng_label_create(&ctx.talk_label, ctx.main_font, 300);
+    ng_label_create_cached(&ctx.loading_label, &ctx.main_glyphs, 300);
+
+    ng_label_create_cached(&ctx.talk_label, &ctx.main_glyphs, 300);
+    ng_label_create_cached(&ctx.score_label, &ctx.main_glyphs, 0);
 
-    ng_label_create(&ctx.welcome_label, ctx.main_font, 300);
+    ng_label_create_cached(&ctx.welcome_label, &ctx.main_glyphs, 300);
     ng_label_set_content(&ctx.welcome_label, ctx.game.renderer, "DISASTER BEFORE CHRISTMAS\n  PRESS [SPACE] TO PLAY");
     ng_sprite_set_scale(&ctx.welcome_label.sprite, 2.0f);
     ctx.welcome_label.sprite.transform.x = WIDTH/2 - ctx.welcome_label.sprite.transform.w/2 + 110;
     ctx.welcome_label.sprite.transform.y = HEIGHT/4 - 15;
 
-    ng_label_create(&ctx.help_label, ctx.main_font, 300);
+    ng_label_create_cached(&ctx.help_label, &ctx.main_glyphs, 300);
     ng_label_set_content(&ctx.help_label, ctx.game.renderer, "Move: Arrow Keys\nJump: Space");
-    ctx.help_label.sprite.transform.x = WIDTH - 170;
+    ng_sprite_set_scale(&ctx.help_label.sprite, 2.0f);
+    ctx.help_label.sprite.transform.x = WIDTH - ctx.help_label.sprite.transform.w - 20;
     ctx.help_label.sprite.transform.y = 140;
 
-    ng_label_create(&ctx.penguin_context_label, ctx.main_font, 400);
+    ng_label_create_cached(&ctx.penguin_context_label, &ctx.main_glyphs, 400);
     ng_label_set_content(&ctx.penguin_context_label, ctx.game.renderer, "You are a hard working elf\nlike no other, but at\n"
                                                                         "Christmas Eve, some pesky\npenguins stole Santa's presents.\n\n"
                                                                         "Your job now is to try and\ncollect the presents that fall\n"
@@ -174,47 +275,109 @@ static void create_actors(void){
     ctx.penguin_context_label.sprite.transform.x = WIDTH/2 - ctx.penguin_context_label.sprite.transform.w/2 + 35;
     ctx.penguin_context_label.sprite.transform.y = HEIGHT/4 - 15;
 
-    ng_label_create(&ctx.peng_to_sleigh_label, ctx.main_font, 300);
+    ng_label_create_cached(&ctx.peng_to_sleigh_label, &ctx.main_glyphs, 300);
     ng_label_set_content(&ctx.peng_to_sleigh_label, ctx.game.renderer, "LOAD THE PRESENTS");
     ng_sprite_set_scale(&ctx.peng_to_sleigh_label.sprite, 4.0f);
     ctx.peng_to_sleigh_label.sprite.transform.x = WIDTH/2 - ctx.peng_to_sleigh_label.sprite.transform.w/2 + 35;
     ctx.peng_to_sleigh_label.sprite.transform.y = HEIGHT/2 - ctx.peng_to_sleigh_label.sprite.transform.h/2;
 
-    ng_label_create(&ctx.ehh_label, ctx.main_font, 300);
+    ng_label_create_cached(&ctx.ehh_label, &ctx.main_glyphs, 300);
     ng_label_set_content(&ctx.ehh_label, ctx.game.renderer, "EHHHHHH");
     ng_sprite_set_scale(&ctx.ehh_label.sprite, 4.0f);
     ctx.ehh_label.sprite.transform.x = WIDTH/2 - ctx.ehh_label.sprite.transform.w/2 + 35;
     ctx.ehh_label.sprite.transform.y = HEIGHT/2 - ctx.ehh_label.sprite.transform.h/2;
 
-    ng_label_create(&ctx.wake_up_label, ctx.main_font, 300);
+    ng_label_create_cached(&ctx.wake_up_label, &ctx.main_glyphs, 300);
     ng_label_set_content(&ctx.wake_up_label, ctx.game.renderer, "WAKE UP");
     ng_sprite_set_scale(&ctx.wake_up_label.sprite, 4.0f);
     ctx.wake_up_label.sprite.transform.x = WIDTH/2 - ctx.wake_up_label.sprite.transform.w/2 + 35;
     ctx.wake_up_label.sprite.transform.y = HEIGHT/2 - ctx.wake_up_label.sprite.transform.h/2;
+
+    ng_layer_create(&ctx.home_layer, ctx.game.renderer, true);
+    ng_layer_add_sprite(&ctx.home_layer, &ctx.home_bg);
+    ng_layer_add_label(&ctx.home_layer, &ctx.welcome_label);
+    ng_layer_add_sprite(&ctx.home_layer, &ctx.questionmark);
+
+    ng_layer_create(&ctx.context_layer, ctx.game.renderer, true);
+    ng_layer_add_label(&ctx.context_layer, &ctx.penguin_context_label);
+
+    // Only redrawn when a present gets picked up or the sleigh fills up
+    ng_layer_create(&ctx.sleigh_layer, ctx.game.renderer, true);
+    ng_layer_add_sprite(&ctx.sleigh_layer, &ctx.sleigh_bg);
+    ng_layer_add_sprite(&ctx.sleigh_layer, &ctx.sleigh.sprite);
+    for (size_t i = 0; i < 10; i++){
+        ng_layer_add_sprite(&ctx.sleigh_layer, &ctx.stacked_presents[i]);
+    }
+
+    // Bound in the order they are drawn
+    ng_timeline_t *timeline = &ctx.final_timeline;
+    ng_timeline_create(timeline, ctx.game.renderer, &ctx.assets);
+    ng_timeline_bind_sprite(timeline, "final_bg", &ctx.final_bg);
+    ng_timeline_bind_sprite(timeline, "sleigh_bg", &ctx.sleigh_bg);
+    ng_timeline_bind_animated(timeline, "player", &ctx.player);
+    ng_timeline_bind_sprite(timeline, "present", &ctx.stacked_presents[0]);
+    ng_timeline_bind_entity(timeline, "penguin_a", &ctx.world, ctx.penguins[0]);
+    ng_timeline_bind_entity(timeline, "penguin_b", &ctx.world, ctx.penguins[1]);
+    ng_timeline_bind_label(timeline, "talk", &ctx.talk_label);
+    ng_timeline_bind_music(timeline, "final_audio", ctx.final_audio);
+    ng_timeline_load(timeline, "res/final_cutscene.txt");
+    ng_timeline_set_command_handler(timeline, handle_cutscene_command);
+}
+
+static void prepare_home_scene(){
+    set_background(&ctx.home_bg, "res/home_background.png", 3.0f);
+    ctx.home_bg.transform.x = -200;
+}
+
+static void leave_home_scene(){
+    drop_background(&ctx.home_bg);
+    ng_layer_release(&ctx.home_layer);
+}
+
+// Cheap enough to call on every change, the label only lays out cached glyphs
+static void update_score_label(){
+    char *score = ng_arena_printf(&ctx.game.frame_arena, "PRESENTS %d/%d", ctx.score, 20 - 6*ctx.repetition_count);
+
+    ng_label_set_content(&ctx.score_label, ctx.game.renderer, score);
+    ng_sprite_set_scale(&ctx.score_label.sprite, 2.0f);
+    ctx.score_label.sprite.transform.x = 20;
+    ctx.score_label.sprite.transform.y = HEIGHT - ctx.score_label.sprite.transform.h - 10;
 }
 
 static void prepare_peng_scene(){
-    Mix_PlayChannel(-1, ctx.switch_sound, 0);
+    play_switch_sound();
     ctx.countdown = 180 - 65*ctx.repetition_count;
     ctx.max_present_countdown = 30;
     ctx.player.sprite.transform.x = (WIDTH - ctx.player.sprite.transform.w - 10)/2;
     ctx.player.sprite.transform.y = HEIGHT - ctx.player.sprite.transform.h - 30;
     ctx.floor = ctx.player.sprite.transform.y;
     for (size_t i = 0; i < 3; i++){
-        ctx.penguins[i].sprite.transform.x = (WIDTH - ctx.penguins[i].sprite.transform.w - 10) / 3.0 * (i) + 50;
-        ctx.penguins[i].sprite.transform.y = 55;
-        ctx.penguin_velocity[i] = pow(-1, i) * 120 * (i+1);
+        int p = ng_world_index_of(&ctx.world, ctx.penguins[i]);
+        ctx.world.x[p] = (WIDTH - ctx.world.w[p] - 10) / 3.0 * (i) + 50;
+        ctx.world.y[p] = 55;
+        ctx.world.vx[p] = pow(-1, i) * 120 * (i+1);
+        ng_world_set_frame(&ctx.world, p, i % 2);
     }
-    ng_animated_set_frame(&ctx.penguins[0], 0);
-    ng_animated_set_frame(&ctx.penguins[1], 1);
-    ng_animated_set_frame(&ctx.penguins[2], 0);
+
+    ng_world_kill_all(&ctx.world, FALLING_PRESENT);
+    ctx.falling_count = 0;
 
     ctx.score = 0;
     ng_animated_set_frame(&ctx.player, 0);
 }
 
+static void enter_penguin_scene(){
+    set_background(&ctx.penguin_bg, ctx.penguin_background, 5.0f);
+    ctx.score = 0;
+    update_score_label();
+}
+
+static void leave_penguin_scene(){
+    drop_background(&ctx.penguin_bg);
+}
+
 static void prepare_sleigh_scene(){
-    Mix_PlayChannel(-1, ctx.switch_sound, 0);
+    play_switch_sound();
     ctx.countdown = 17;
     ng_animated_set_frame(&ctx.player, 1);
     ng_animated_set_frame(&ctx.sleigh, 0);
@@ -226,28 +389,49 @@ static void prepare_sleigh_scene(){
     ctx.top_present = 9 - 2*ctx.repetition_count;
 
     for (size_t i = 0; i < ctx.top_present; i++){
-        ctx.presents[i].transform.x = ctx.player.sprite.transform.x + 50;
-        ctx.presents[i].transform.y = ctx.player.sprite.transform.y + ctx.presents[i].transform.h/2 + 10 - i * ctx.presents[i].transform.h / 2;
+        ctx.stacked_presents[i].transform.x = ctx.player.sprite.transform.x + 50;
+        ctx.stacked_presents[i].transform.y = ctx.player.sprite.transform.y + ctx.stacked_presents[i].transform.h/2 + 10 - i * ctx.stacked_presents[i].transform.h / 2;
     }
 
     for (size_t i = ctx.top_present; i < 10; i++){
-        ctx.presents[i].transform.x = -100;
-        ctx.presents[i].transform.y = -100;
+        ctx.stacked_presents[i].transform.x = -100;
+        ctx.stacked_presents[i].transform.y = -100;
     }
+
+    ng_world_kill_all(&ctx.world, FALLING_PRESENT);
+    ctx.falling_count = 0;
+}
+
+static void enter_sleigh_scene(){
+    set_background(&ctx.sleigh_bg, ctx.sleigh_background, 5.0f);
+    ctx.countdown = 0;
+}
+
+static void leave_sleigh_scene(){
+    drop_background(&ctx.sleigh_bg);
+    ng_layer_release(&ctx.sleigh_layer);
 }
 
 static void prepare_reversal_screen(){
-    Mix_PlayChannel(-1, ctx.switch_sound, 0);
+    play_switch_sound();
     ctx.countdown = 20;
 }
 
+static void prepare_wake_up_screen(){
+    prepare_reversal_screen();
+    ng_label_set_content(&ctx.peng_to_sleigh_label, ctx.game.renderer, "HE IS WATCHING");
+    ng_sprite_set_scale(&ctx.peng_to_sleigh_label.sprite, 4.0f);
+    ctx.peng_to_sleigh_label.sprite.transform.x = WIDTH/2 - ctx.peng_to_sleigh_label.sprite.transform.w/2 + 35;
+    ctx.peng_to_sleigh_label.sprite.transform.y = HEIGHT/2 - ctx.peng_to_sleigh_label.sprite.transform.h/2;
+}
+
 static void prepare_final_cutscene(){
-    Mix_PlayChannel(-1, ctx.switch_sound, 0);
-    ctx.countdown = -15;
+    play_switch_sound();
+    ng_timeline_start(&ctx.final_timeline);
     ctx.player.sprite.transform.x = 200;
 
-    ng_sprite_create(&ctx.sleigh_bg, ctx.sleigh_bg_texture);
-    ng_sprite_set_scale(&ctx.sleigh_bg, 5.0f);
+    set_background(&ctx.sleigh_bg, "res/slay_bg.png", 5.0f);
+    set_background(&ctx.final_bg, "res/final_bg1.png", 10.0f);
 
     ng_label_set_content(&ctx.talk_label, ctx.game.renderer, "It was all a dream?");
     ng_sprite_set_scale(&ctx.talk_label.sprite, 2.0f);
@@ -259,14 +443,16 @@ static void prepare_final_cutscene(){
     ctx.player.sprite.transform.x = 400;
     ctx.player.sprite.transform.y = HEIGHT/2 + 85;
 
-    ng_animated_set_frame(&ctx.penguins[0], 0);
-    ng_animated_set_frame(&ctx.penguins[1], 1);
-    ctx.penguins[0].sprite.transform.x = 200;
-    ctx.penguins[1].sprite.transform.x = 300;
-    ctx.penguins[0].sprite.transform.y = ctx.sleigh.sprite.transform.y + ctx.penguins[0].sprite.transform.h + 55;
-    ctx.penguins[1].sprite.transform.y = ctx.penguins[0].sprite.transform.y;
-    ctx.presents[0].transform.x = 250;
-    ctx.presents[0].transform.y = ctx.penguins[0].sprite.transform.y + 15;
+    int first = ng_world_index_of(&ctx.world, ctx.penguins[0]);
+    int second = ng_world_index_of(&ctx.world, ctx.penguins[1]);
+    ng_world_set_frame(&ctx.world, first, 0);
+    ng_world_set_frame(&ctx.world, second, 1);
+    ctx.world.x[first] = 200;
+    ctx.world.x[second] = 300;
+    ctx.world.y[first] = ctx.sleigh.sprite.transform.y + ctx.world.h[first] + 55;
+    ctx.world.y[second] = ctx.world.y[first];
+    ctx.stacked_presents[0].transform.x = 250;
+    ctx.stacked_presents[0].transform.y = ctx.world.y[first] + 15;
 }
 
 // A place to handle queued events.
@@ -275,29 +461,35 @@ static void handle_event(SDL_Event *event){
     {
     case SDL_KEYDOWN:
         // Press space to start!
-        if (event->key.keysym.sym == SDLK_SPACE && ctx.current_scene == HOMESCREEN){
-            ctx.current_scene = CONTEXT_SCENE;
-            prepare_peng_scene();
+        if (event->key.keysym.sym == SDLK_SPACE && ng_scenes_get_current(&ctx.scenes) == HOMESCREEN){
+            ng_scenes_switch(&ctx.scenes, CONTEXT_SCENE);
         }
 
+        break;
+    case SDL_RENDER_TARGETS_RESET:
+    case SDL_RENDER_DEVICE_RESET:
+        // The cached layers might be gone with them, they're drawn again on the next frame
+        ng_layer_release(&ctx.home_layer);
+        ng_layer_release(&ctx.context_layer);
+        ng_layer_release(&ctx.sleigh_layer);
         break;
     case SDL_MOUSEMOTION:
         // Move label on mouse position
         // By the way, that's how you can implement a custom cursor
         //ctx.aaa.sprite.transform.x = event->motion.x;
         //ctx.aaa.sprite.transform.y = event->motion.y;
-        if (ctx.current_scene != HOMESCREEN) break;
+        if (ng_scenes_get_current(&ctx.scenes) != HOMESCREEN) break;
         
         ng_vec2 mouse_pos = { event->motion.x, event->motion.y };
         ng_vec2 q_pos = { ctx.questionmark.transform.x + ctx.questionmark.transform.w/2, ctx.questionmark.transform.y + ctx.questionmark.transform.h/2 };
         ng_vec2 sub;
         ng_vectors_substract(&sub, &q_pos, &mouse_pos);
-        float distance = ng_vector_get_magnitude(&sub);
-        if (distance < 40){
+        float distance = ng_vector_get_squared_magnitude(&sub);
+        if (distance < 40*40){
             ctx.show_help = true;
         }
 
-        if (distance > 40){
+        if (distance > 40*40){
             ctx.show_help = false;
         }
         break;
@@ -306,7 +498,7 @@ static void handle_event(SDL_Event *event){
 
 static void player_n_enemy_movement(float delta){
     // Handling "continuous" events, which are now repeatable
-    const Uint8* keys = SDL_GetKeyboardState(NULL);
+    const Uint8* keys = ng_input_get_keys(&ctx.game.input);
 
     if (keys[SDL_SCANCODE_LEFT]){
         ctx.player.sprite.transform.x -= 640* delta;
@@ -333,98 +525,127 @@ static void player_n_enemy_movement(float delta){
     ng_vec2 left_bound, right_bound;
     float left_threshold, right_threshold, threshold = 30;
 
-    size_t i;
-    for (i = 0; i < 3; i++){
-        ng_vec2 penguin_pos = { ctx.penguins[i].sprite.transform.x, ctx.penguins[i].sprite.transform.y };
+    ng_world_t *world = &ctx.world;
+    ng_query_t query;
+    ng_query_begin(&query, world, PENGUIN);
+    while (ng_query_next(&query)){
+        int p = query.index;
+        ng_vec2 penguin_pos = { world->x[p], world->y[p] };
 
         ng_vectors_substract(&left_bound, &penguin_pos, &left);
         ng_vectors_substract(&right_bound, &right, &penguin_pos);
         
-        float left_threshold = ng_vector_get_magnitude(&left_bound);
-        float right_threshold = ng_vector_get_magnitude(&right_bound);
-        if (right_threshold < threshold || left_threshold < threshold){
-            ctx.penguin_velocity[i] *= -1;
-            ng_animated_set_frame(&ctx.penguins[i], (ctx.penguins[i].frame + 1) % ctx.penguins[i].total_frames);
+        float left_threshold = ng_vector_get_squared_magnitude(&left_bound);
+        float right_threshold = ng_vector_get_squared_magnitude(&right_bound);
+        if (right_threshold < threshold*threshold || left_threshold < threshold*threshold){
+            world->vx[p] *= -1;
+            ng_world_set_frame(world, p, (world->frames[p] + 1) % world->total_frames[p]);
         }
-
-        ctx.penguins[i].sprite.transform.x += ctx.penguin_velocity[i] * delta;
     }
 
-    // Once every 100ms
-    bool spawn_present = false;
-    if (ng_interval_is_ready(&ctx.game_tick)){
-        ctx.present_countdown--;
-        if (ctx.present_countdown < 0){
-            ctx.present_countdown = ctx.max_present_countdown;
-            if (ctx.max_present_countdown > 10) ctx.max_present_countdown--;
-            spawn_present = true;
+    // Penguins and presents move all at once
+    ng_world_integrate_parallel(world, &ctx.game.jobs, delta);
+
+    // Presents that fell off the screen are gone
+    ng_query_begin(&query, world, FALLING_PRESENT);
+    while (ng_query_next(&query)){
+        if (world->y[query.index] > HEIGHT){
+            ng_world_kill(world, ng_world_entity_at(world, query.index));
+            ctx.falling_count--;
         }
     }
+}
 
-    // Spawn present if needed
-    if (spawn_present){
-        for (i = 0; i < 10; i++){
-            if (ctx.presents[i].transform.y < 0 || ctx.presents[i].transform.y > HEIGHT)
-                break;
-        }
+static void tick_penguin_scene(){
+    ctx.present_countdown--;
+    if (ctx.present_countdown >= 0) return;
 
-        if (i < 10){
-            int j = ng_random_int_in_range(0, 3);
-            ctx.presents[i].transform.x = ctx.penguins[j].sprite.transform.x;
-            ctx.presents[i].transform.y = ctx.penguins[j].sprite.transform.y;
-        }
-    }
+    ctx.present_countdown = ctx.max_present_countdown;
+    if (ctx.max_present_countdown > 10) ctx.max_present_countdown--;
 
-    // Move presents
-    for (i = 0; i < 10; i++){
-        if (ctx.presents[i].transform.y < 0 || ctx.presents[i].transform.y > HEIGHT) continue;
+    // Spawn present if there's room, dropped by a random penguin
+    if (ctx.falling_count >= MAX_FALLING_PRESENTS) return;
 
-        ctx.presents[i].transform.y += PRESENT_V * delta;
-    }
+    ng_world_t *world = &ctx.world;
+    int dropper = ng_world_index_of(world, ctx.penguins[ng_random_int_in_range(0, 3)]);
+    float x = world->x[dropper], y = world->y[dropper];
+
+    int i = ng_world_index_of(world, ng_world_spawn(world, NG_POSITION | NG_VELOCITY | NG_SPRITE | FALLING_PRESENT));
+    ng_world_set_sprite(world, i, &ctx.present_template);
+    world->x[i] = x;
+    world->y[i] = y;
+    world->vy[i] = PRESENT_V;
+    ctx.falling_count++;
 }
 
 static void points_check(){
     ng_vec2 player_pos = { ctx.player.sprite.transform.x + ctx.player.sprite.transform.w/2, ctx.player.sprite.transform.y + ctx.player.sprite.transform.h/2 };
-    ng_vec2 player_present_dist;
-    float distance;
-    for (size_t i = 0; i < 10; i++){
-        if (ctx.presents[i].transform.y < 0 || ctx.presents[i].transform.y > HEIGHT) continue;
+    ng_world_t *world = &ctx.world;
 
-        ng_vec2 pres_pos = { ctx.presents[i].transform.x, ctx.presents[i].transform.y };
-        ng_vectors_substract(&player_present_dist, &player_pos, &pres_pos);
-        distance = ng_vector_get_magnitude(&player_present_dist);
-        
-        if (distance < 110){
-            ctx.score++;
-            ctx.presents[i].transform.y += HEIGHT;
-        }
+    // Rebuilt every tick, only the presents in the cells around the player get checked
+    ng_spatial_clear(&ctx.present_grid);
+    ng_query_t query;
+    ng_query_begin(&query, world, FALLING_PRESENT);
+    while (ng_query_next(&query)){
+        int i = query.index;
+        ng_spatial_insert_point(&ctx.present_grid, i, world->x[i], world->y[i]);
+    }
 
-        if (ctx.score >= 20 - 6*ctx.repetition_count){
-            ctx.current_scene = PENG_TO_SLEIGH;
-            prepare_sleigh_scene();
-        }
+    // Enough room for every entity there is, it's all gone at the end of the frame
+    ng_arena_t *arena = &ctx.game.frame_arena;
+    int *caught = NG_ARENA_ARRAY(arena, int, world->count);
+    int caught_count = ng_spatial_query_radius(&ctx.present_grid, player_pos.x, player_pos.y, 110,
+                                               caught, world->count);
+
+    // Killing moves entities around, so the indices become handles first
+    ng_entity_t *caught_presents = NG_ARENA_ARRAY(arena, ng_entity_t, caught_count);
+    for (int i = 0; i < caught_count; i++){
+        caught_presents[i] = ng_world_entity_at(world, caught[i]);
+    }
+
+    for (int i = 0; i < caught_count; i++){
+        ctx.score++;
+        ng_world_kill(world, caught_presents[i]);
+        ctx.falling_count--;
+        update_score_label();
+    }
+
+    if (ctx.score >= 20 - 6*ctx.repetition_count){
+        ng_scenes_switch(&ctx.scenes, PENG_TO_SLEIGH);
     }
 }
 
-static void update_home_to_penguin_scene(){
-    if (ng_interval_is_ready(&ctx.game_tick)){
-        ctx.countdown--;
+// The loader gets pumped by the scene manager
+static void update_loading_scene(float delta){
+    // Only re-rendering the label when the progress actually changes
+    if (ctx.loader.finished_count != ctx.loaded_count){
+        ctx.loaded_count = ctx.loader.finished_count;
+        char *progress = ng_arena_printf(&ctx.game.frame_arena, "LOADING %d%%", (int) (ng_loader_get_progress(&ctx.loader) * 100));
 
-        if (ctx.countdown <= 0){
-            ctx.current_scene = PENGUIN_CHASE;
-            ctx.score = 0;
-        }
+        ng_label_set_content(&ctx.loading_label, ctx.game.renderer, progress);
+        ng_sprite_set_scale(&ctx.loading_label.sprite, 4.0f);
+        ctx.loading_label.sprite.transform.x = WIDTH/2 - ctx.loading_label.sprite.transform.w/2;
+        ctx.loading_label.sprite.transform.y = HEIGHT/2 - ctx.loading_label.sprite.transform.h/2;
+    }
+
+    if (ng_loader_is_done(&ctx.loader)){
+        ng_scenes_switch(&ctx.scenes, HOMESCREEN);
     }
 }
 
-static void update_peng_to_sleigh_scene(){
-    if (ng_interval_is_ready(&ctx.game_tick)){
-        ctx.countdown--;
+static void tick_home_to_penguin_scene(){
+    ctx.countdown--;
 
-        if (ctx.countdown <= 0){
-            ctx.current_scene = SLEIGH;
-            ctx.countdown = 0;
-        }
+    if (ctx.countdown <= 0){
+        ng_scenes_switch(&ctx.scenes, PENGUIN_CHASE);
+    }
+}
+
+static void tick_peng_to_sleigh_scene(){
+    ctx.countdown--;
+
+    if (ctx.countdown <= 0){
+        ng_scenes_switch(&ctx.scenes, SLEIGH);
     }
 }
 
@@ -456,7 +677,7 @@ static void update_slay(){
 }
 
 static void update_sleigh_scene(float delta){
-    const Uint8* keys = SDL_GetKeyboardState(NULL);
+    const Uint8* keys = ng_input_get_keys(&ctx.game.input);
 
     if (keys[SDL_SCANCODE_LEFT]){
         ctx.player.sprite.transform.x -= 640* delta;
@@ -484,45 +705,37 @@ static void update_sleigh_scene(float delta){
         ng_animated_set_frame(&ctx.player, 0);
     }
 
-    if (ctx.presents[0].transform.x < 0 && !ctx.carrying_present){
-        prepare_reversal_screen();
+    if (ctx.stacked_presents[0].transform.x < 0 && !ctx.carrying_present){
+        // Picked up by the next rounds, which get their textures prefetched
         if (ctx.repetition_count == 0){
-            ctx.current_scene = BLACK_SCREEN;
+            ng_scenes_switch(&ctx.scenes, BLACK_SCREEN);
             return;
         }
         if (ctx.repetition_count == 1){
-            ctx.current_scene = EHH;
-            ng_sprite_create(&ctx.penguin_bg, ctx.penguin_bg2_texture);
-            ng_sprite_set_scale(&ctx.penguin_bg, 5.0f);
+            ctx.penguin_background = "res/penguin_bg2.png";
+            ng_scenes_switch(&ctx.scenes, EHH);
             return;
         }
         if (ctx.repetition_count == 2){
-            ctx.current_scene = WAKE_UP;
-            ng_sprite_create(&ctx.penguin_bg, ctx.penguin_bg3_texture);
-            ng_sprite_set_scale(&ctx.penguin_bg, 5.0f);
-            ng_sprite_create(&ctx.sleigh_bg, ctx.sleigh_bg_2_texture);
-            ng_sprite_set_scale(&ctx.sleigh_bg, 5.0f);
-            ng_label_set_content(&ctx.peng_to_sleigh_label, ctx.game.renderer, "HE IS WATCHING");
-            ng_sprite_set_scale(&ctx.peng_to_sleigh_label.sprite, 4.0f);
-            ctx.peng_to_sleigh_label.sprite.transform.x = WIDTH/2 - ctx.peng_to_sleigh_label.sprite.transform.w/2 + 35;
-            ctx.peng_to_sleigh_label.sprite.transform.y = HEIGHT/2 - ctx.peng_to_sleigh_label.sprite.transform.h/2;
+            ctx.penguin_background = "res/penguin_bg3.png";
+            ctx.sleigh_background = "res/slay_bg_2.png";
+            ng_scenes_switch(&ctx.scenes, WAKE_UP);
             return;
         }
         if (ctx.repetition_count >= 3){
-            ctx.current_scene = FINAL_CUTSCENE;
-            prepare_final_cutscene();
+            ng_scenes_switch(&ctx.scenes, FINAL_CUTSCENE);
             return;
         }
     }
 
     ng_vec2 player_pos = { ctx.player.sprite.transform.x + ctx.player.sprite.transform.w/2, ctx.player.sprite.transform.y + ctx.player.sprite.transform.h/2 };
-    ng_vec2 pres_pos = { ctx.presents[0].transform.x, ctx.presents[0].transform.y };
+    ng_vec2 pres_pos = { ctx.stacked_presents[0].transform.x, ctx.stacked_presents[0].transform.y };
     ng_vec2 player_target_dist;
 
     ng_vectors_substract(&player_target_dist, &player_pos, &pres_pos);
-    float distance = ng_vector_get_magnitude(&player_target_dist);
-    if (distance < 20 && !ctx.carrying_present){
-        ctx.presents[ctx.top_present].transform.x = -100;
+    float distance = ng_vector_get_squared_magnitude(&player_target_dist);
+    if (distance < 20*20 && !ctx.carrying_present){
+        ctx.stacked_presents[ctx.top_present].transform.x = -100;
         ctx.top_present--;
         ctx.carrying_present = true;
     }
@@ -530,242 +743,244 @@ static void update_sleigh_scene(float delta){
     ng_vec2 sleigh_pos = { ctx.sleigh.sprite.transform.x + ctx.sleigh.sprite.transform.w/2, ctx.sleigh.sprite.transform.y + ctx.sleigh.sprite.transform.h/2 };
     
     ng_vectors_substract(&player_target_dist, &player_pos, &sleigh_pos);
-    distance = ng_vector_get_magnitude(&player_target_dist);
-    if (distance < 80 && ctx.carrying_present){
+    distance = ng_vector_get_squared_magnitude(&player_target_dist);
+    if (distance < 80*80 && ctx.carrying_present){
         update_slay();
 
         ctx.carrying_present = false;
     }
 }
 
-static void update_reversal_scene(){
-    if (ng_interval_is_ready(&ctx.game_tick)){
-        ctx.countdown--;
-
-        if (ctx.countdown <= 0){
-            if (ctx.repetition_count < 4){
-                ctx.current_scene = CONTEXT_SCENE;
-                prepare_peng_scene();
-                ctx.repetition_count++;
-                return;
-            }
+static void tick_reversal_scene(){
+    ctx.countdown--;
 
-            ctx.current_scene = FINAL_CUTSCENE;
-            prepare_final_cutscene();
+    if (ctx.countdown <= 0){
+        if (ctx.repetition_count < 4){
+            ng_scenes_switch(&ctx.scenes, CONTEXT_SCENE);
             ctx.repetition_count++;
+            return;
         }
+
+        ng_scenes_switch(&ctx.scenes, FINAL_CUTSCENE);
+        ctx.repetition_count++;
     }
 }
 
+static void render_loading_scene(){
+    ng_label_render(&ctx.loading_label, &ctx.game.batch);
+}
+
 static void render_home_scene(){
-    ng_sprite_render(&ctx.home_bg, ctx.game.renderer);
-    ng_sprite_render(&ctx.welcome_label.sprite, ctx.game.renderer);
-    ng_sprite_render(&ctx.questionmark, ctx.game.renderer);
-    if (ctx.show_help) ng_sprite_render(&ctx.help_label.sprite, ctx.game.renderer);
+    ng_layer_render(&ctx.home_layer, &ctx.game.batch);
+    if (ctx.show_help) ng_label_render(&ctx.help_label, &ctx.game.batch);
 }
 
 static void render_home_to_penguin_scene(){
-    ng_sprite_render(&ctx.penguin_context_label.sprite, ctx.game.renderer);
+    ng_layer_render(&ctx.context_layer, &ctx.game.batch);
 }
 
-static void render_penguin_scene(){
-    ng_sprite_render(&ctx.penguin_bg, ctx.game.renderer);
-    ng_sprite_render(&ctx.player.sprite, ctx.game.renderer);
-    for (size_t i = 0; i < 3; i++){
-        ng_sprite_render(&ctx.penguins[i].sprite, ctx.game.renderer);    
-    }
-    for (size_t i = 0; i < 10; i++){
-        if (ctx.presents[i].transform.y < 0 || ctx.presents[i].transform.y > HEIGHT) continue;
+// The player somewhere between the last two updates, see render_scene
+static void render_player(){
+    ng_sprite_t drawn = ctx.player.sprite;
+    drawn.transform.x = ctx.previous_player.x + (drawn.transform.x - ctx.previous_player.x) * ctx.alpha;
+    drawn.transform.y = ctx.previous_player.y + (drawn.transform.y - ctx.previous_player.y) * ctx.alpha;
+    ng_render_batch_add(&ctx.game.batch, &drawn);
+}
 
-        ng_sprite_render(&ctx.presents[i], ctx.game.renderer);
-    }
-    //ng_sprite_render(&ctx.score_label.sprite, ctx.game.renderer);
+static void render_penguin_scene(){
+    ng_render_batch_add(&ctx.game.batch, &ctx.penguin_bg);
+    render_player();
+    ng_world_render_interpolated(&ctx.world, &ctx.game.batch, PENGUIN, ctx.alpha);
+    ng_world_render_interpolated(&ctx.world, &ctx.game.batch, FALLING_PRESENT, ctx.alpha);
+    ng_label_render(&ctx.score_label, &ctx.game.batch);
 }
 
 static void render_peng_to_sleigh_scene(){
-    ng_sprite_render(&ctx.peng_to_sleigh_label.sprite, ctx.game.renderer);
+    ng_label_render(&ctx.peng_to_sleigh_label, &ctx.game.batch);
 }
 
 static void render_sleigh_scene(){
-    ng_sprite_render(&ctx.sleigh_bg, ctx.game.renderer);
-    ng_sprite_render(&ctx.sleigh.sprite, ctx.game.renderer);
-    for (size_t i = 0; i < 10; i++){
-        ng_sprite_render(&ctx.presents[i], ctx.game.renderer);
-    }
-    ng_sprite_render(&ctx.player.sprite, ctx.game.renderer);
+    ng_layer_render(&ctx.sleigh_layer, &ctx.game.batch);
+    render_player();
 }
 
-static void render_reversal_scene(){
-    if (ctx.current_scene == EHH){
-        ng_sprite_render(&ctx.ehh_label.sprite, ctx.game.renderer);
-        return;
-    }
-    if (ctx.current_scene == WAKE_UP){
-        ng_sprite_render(&ctx.wake_up_label.sprite, ctx.game.renderer);
-        return;
-    }
+static void render_ehh_scene(){
+    ng_label_render(&ctx.ehh_label, &ctx.game.batch);
 }
 
-static void update_final_cutscene(float delta){
-    if (ng_interval_is_ready(&ctx.game_tick)){
-        ctx.countdown++;
-        if (ctx.countdown == 0) Mix_PlayMusic(ctx.final_audio, 1);
-        
-        if (ctx.countdown == 20){
-            ng_sprite_create(&ctx.final_bg, ctx.final_bg2_texture);
-            ng_sprite_set_scale(&ctx.final_bg, 10.0f);
-            return;
-        }
-
-        if (ctx.countdown == 150){
-            ng_sprite_create(&ctx.final_bg, ctx.final_bg3_texture);
-            ng_sprite_set_scale(&ctx.final_bg, 10.0f);
-            return;
-        }
+static void render_wake_up_scene(){
+    ng_label_render(&ctx.wake_up_label, &ctx.game.batch);
+}
 
-        if (ctx.countdown == 170){
-            ng_animated_set_frame(&ctx.player, 2);
-            return;
+// The penguins dance in the back the whole time, turning around once per tick
+static void tick_final_cutscene(){
+    ng_world_t *world = &ctx.world;
+    for (size_t i = 0; i <= 1; i++){
+        int p = ng_world_index_of(world, ctx.penguins[i]);
+        if (world->x[p] < 200 || world->x[p] > 300){
+            ng_world_set_frame(world, p, (world->frames[p] + 1) % world->total_frames[p]);
         }
+    }
+}
 
-        if (ctx.countdown > 180 && ctx.countdown < 220){
-            ctx.player.sprite.transform.x += (WIDTH - 400) * 2 * delta;
-            return;
-        }
+static void update_final_cutscene(float delta){
+    ng_timeline_advance(&ctx.final_timeline, delta * 1000);
 
-        if (ctx.countdown == 220){
-            ng_sprite_set_scale(&ctx.player.sprite, 4.0f);
-            ng_animated_set_frame(&ctx.player, 1);
-            ctx.player.sprite.transform.y = ctx.sleigh.sprite.transform.y + ctx.player.sprite.transform.h - 15;
-            ng_label_set_content(&ctx.talk_label, ctx.game.renderer, "I'm done");
-            ctx.talk_label.sprite.transform.x = WIDTH - 300;
-            ctx.talk_label.sprite.transform.y = HEIGHT - 250;
-            return;
-        }
+    ng_world_t *world = &ctx.world;
+    for (size_t i = 0; i <= 1; i++){
+        int p = ng_world_index_of(world, ctx.penguins[i]);
+        world->x[p] += PENGUIN_DANCE_V * ((world->frames[p] & 1) ? -1 : 1) * delta;
+    }
+}
 
-        if (ctx.countdown == 221) Mix_PauseMusic();
+static void render_final_cutscene(){
+    ng_timeline_render(&ctx.final_timeline, &ctx.game.batch);
+}
 
-        for (size_t i = 0; i <= 1; i++){
-            if (ctx.penguins[i].sprite.transform.x < 200 || ctx.penguins[i].sprite.transform.x > 300){
-                ng_animated_set_frame(&ctx.penguins[i], (ctx.penguins[i].frame + 1) % ctx.penguins[i].total_frames);
-            } 
+static void update_penguin_scene(float delta){
+    player_n_enemy_movement(delta);
+    points_check();
+}
 
-            ctx.penguins[i].sprite.transform.x += 400 * pow(-1, ctx.penguins[i].frame) * delta;
-        }    
+static int list_home_textures(const char **paths){
+    paths[0] = "res/home_background.png";
+    return 1;
+}
 
-        if (ctx.countdown > 220 && ctx.countdown < 240) {
-            ctx.player.sprite.transform.x -= (WIDTH - 400) * 2 * delta;
-            return;
-        }
+static int list_penguin_textures(const char **paths){
+    paths[0] = ctx.penguin_background;
+    return 1;
+}
 
-        if (ctx.countdown > 295 && ctx.countdown < 320){
-            ng_animated_set_frame(&ctx.player, 2);
-            ctx.player.sprite.transform.x += (WIDTH - 400) * delta;
-            return;
-        }
-        if(ctx.countdown == 321){
-            Mix_ResumeMusic();
-            ng_label_set_content(&ctx.talk_label, ctx.game.renderer, "THE END");
-            ng_sprite_set_scale(&ctx.talk_label.sprite, 4.0f);
-            ctx.talk_label.sprite.transform.x = WIDTH/2;
-            ctx.talk_label.sprite.transform.y = HEIGHT/2;
-        }
-    }
+static int list_sleigh_textures(const char **paths){
+    paths[0] = ctx.sleigh_background;
+    return 1;
 }
 
-static void render_final_cutscene(){
-    if (ctx.countdown <= 0) return;
-    if (ctx.countdown < 150){
-        ng_sprite_render(&ctx.final_bg, ctx.game.renderer);
-        if (ctx.countdown > 60 && ctx.countdown < 110) ng_sprite_render(&ctx.talk_label.sprite, ctx.game.renderer);
-        return;
-    }
+static int list_final_textures(const char **paths){
+    paths[0] = "res/slay_bg.png";
+    paths[1] = "res/final_bg1.png";
+    paths[2] = "res/final_bg2.png";
+    paths[3] = "res/final_bg3.png";
+    return 4;
+}
 
-    if (ctx.countdown < 220){
-        ng_sprite_render(&ctx.final_bg, ctx.game.renderer);
-        ng_sprite_render(&ctx.player.sprite, ctx.game.renderer);
-        return;
-    }
-    
-    ng_sprite_render(&ctx.sleigh_bg, ctx.game.renderer);
-    ng_sprite_render(&ctx.player.sprite, ctx.game.renderer);
-    ng_sprite_render(&ctx.presents[0], ctx.game.renderer);
-    ng_sprite_render(&ctx.penguins[0].sprite, ctx.game.renderer);
-    ng_sprite_render(&ctx.penguins[1].sprite, ctx.game.renderer);
+// Names are used by benchmark scripts and reports
+static const ng_scene_t scenes[SCENES] = {
+    [LOADING] = { .name = "LOADING", .update = update_loading_scene, .render = render_loading_scene,
+                  .next = 1 << HOMESCREEN },
+    [HOMESCREEN] = { .name = "HOMESCREEN", .enter = prepare_home_scene, .leave = leave_home_scene,
+                     .render = render_home_scene, .list_textures = list_home_textures, .next = 1 << CONTEXT_SCENE },
+    [CONTEXT_SCENE] = { .name = "CONTEXT_SCENE", .enter = prepare_peng_scene, .tick = tick_home_to_penguin_scene,
+                        .render = render_home_to_penguin_scene, .next = 1 << PENGUIN_CHASE },
+    [PENGUIN_CHASE] = { .name = "PENGUIN_CHASE", .enter = enter_penguin_scene, .leave = leave_penguin_scene,
+                        .update = update_penguin_scene, .tick = tick_penguin_scene, .render = render_penguin_scene,
+                        .list_textures = list_penguin_textures, .next = 1 << PENG_TO_SLEIGH },
+    [PENG_TO_SLEIGH] = { .name = "PENG_TO_SLEIGH", .enter = prepare_sleigh_scene, .tick = tick_peng_to_sleigh_scene,
+                         .render = render_peng_to_sleigh_scene, .next = 1 << SLEIGH },
+    [SLEIGH] = { .name = "SLEIGH", .enter = enter_sleigh_scene, .leave = leave_sleigh_scene,
+                 .update = update_sleigh_scene, .render = render_sleigh_scene, .list_textures = list_sleigh_textures,
+                 .next = 1 << BLACK_SCREEN | 1 << WAKE_UP | 1 << EHH | 1 << FINAL_CUTSCENE },
+    [BLACK_SCREEN] = { .name = "BLACK_SCREEN", .enter = prepare_reversal_screen, .tick = tick_reversal_scene,
+                       .next = 1 << CONTEXT_SCENE | 1 << FINAL_CUTSCENE },
+    [WAKE_UP] = { .name = "WAKE_UP", .enter = prepare_wake_up_screen, .tick = tick_reversal_scene,
+                  .render = render_wake_up_scene, .next = 1 << CONTEXT_SCENE | 1 << FINAL_CUTSCENE },
+    [EHH] = { .name = "EHH", .enter = prepare_reversal_screen, .tick = tick_reversal_scene,
+              .render = render_ehh_scene, .next = 1 << CONTEXT_SCENE | 1 << FINAL_CUTSCENE },
+    [FINAL_CUTSCENE] = { .name = "FINAL_CUTSCENE", .enter = prepare_final_cutscene, .update = update_final_cutscene,
+                         .tick = tick_final_cutscene, .render = render_final_cutscene,
+                         .list_textures = list_final_textures },
+};
+
+static void update_scene(float delta){
+    ng_bench_set_section(&ctx.game.bench, ng_scenes_get_name(&ctx.scenes));
+
+    ng_world_save_positions(&ctx.world);
+    ctx.previous_player = (SDL_FPoint) { ctx.player.sprite.transform.x, ctx.player.sprite.transform.y };
+    ctx.interpolated_scene = ng_scenes_get_current(&ctx.scenes);
+
+    ng_scenes_update(&ctx.scenes, delta);
+}
 
-    if (ctx.countdown > 260 && ctx.countdown < 295 || ctx.countdown > 321) ng_sprite_render(&ctx.talk_label.sprite, ctx.game.renderer);
+// Runs every GAME_TICK_MS, right before the update that comes after it
+static void handle_game_tick(void *userdata){
+    ng_scenes_tick(&ctx.scenes);
 }
 
-static void update_correct_screen(float delta){
-    switch (ctx.current_scene){
-    case HOMESCREEN:
-        break;
-    case CONTEXT_SCENE:
-        update_home_to_penguin_scene();
-        break;
-    case PENGUIN_CHASE:
-        player_n_enemy_movement(delta);
-        points_check();
-        break;
-    case PENG_TO_SLEIGH:
-        update_peng_to_sleigh_scene();
-        break;
-    case SLEIGH:
-        update_sleigh_scene(delta);
-        break;
-    case BLACK_SCREEN:
-    case EHH:
-    case WAKE_UP:
-        update_reversal_scene();
-        break;
-    case FINAL_CUTSCENE:
-        update_final_cutscene(delta);
-        break;
-    default:
-        break;
-    }  
+// Alpha is how far (0 to 1) the clock is between the last update and the next one
+static void render_scene(float alpha){
+    ctx.alpha = ng_scenes_get_current(&ctx.scenes) == ctx.interpolated_scene ? alpha : 1;
+    ng_scenes_render(&ctx.scenes);
 }
 
-static void render_correct_screen(){
-    switch (ctx.current_scene){
-    case HOMESCREEN:
-        render_home_scene();
-        break;
-    case CONTEXT_SCENE:
-        render_home_to_penguin_scene();
-        break;
-    case PENGUIN_CHASE:
-        render_penguin_scene();
-        break;
-    case PENG_TO_SLEIGH:
-        render_peng_to_sleigh_scene();
-        break;
-    case SLEIGH:
-        render_sleigh_scene();
-        break;
-    case BLACK_SCREEN:
-        break;
-    case EHH:
-        render_reversal_scene();
-        break;
-    case WAKE_UP:
-        render_reversal_scene();
-        break;
-    case FINAL_CUTSCENE:
-        render_final_cutscene();
-        break;
-    default:
-        break;
-    }    
+// Undoes create_actors (and the scenes), before SDL goes away
+static void handle_quit(){
+    // The mixer reads sounds straight out of the pack, it can't be playing anything once that's gone
+    ng_audio_close();
+    ng_scenes_destroy(&ctx.scenes);
+
+    ng_timeline_destroy(&ctx.final_timeline);
+    ng_layer_destroy(&ctx.sleigh_layer);
+    ng_layer_destroy(&ctx.context_layer);
+    ng_layer_destroy(&ctx.home_layer);
+
+    ng_label_t *labels[] = { &ctx.wake_up_label, &ctx.ehh_label, &ctx.peng_to_sleigh_label, &ctx.penguin_context_label,
+                             &ctx.help_label, &ctx.welcome_label, &ctx.score_label, &ctx.talk_label, &ctx.loading_label };
+    for (size_t i = 0; i < sizeof(labels) / sizeof(labels[0]); i++){
+        ng_label_destroy(labels[i]);
+    }
+
+    ng_spatial_destroy(&ctx.present_grid);
+    ng_world_destroy(&ctx.world);
+    ng_atlas_destroy(&ctx.actors_atlas);
+    ng_glyph_cache_destroy(&ctx.main_glyphs);
+    ng_loader_destroy(&ctx.loader);
+    ng_assets_destroy(&ctx.assets);
+    ng_pack_close(&ctx.pack);
 }
 
-static void update_and_render_scene(float delta){
-    update_correct_screen(delta);
-    render_correct_screen();
+// Lets benchmark scripts skip the parts that need actual skill,
+// with lines like `900 call scene SLEIGH`
+static void handle_command(const char *command){
+    char name[32];
+    if (sscanf(command, "scene %31s", name) != 1) ng_die("unknown script command '%s'", command);
+
+    // What the skipped screens would have prepared has to happen here
+    int scene = ng_scenes_find(&ctx.scenes, name);
+    if (scene == PENGUIN_CHASE) prepare_peng_scene();
+    else if (scene == SLEIGH) prepare_sleigh_scene();
+    else if (scene != FINAL_CUTSCENE) ng_die("scripts can't jump to scene '%s'", name);
+
+    ng_scenes_switch(&ctx.scenes, scene);
 }
 
-int main(){
-    create_actors();
-    ng_game_start_loop(&ctx.game, handle_event, update_and_render_scene);
+// Usage: ./bin [--bench <input script> | --record <log> | --replay <log> | --replay-fast <log>]
+int main(int argc, char **argv){
+    RunMode mode = PLAY;
+    const char *path = argc == 3 ? argv[2] : NULL;
+    if (path){
+        if (strcmp(argv[1], "--bench") == 0) mode = BENCHMARK;
+        else if (strcmp(argv[1], "--record") == 0) mode = RECORD;
+        else if (strcmp(argv[1], "--replay") == 0) mode = REPLAY;
+        else if (strcmp(argv[1], "--replay-fast") == 0) mode = FAST_REPLAY;
+    }
+
+    create_actors(mode, path);
+    ng_scenes_create(&ctx.scenes, scenes, SCENES, &ctx.assets, &ctx.loader, TEXTURE_BUDGET);
+    ng_scenes_switch(&ctx.scenes, LOADING);
+    ng_scheduler_every(&ctx.game.scheduler, GAME_TICK_MS, handle_game_tick, NULL);
+    ng_game_set_quit_handler(&ctx.game, handle_quit);
+
+    if (mode == BENCHMARK){
+        ng_input_load_script(&ctx.game.input, path);
+        ng_input_set_command_handler(&ctx.game.input, handle_command);
+    }
+
+    if (ctx.game.is_deterministic){
+        // Background loading would make the frame count of the loading screen vary
+        ng_loader_finish(&ctx.loader);
+    }
+
+    ng_game_start_fixed_loop(&ctx.game, handle_event, update_scene, render_scene, UPDATES_PER_SECOND);
     return 0;
 }
@@ -0,0 +1,225 @@
+/*
+ * Converts the contents of res/ into a single pack file that the engine can
+ * memory map (see src/engine/pack.h). Images are decoded to RGBA32 pixels
+ * and sounds are converted to the exact format the mixer is opened with,
+ * so that nothing needs to be decoded at runtime
+ *
+ * Usage: bake <resource directory> <output file>
+ */
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "../src/engine/pack.h"
+
+#define MAX_ENTRIES 256
+
+typedef struct
+{
+    ng_pack_entry_t entry;
+
+    // Decoded data, written after the table of contents
+    void *data;
+    // Only used for surfaces, which might have padded rows
+    SDL_Surface *surface;
+} baked_asset_t;
+
+static baked_asset_t assets[MAX_ENTRIES];
+static int asset_count;
+
+static void die(const char *format, const char *argument)
+{
+    fprintf(stderr, "{bake fatal error} ");
+    fprintf(stderr, format, argument);
+    fprintf(stderr, " (%s)\n", SDL_GetError());
+    exit(EXIT_FAILURE);
+}
+
+static baked_asset_t* add_asset(const char *path, ng_pack_entry_type_t type)
+{
+    if (asset_count == MAX_ENTRIES)
+        die("too many assets, %s doesn't fit", path);
+
+    if (strlen(path) >= sizeof(assets[0].entry.path))
+        die("the path %s is too long", path);
+
+    baked_asset_t *asset = &assets[asset_count++];
+    memset(asset, 0, sizeof(baked_asset_t));
+
+    strcpy(asset->entry.path, path);
+    asset->entry.type = type;
+
+    return asset;
+}
+
+static void bake_image(const char *path)
+{
+    SDL_Surface *loaded = IMG_Load(path);
+    if (!loaded)
+        die("failed to decode image %s", path);
+
+    SDL_Surface *surface = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_FreeSurface(loaded);
+    if (!surface)
+        die("failed to convert image %s", path);
+
+    baked_asset_t *asset = add_asset(path, NG_PACK_IMAGE);
+    asset->surface = surface;
+    asset->entry.width = surface->w;
+    asset->entry.height = surface->h;
+    asset->entry.size = (uint64_t) surface->w * surface->h * 4;
+}
+
+static void bake_sound(const char *path)
+{
+    SDL_AudioSpec spec;
+    Uint8 *samples;
+    Uint32 length;
+
+    if (!SDL_LoadWAV(path, &spec, &samples, &length))
+        die("failed to decode sound %s", path);
+
+    // Resampling and converting, exactly like SDL_mixer would do on load
+    SDL_AudioCVT cvt;
+    if (SDL_BuildAudioCVT(&cvt, spec.format, spec.channels, spec.freq, NG_PACK_AUDIO_FORMAT,
+                          NG_PACK_AUDIO_CHANNELS, NG_PACK_AUDIO_FREQUENCY) < 0)
+        die("can't convert sound %s", path);
+
+    cvt.len = length;
+    cvt.buf = malloc((size_t) length * cvt.len_mult);
+    if (!cvt.buf)
+        die("out of memory while converting %s", path);
+
+    memcpy(cvt.buf, samples, length);
+    SDL_FreeWAV(samples);
+
+    if (cvt.needed && SDL_ConvertAudio(&cvt) < 0)
+        die("failed to convert sound %s", path);
+
+    baked_asset_t *asset = add_asset(path, NG_PACK_SOUND);
+    asset->data = cvt.buf;
+    asset->entry.size = cvt.needed ? (Uint32) cvt.len_cvt : length;
+}
+
+static void collect(const char *directory)
+{
+    DIR *dir = opendir(directory);
+    if (!dir)
+        die("failed to open directory %s", directory);
+
+    struct dirent *item;
+    while ((item = readdir(dir)))
+    {
+        if (item->d_name[0] == '.')
+            continue;
+
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", directory, item->d_name);
+
+        struct stat info;
+        if (stat(path, &info) != 0)
+            continue;
+
+        if (S_ISDIR(info.st_mode))
+        {
+            collect(path);
+            continue;
+        }
+
+        const char *extension = strrchr(item->d_name, '.');
+        if (!extension)
+            continue;
+
+        if (strcmp(extension, ".png") == 0)
+            bake_image(path);
+        else if (strcmp(extension, ".wav") == 0)
+            bake_sound(path);
+    }
+
+    closedir(dir);
+}
+
+static int compare_paths(const void *a, const void *b)
+{
+    return strcmp(((const baked_asset_t*) a)->entry.path, ((const baked_asset_t*) b)->entry.path);
+}
+
+static uint64_t align(uint64_t offset)
+{
+    return (offset + NG_PACK_ALIGNMENT - 1) / NG_PACK_ALIGNMENT * NG_PACK_ALIGNMENT;
+}
+
+static void write_padding(FILE *output, uint64_t from, uint64_t to)
+{
+    static const char zeros[NG_PACK_ALIGNMENT] = {0};
+    fwrite(zeros, 1, to - from, output);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 3)
+    {
+        fprintf(stderr, "Usage: %s <resource directory> <output file>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    collect(argv[1]);
+
+    // The engine finds entries with a binary search
+    qsort(assets, asset_count, sizeof(baked_asset_t), compare_paths);
+
+    // Data blocks start right after the table of contents
+    uint64_t offset = sizeof(ng_pack_header_t) + asset_count * sizeof(ng_pack_entry_t);
+    for (int i = 0; i < asset_count; i++)
+    {
+        offset = align(offset);
+        assets[i].entry.offset = offset;
+        offset += assets[i].entry.size;
+    }
+
+    FILE *output = fopen(argv[2], "wb");
+    if (!output)
+        die("failed to open %s for writing", argv[2]);
+
+    ng_pack_header_t header = { NG_PACK_MAGIC, NG_PACK_VERSION, asset_count, 0 };
+    fwrite(&header, sizeof(header), 1, output);
+
+    for (int i = 0; i < asset_count; i++)
+        fwrite(&assets[i].entry, sizeof(ng_pack_entry_t), 1, output);
+
+    uint64_t position = sizeof(ng_pack_header_t) + asset_count * sizeof(ng_pack_entry_t);
+    for (int i = 0; i < asset_count; i++)
+    {
+        baked_asset_t *asset = &assets[i];
+
+        write_padding(output, position, asset->entry.offset);
+        position = asset->entry.offset;
+
+        if (asset->surface)
+        {
+            // Rows might be padded in memory, but never inside the pack
+            SDL_Surface *surface = asset->surface;
+            for (int y = 0; y < surface->h; y++)
+                fwrite((Uint8*) surface->pixels + y * surface->pitch, 4, surface->w, output);
+
+            SDL_FreeSurface(surface);
+        }
+        else
+        {
+            fwrite(asset->data, 1, asset->entry.size, output);
+            free(asset->data);
+        }
+
+        position += asset->entry.size;
+        printf("%-8s %8llu KB  %s\n", asset->entry.type == NG_PACK_IMAGE ? "image" : "sound",
+               (unsigned long long) asset->entry.size / 1024, asset->entry.path);
+    }
+
+    fclose(output);
+    printf("Baked %d assets into %s (%llu KB)\n", asset_count, argv[2], (unsigned long long) position / 1024);
+
+    return EXIT_SUCCESS;
+}